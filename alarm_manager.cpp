@@ -2,64 +2,8 @@
 #include "storage.h"
 #include "servo_control.h"
 #include "config.h"
-
-// ========================================
-// Random Interval Management
-// ========================================
-
-void calculateNextRandomInterval() {
-    DateTime now = rtc.now();
-    uint32_t currentUnix = now.unixtime();
-    uint32_t intervalSeconds = (modeConfig.randIntervalHours * 3600UL + 
-                                modeConfig.randIntervalMinutes * 60UL);
-    
-    // Calculate when the NEXT interval block should start
-    uint32_t nextBlockStartUnix = modeConfig.randIntervalBlockStartUnix + intervalSeconds;
-    
-    // Calculate random offset within the NEW block
-    uint32_t randomOffset = random(0, intervalSeconds);
-    
-    // Set the new block start time and trigger time
-    modeConfig.randIntervalBlockStartUnix = nextBlockStartUnix;
-    modeConfig.randIntervalNextTriggerUnix = nextBlockStartUnix + randomOffset;
-    
-    saveModeConfig();
-    
-    Serial.println("\n=== Random Interval Calculated ===");
-    
-    DateTime blockStart(nextBlockStartUnix);
-    DateTime triggerTime(modeConfig.randIntervalNextTriggerUnix);
-    
-    Serial.printf("Next interval block starts: %02d:%02d:%02d\n",
-                 blockStart.hour(), blockStart.minute(), blockStart.second());
-    Serial.printf("Random trigger time: %02d:%02d:%02d\n",
-                 triggerTime.hour(), triggerTime.minute(), triggerTime.second());
-    Serial.printf("Random offset: %lu seconds (%lu minutes)\n", 
-                 randomOffset, randomOffset / 60);
-    Serial.println("================================\n");
-}
-
-void initializeRandomInterval() {
-    DateTime now = rtc.now();
-    uint32_t currentUnix = now.unixtime();
-    uint32_t intervalSeconds = (modeConfig.randIntervalHours * 3600UL + 
-                                modeConfig.randIntervalMinutes * 60UL);
-    
-    // Start the first interval block NOW
-    modeConfig.randIntervalBlockStartUnix = currentUnix;
-    
-    // Calculate random trigger time within this first block
-    uint32_t randomOffset = random(0, intervalSeconds);
-    modeConfig.randIntervalNextTriggerUnix = currentUnix + randomOffset;
-    
-    saveModeConfig();
-    
-    Serial.println("\n=== Random Interval Initialized ===");
-    Serial.printf("First interval block starts: NOW (%lu)\n", currentUnix);
-    Serial.printf("Random trigger in %lu seconds (%lu minutes)\n", 
-                 randomOffset, randomOffset / 60);
-    Serial.println("===================================\n");
-}
+#include "scheduler.h"
+#include "energy_model.h"
 
 // ========================================
 // Wake Configuration
@@ -67,135 +11,30 @@ void initializeRandomInterval() {
 
 void configureNextWake() {
     DateTime now = rtc.now();
-    DateTime nextWake;
-    bool alarmSet = false;
+    uint32_t currentUnix = now.unixtime();
     
     Serial.println("\n=== Configuring Next Wake ===");
     Serial.printf("Current time (AEST): %02d-%02d-%04d %02d:%02d:%02d\n",
                  now.day(), now.month(), now.year(),
                  now.hour(), now.minute(), now.second());
+    Serial.printf("Mode: %s\n", modeConfig.activeMode.c_str());
     
-    if (modeConfig.activeMode == "set_times") {
-        Serial.println("Mode: Set Times");
-        
-        for (auto &a : alarms) {
-            if (a.active) {
-                int alarmHour = a.time.substring(0, 2).toInt();
-                int alarmMin = a.time.substring(3, 5).toInt();
-                
-                DateTime alarmToday(now.year(), now.month(), now.day(), 
-                                   alarmHour, alarmMin, 0);
-                
-                if (alarmToday.unixtime() > now.unixtime()) {
-                    nextWake = alarmToday;
-                    alarmSet = true;
-                    Serial.printf("Next alarm today: %s\n", a.time.c_str());
-                    break;
-                } else if (!alarmSet) {
-                    DateTime tomorrow(now.unixtime() + 86400UL);
-                    nextWake = DateTime(tomorrow.year(), tomorrow.month(), tomorrow.day(),
-                                       alarmHour, alarmMin, 0);
-                    alarmSet = true;
-                    Serial.printf("Next alarm tomorrow: %s\n", a.time.c_str());
-                }
-            }
-        }
-        
-        if (!alarmSet) {
-            Serial.println("No active alarms found");
-        }
-    } 
-    else if (modeConfig.activeMode == "regular_interval") {
-        Serial.println("Mode: Regular Interval");
-        
-        uint32_t intervalSeconds = (modeConfig.regIntervalHours * 3600UL + 
-                                     modeConfig.regIntervalMinutes * 60UL);
-        
-        if (intervalSeconds > 0) {
-            uint32_t currentUnix = now.unixtime();
-            
-            if (modeConfig.regIntervalLastTriggerUnix == 0) {
-                Serial.println("First run - scheduling next trigger from now");
-                nextWake = DateTime(currentUnix + intervalSeconds);
-                alarmSet = true;
-            } else {
-                uint32_t nextTriggerUnix = modeConfig.regIntervalLastTriggerUnix + intervalSeconds;
-                
-                if (currentUnix >= nextTriggerUnix) {
-                    Serial.println("Overdue - triggering soon");
-                    nextWake = DateTime(currentUnix + 60);
-                } else {
-                    nextWake = DateTime(nextTriggerUnix);
-                    uint32_t remaining = nextTriggerUnix - currentUnix;
-                    Serial.printf("Next trigger in %lu seconds (%lu minutes)\n", 
-                                 remaining, remaining / 60);
-                }
-                alarmSet = true;
-            }
-            
-            Serial.printf("Interval: %dh %dm (%lu seconds)\n", 
-                         modeConfig.regIntervalHours, 
-                         modeConfig.regIntervalMinutes,
-                         intervalSeconds);
-        } else {
-            Serial.println("Invalid interval (0 seconds)");
-        }
-    }
-    else if (modeConfig.activeMode == "random_interval") {
-        Serial.println("Mode: Random Interval");
-        
-        uint32_t currentUnix = now.unixtime();
-        
-        if (modeConfig.randIntervalNextTriggerUnix == 0 || 
-            modeConfig.randIntervalBlockStartUnix == 0) {
-            Serial.println("Initializing random interval for first time");
-            initializeRandomInterval();
-        }
-        
-        if (modeConfig.randIntervalNextTriggerUnix > currentUnix) {
-            nextWake = DateTime(modeConfig.randIntervalNextTriggerUnix);
-            alarmSet = true;
-            
-            uint32_t remaining = modeConfig.randIntervalNextTriggerUnix - currentUnix;
-            Serial.printf("Next trigger in %lu seconds (%lu minutes)\n", 
-                         remaining, remaining / 60);
-            
-            DateTime blockStart(modeConfig.randIntervalBlockStartUnix);
-            Serial.printf("Current interval block started at: %02d:%02d:%02d\n",
-                         blockStart.hour(), blockStart.minute(), blockStart.second());
-        } 
-        else {
-            Serial.println("Trigger time passed - recalculating");
-            
-            uint32_t intervalSeconds = (modeConfig.randIntervalHours * 3600UL + 
-                                        modeConfig.randIntervalMinutes * 60UL);
-            
-            uint32_t timeSinceBlockStart = currentUnix - modeConfig.randIntervalBlockStartUnix;
-            uint32_t blocksPassed = timeSinceBlockStart / intervalSeconds;
-            
-            modeConfig.randIntervalBlockStartUnix += (blocksPassed + 1) * intervalSeconds;
-            
-            uint32_t randomOffset = random(0, intervalSeconds);
-            modeConfig.randIntervalNextTriggerUnix = modeConfig.randIntervalBlockStartUnix + randomOffset;
-            
-            saveModeConfig();
-            
-            nextWake = DateTime(modeConfig.randIntervalNextTriggerUnix);
-            alarmSet = true;
-            
-            Serial.printf("Skipped %lu interval blocks\n", blocksPassed + 1);
-            Serial.printf("New trigger time: %02d:%02d:%02d\n",
-                         nextWake.hour(), nextWake.minute(), nextWake.second());
-        }
-    }
+    uint32_t wakeUnix = nextWakeUnix(currentUnix);
     
-    if (alarmSet) {
+    if (wakeUnix != 0) {
+        DateTime nextWake(wakeUnix);
+        uint32_t remaining = wakeUnix - currentUnix;
+        Serial.printf("Next trigger in %lu seconds (%lu minutes)\n", remaining, remaining / 60);
+        
         rtc.disableAlarm(2);
         rtc.clearAlarm(1);
         rtc.clearAlarm(2);
         rtc.writeSqwPinMode(DS3231_OFF);
         
-        rtc.setAlarm1(nextWake, DS3231_A1_Hour);
+        // Match the date too: an hour match fires every day, and a set-times
+        // trigger can be up to a week away. Nothing is a month away, since
+        // intervals are capped at INTERVAL_MAX_MINUTES.
+        rtc.setAlarm1(nextWake, DS3231_A1_Date);
         
         Serial.printf("Next wake scheduled for (AEST): %04d-%02d-%02d %02d:%02d:%02d\n",
                      nextWake.year(), nextWake.month(), nextWake.day(),
@@ -212,63 +51,68 @@ void configureNextWake() {
 // Trigger Functions
 // ========================================
 
-void triggerActivation(bool noMode) {
+// Runs once the carousel has stopped; the move's current trace says
+// whether it really turned
+static void activationFinished(const MotionJob &job) {
     Serial.println("========================================");
-    Serial.println("TRIGGER EVENT!");
-    Serial.printf("Mode: %s\n", modeConfig.activeMode.c_str());
-    
-    DateTime now = rtc.now();
-    Serial.printf("Time: %02d:%02d:%02d\n", now.hour(), now.minute(), now.second());
-    
-    advanceCompartment();
+    Serial.printf("ACTIVATION FINISHED (job %u)\n", job.id);
 
-    bool success = true;
-    String errorMessage = "";
-    String warning = "";
-    
     if (!LittleFS.begin()) {
-        warning = "LittleFS not accessible - compartment position may not persist";
-        Serial.println("WARNING: " + warning);
-        logEvent("WARNING", modeConfig.activeMode, warning);
+        Serial.println("WARNING: LittleFS not accessible - events may not persist");
+        logEvent(EVENT_WARNING, currentEventMode(), MSG_FS_NOT_ACCESSIBLE);
     }
 
     if (!rtc.begin(&Wire)) {
-        warning = "RTC communication error - clock may have lost power";
-        Serial.println("ERROR: " + warning);
-        logEvent("WARNING", modeConfig.activeMode, warning);
+        Serial.println("ERROR: RTC communication error - clock may have lost power");
+        logEvent(EVENT_WARNING, currentEventMode(), MSG_RTC_COMM_ERROR);
     }
 
     if (rtc.lostPower()) {
-        warning = "RTC lost power - time may be incorrect, battery may need replacement";
-        Serial.println("WARNING: " + warning);
-        logEvent("WARNING", modeConfig.activeMode, warning);
+        Serial.println("WARNING: RTC lost power - time may be incorrect, battery may need replacement");
+        logEvent(EVENT_WARNING, currentEventMode(), MSG_RTC_LOST_POWER);
     }
 
     if (digitalRead(SERVO_TRANSISTOR_PIN) != HIGH) {
-        success = false;
-        errorMessage = "Servo power transistor failed to activate";
-        Serial.println("ERROR: " + errorMessage);
-        logEvent("ERROR", modeConfig.activeMode, errorMessage);
+        Serial.println("ERROR: Servo power transistor failed to activate");
+        logEvent(EVENT_ERROR, currentEventMode(), MSG_SERVO_POWER_FAILED);
         Serial.println("========================================");
         return;
     }
 
-    String compartmentActivationStr = String(compartment + 1);
-    if (compartment == 0) compartmentActivationStr = "6";
-    
-    String successMessage = "Activation completed successfully (Chamber " + compartmentActivationStr + ")";
+    EventMode mode = job.manual ? EVENT_MODE_MANUAL : currentEventMode();
+    lastDispenseCapture.timestamp = rtc.now().unixtime();
+    lastDispenseCapture.chamber = job.chamber;
 
-    if (success) {
-        if (noMode) {
-            logEvent("SUCCESS", "Manual Activation", successMessage);
-        } else {
-            logEvent("SUCCESS", modeConfig.activeMode, successMessage);
-        }
-    } else {
-        logEvent("ERROR", modeConfig.activeMode, errorMessage);
+    if (job.result == CAPTURE_STALLED) {
+        Serial.println("ERROR: Servo still driving at the end of the move - carousel jammed?");
+        logEvent(EVENT_ERROR, mode, MSG_SERVO_STALLED, job.chamber);
+        Serial.println("========================================");
+        return;
     }
+    if (job.result == CAPTURE_NO_CURRENT) {
+        Serial.println("ERROR: Servo drew no drive current - carousel did not move");
+        logEvent(EVENT_ERROR, mode, MSG_SERVO_NO_CURRENT, job.chamber);
+        Serial.println("========================================");
+        return;
+    }
+
+    recordDispenseEnergy(lastDispenseCapture.energyMj);
+    logEvent(EVENT_SUCCESS, mode, MSG_ACTIVATION_COMPLETE, job.chamber);
+    Serial.println("========================================");
+}
+
+uint32_t triggerActivation(bool noMode) {
+    Serial.println("========================================");
+    Serial.println("TRIGGER EVENT!");
+    Serial.printf("Mode: %s\n", modeConfig.activeMode.c_str());
+    
+    DateTime now = rtc.now();
+    Serial.printf("Time: %02d:%02d:%02d\n", now.hour(), now.minute(), now.second());
     
+    uint32_t job = queueMotion(MOTION_DISPENSE, noMode, activationFinished);
+    Serial.printf("Dispense queued as job %u\n", job);
     Serial.println("========================================");
+    return job;
 }
 
 void checkTriggers() {
@@ -280,64 +124,11 @@ void checkTriggers() {
     }
     lastCheck = now;
 
-    DateTime rtcTime = rtc.now();
-    uint32_t currentUnix = rtcTime.unixtime();
-
-    // MODE 1: Set Times
-    if (modeConfig.activeMode == "set_times") {
-        char current[6];
-        snprintf(current, sizeof(current), "%02d:%02d", rtcTime.hour(), rtcTime.minute());
+    uint32_t currentUnix = rtc.now().unixtime();
 
-        for (auto &a : alarms) {
-            if (a.active && a.time == current && rtcTime.second() == 0) {
-                Serial.printf("SET TIMES: Alarm triggered at %s!\n", a.time.c_str());
-                triggerActivation();
-                break;
-            }
-        }
-    }
-    
-    // MODE 2: Regular Interval
-    else if (modeConfig.activeMode == "regular_interval") {
-        uint32_t intervalSeconds = (modeConfig.regIntervalHours * 3600UL + 
-                                     modeConfig.regIntervalMinutes * 60UL);
-        
-        if (intervalSeconds > 0) {
-            if (modeConfig.regIntervalLastTriggerUnix == 0) {
-                modeConfig.regIntervalLastTriggerUnix = currentUnix;
-                saveModeConfig();
-                Serial.println("Regular interval initialized");
-            }
-            
-            uint32_t nextTriggerUnix = modeConfig.regIntervalLastTriggerUnix + intervalSeconds;
-            
-            if (currentUnix >= nextTriggerUnix) {
-                Serial.printf("REGULAR INTERVAL: Triggered after %dh %dm\n", 
-                             modeConfig.regIntervalHours, modeConfig.regIntervalMinutes);
-                
-                triggerActivation();
-                
-                modeConfig.regIntervalLastTriggerUnix = currentUnix;
-                saveModeConfig();
-            }
-        }
-    }
-    
-    // MODE 3: Random Interval
-    else if (modeConfig.activeMode == "random_interval") {
-        if (modeConfig.randIntervalNextTriggerUnix == 0 || 
-            modeConfig.randIntervalBlockStartUnix == 0) {
-            initializeRandomInterval();
-            return;
-        }
-        
-        if (currentUnix >= modeConfig.randIntervalNextTriggerUnix) {
-            Serial.printf("RANDOM INTERVAL: Triggered at random time within %dh %dm window\n",
-                         modeConfig.randIntervalHours, modeConfig.randIntervalMinutes);
-            
-            triggerActivation();
-            
-            calculateNextRandomInterval();
-        }
+    if (scheduleDue(currentUnix)) {
+        Serial.printf("SCHEDULED TRIGGER (%s)\n", modeConfig.activeMode.c_str());
+        triggerActivation();
+        scheduleFired(currentUnix);
     }
 }
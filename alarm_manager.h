@@ -9,15 +9,13 @@
 // Alarm & Mode Management Functions
 // ========================================
 
-// Random interval management
-void calculateNextRandomInterval();
-void initializeRandomInterval();
-
 // Wake configuration
 void configureNextWake();
 
 // Trigger functions
-void triggerActivation(bool noMode = false);
+// Queues a dispense and returns its motion job id (0 if the queue is
+// full); the outcome is logged once the carousel has stopped
+uint32_t triggerActivation(bool noMode = false);
 void checkTriggers();
 
 // ========================================
@@ -0,0 +1,104 @@
+#include "boot_profile.h"
+#include "alarm_manager.h"
+#include "button_ulp.h"
+
+// ========================================
+// Profile Storage
+// ========================================
+
+struct BootProfileRing {
+    uint8_t head;              // Next slot to write
+    uint8_t count;
+    BootProfile entries[BOOT_PROFILE_HISTORY];
+};
+
+RTC_DATA_ATTR static BootProfileRing bootProfiles[BOOT_KIND_COUNT];
+
+static BootProfile current;
+static uint8_t currentKind = BOOT_KIND_RESET;
+static bool profiling = false;
+
+static const char *PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "fs", "rtc", "ina219", "state", "wifi_settings",
+    "events", "portal", "dispense", "schedule", "sleep_prep"
+};
+
+const char *bootPhaseName(uint8_t phase) {
+    return phase < BOOT_PHASE_COUNT ? PHASE_NAMES[phase] : "unknown";
+}
+
+const char *bootKindName(uint8_t kind) {
+    switch (kind) {
+        case BOOT_KIND_BUTTON: return "button";
+        case BOOT_KIND_ALARM: return "rtc_alarm";
+        default: return "reset";
+    }
+}
+
+// ========================================
+// Profiling
+// ========================================
+
+void startBootProfile() {
+    memset(&current, 0, sizeof(current));
+    switch (wakeupCause()) {
+        case ESP_SLEEP_WAKEUP_EXT0: currentKind = BOOT_KIND_ALARM; break;
+        case ESP_SLEEP_WAKEUP_ULP:
+        case ESP_SLEEP_WAKEUP_EXT1: currentKind = BOOT_KIND_BUTTON; break;
+        default: currentKind = BOOT_KIND_RESET; break;
+    }
+    profiling = true;
+}
+
+void bootPhaseBegin(BootPhase phase) {
+    if (!profiling) return;
+    current.phases[phase].startUs = micros();
+}
+
+void bootPhaseEnd(BootPhase phase) {
+    if (!profiling) return;
+    BootPhaseTiming &timing = current.phases[phase];
+    // Never report a phase that ran as zero
+    timing.durationUs = max(1UL, (unsigned long)(micros() - timing.startUs));
+}
+
+void finishBootProfile() {
+    if (!profiling) return;
+    profiling = false;
+
+    current.totalUs = micros();
+    current.timestamp = rtc.now().unixtime();
+
+    BootProfileRing &ring = bootProfiles[currentKind];
+    if (ring.count > BOOT_PROFILE_HISTORY || ring.head >= BOOT_PROFILE_HISTORY) {
+        memset(&ring, 0, sizeof(ring));
+    }
+    ring.entries[ring.head] = current;
+    ring.head = (ring.head + 1) % BOOT_PROFILE_HISTORY;
+    if (ring.count < BOOT_PROFILE_HISTORY) ring.count++;
+
+    Serial.printf("Boot profile (%s): %lu us\n", bootKindName(currentKind), (unsigned long)current.totalUs);
+}
+
+const BootProfile *storedBootProfile(uint8_t kind, uint8_t i) {
+    if (kind >= BOOT_KIND_COUNT) return nullptr;
+    const BootProfileRing &ring = bootProfiles[kind];
+    if (i >= ring.count || ring.count > BOOT_PROFILE_HISTORY) return nullptr;
+    return &ring.entries[(ring.head + BOOT_PROFILE_HISTORY - 1 - i) % BOOT_PROFILE_HISTORY];
+}
+
+void printBootProfiles() {
+    Serial.println("Boot profiles (us, newest first):");
+    for (uint8_t kind = 0; kind < BOOT_KIND_COUNT; kind++) {
+        const BootProfile *profile;
+        for (uint8_t i = 0; (profile = storedBootProfile(kind, i)) != nullptr; i++) {
+            Serial.printf("  %-9s %lu total %8lu:", bootKindName(kind),
+                          (unsigned long)profile->timestamp, (unsigned long)profile->totalUs);
+            for (uint8_t phase = 0; phase < BOOT_PHASE_COUNT; phase++) {
+                if (profile->phases[phase].durationUs == 0) continue;
+                Serial.printf(" %s %lu", bootPhaseName(phase), (unsigned long)profile->phases[phase].durationUs);
+            }
+            Serial.println();
+        }
+    }
+}
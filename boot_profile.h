@@ -0,0 +1,35 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+// ========================================
+// Boot Profiler
+// ========================================
+// Times each startup phase with micros() and keeps the last
+// BOOT_PROFILE_HISTORY profiles for each wake reason in RTC memory, so
+// the cost of every boot path can be compared across deep sleeps. A
+// profile ends with setup() or, for boots that never get there, on the
+// way into deep sleep.
+
+// Call first thing in setup()
+void startBootProfile();
+
+void bootPhaseBegin(BootPhase phase);
+void bootPhaseEnd(BootPhase phase);
+
+// Stores the running profile; later calls in the same boot do nothing
+void finishBootProfile();
+
+const char *bootPhaseName(uint8_t phase);
+const char *bootKindName(uint8_t kind);
+
+// i-th stored profile of a wake reason, newest first, or nullptr
+const BootProfile *storedBootProfile(uint8_t kind, uint8_t i);
+
+// Serial dump of every stored profile
+void printBootProfiles();
+
+#endif // BOOT_PROFILE_H
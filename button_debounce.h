@@ -0,0 +1,53 @@
+#ifndef BUTTON_DEBOUNCE_H
+#define BUTTON_DEBOUNCE_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ========================================
+// Wake Button Debounce
+// ========================================
+// Qualifies a wake-button press from BUTTON_PIN samples taken every
+// BUTTON_SAMPLE_MS. A press counts once the pin has read high for
+// BUTTON_PRESS_SAMPLES samples in a row; any low sample starts the count
+// again, so contact bounce and knocks on the enclosure never wake the CPU.
+// After a press the pin has to read low before another press can count.
+//
+// While the feeder sleeps the ULP runs this machine (button_ulp.cpp). The
+// ESP32's ULP only runs its own instruction set, so the program there is
+// written out by hand with these states and fields; the host build runs
+// this code on its simulated button instead.
+
+#define BUTTON_PRESS_SAMPLES (BUTTON_LONG_PRESS_MS / BUTTON_SAMPLE_MS)
+
+enum ButtonDebounceState : uint16_t {
+    DEBOUNCE_WAIT_RELEASE,     // Ignore the pin until it reads low
+    DEBOUNCE_ARMED             // Counting high samples
+};
+
+// 16-bit fields, like the ULP's loads and stores
+struct ButtonDebounce {
+    uint16_t state;
+    uint16_t heldSamples;
+};
+
+// A button held down when sampling starts has to be released first
+inline void buttonDebounceReset(ButtonDebounce &d) {
+    d.state = DEBOUNCE_WAIT_RELEASE;
+    d.heldSamples = 0;
+}
+
+// Feeds one sample; returns true on the sample that completes a press
+inline bool buttonDebounceStep(ButtonDebounce &d, bool high) {
+    if (!high) {
+        d.state = DEBOUNCE_ARMED;
+        d.heldSamples = 0;
+        return false;
+    }
+    if (d.state != DEBOUNCE_ARMED) return false;
+    if (++d.heldSamples < BUTTON_PRESS_SAMPLES) return false;
+    d.state = DEBOUNCE_WAIT_RELEASE;
+    return true;
+}
+
+#endif // BUTTON_DEBOUNCE_H
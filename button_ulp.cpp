@@ -0,0 +1,123 @@
+#include "button_ulp.h"
+#include "button_debounce.h"
+#include <esp_sleep.h>
+#include <esp32/ulp.h>
+#include <driver/rtc_io.h>
+#include <soc/rtc_io_reg.h>
+
+// ========================================
+// ULP Wake Button
+// ========================================
+
+bool startWakeUlp() {
+    const gpio_num_t pin = (gpio_num_t)BUTTON_PIN;
+    const gpio_num_t alarmPin = (gpio_num_t)RTC_ALARM_PIN;
+    const int rtcio = rtc_io_number_get(pin);
+    const int alarmRtcio = rtc_io_number_get(alarmPin);
+    if (rtcio < 0 || alarmRtcio < 0) {
+        Serial.printf("GPIO %d or %d has no RTC IO - the wake ULP needs both\n", BUTTON_PIN, RTC_ALARM_PIN);
+        return false;
+    }
+
+    enum { LBL_HIGH, LBL_COUNT, LBL_WAKE, LBL_ALARM };
+
+    // The alarm pin first, then buttonDebounceStep(), one sample per run;
+    // R3 points at the slots
+    const ulp_insn_t program[] = {
+        I_MOVI(R3, 0),
+        I_RD_REG(RTC_GPIO_IN_REG, RTC_GPIO_IN_NEXT_S + alarmRtcio, RTC_GPIO_IN_NEXT_S + alarmRtcio),
+        M_BL(LBL_ALARM, 1),
+
+        I_RD_REG(RTC_GPIO_IN_REG, RTC_GPIO_IN_NEXT_S + rtcio, RTC_GPIO_IN_NEXT_S + rtcio),
+        M_BGE(LBL_HIGH, 1),
+
+        // Low: arm and start counting again
+        I_MOVI(R1, DEBOUNCE_ARMED),
+        I_ST(R1, R3, ULP_SLOT_STATE),
+        I_MOVI(R1, 0),
+        I_ST(R1, R3, ULP_SLOT_HELD),
+        I_HALT(),
+
+        // High: only counts once armed
+        M_LABEL(LBL_HIGH),
+        I_LD(R0, R3, ULP_SLOT_STATE),
+        M_BGE(LBL_COUNT, DEBOUNCE_ARMED),
+        I_HALT(),
+
+        M_LABEL(LBL_COUNT),
+        I_LD(R0, R3, ULP_SLOT_HELD),
+        I_ADDI(R0, R0, 1),
+        I_ST(R0, R3, ULP_SLOT_HELD),
+        M_BGE(LBL_WAKE, BUTTON_PRESS_SAMPLES),
+        I_HALT(),
+
+        // A real press: wake the main cores and stop the sampling timer.
+        // This is the sample that completes BUTTON_PRESS_SAMPLES, so the
+        // cores boot while the button is still held rather than on release,
+        // and setup() needs no second look at the pin
+        M_LABEL(LBL_WAKE),
+        I_MOVI(R1, DEBOUNCE_WAIT_RELEASE),
+        I_ST(R1, R3, ULP_SLOT_STATE),
+        I_MOVI(R1, ULP_WAKE_BUTTON),
+        I_ST(R1, R3, ULP_SLOT_WAKE),
+        I_WAKE(),
+        I_END(),
+        I_HALT(),
+
+        // The DS3231 holds the pin low until the alarm flag is cleared
+        M_LABEL(LBL_ALARM),
+        I_MOVI(R1, ULP_WAKE_ALARM),
+        I_ST(R1, R3, ULP_SLOT_WAKE),
+        I_WAKE(),
+        I_END(),
+        I_HALT(),
+    };
+
+    ButtonDebounce initial;
+    buttonDebounceReset(initial);
+    RTC_SLOW_MEM[ULP_SLOT_STATE] = initial.state;
+    RTC_SLOW_MEM[ULP_SLOT_HELD] = initial.heldSamples;
+    RTC_SLOW_MEM[ULP_SLOT_WAKE] = ULP_WAKE_NONE;
+
+    rtc_gpio_init(pin);
+    rtc_gpio_set_direction(pin, RTC_GPIO_MODE_INPUT_ONLY);
+    // The SQW output is open drain
+    rtc_gpio_init(alarmPin);
+    rtc_gpio_set_direction(alarmPin, RTC_GPIO_MODE_INPUT_ONLY);
+    rtc_gpio_pulldown_dis(alarmPin);
+    rtc_gpio_pullup_en(alarmPin);
+
+    size_t size = sizeof(program) / sizeof(ulp_insn_t);
+    if (ulp_process_macros_and_load(ULP_PROGRAM_START, program, &size) != ESP_OK) {
+        Serial.println("ULP program failed to load");
+        releaseWakeUlp();
+        return false;
+    }
+    // Refused while ext0 is enabled ("Conflicting wake-up trigger: ext0")
+    if (esp_sleep_enable_ulp_wakeup() != ESP_OK) {
+        Serial.println("ULP wake source refused");
+        releaseWakeUlp();
+        return false;
+    }
+    ulp_set_wakeup_period(0, BUTTON_SAMPLE_MS * 1000UL);
+    if (ulp_run(ULP_PROGRAM_START) != ESP_OK) {
+        Serial.println("ULP failed to start");
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ULP);
+        releaseWakeUlp();
+        return false;
+    }
+    return true;
+}
+
+void releaseWakeUlp() {
+    rtc_gpio_deinit((gpio_num_t)BUTTON_PIN);
+    rtc_gpio_deinit((gpio_num_t)RTC_ALARM_PIN);
+}
+
+esp_sleep_wakeup_cause_t wakeupCause() {
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause == ESP_SLEEP_WAKEUP_ULP && (RTC_SLOW_MEM[ULP_SLOT_WAKE] & 0xFFFF) == ULP_WAKE_ALARM) {
+        return ESP_SLEEP_WAKEUP_EXT0;
+    }
+    return cause;
+}
@@ -0,0 +1,44 @@
+#ifndef BUTTON_ULP_H
+#define BUTTON_ULP_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include "config.h"
+
+// ========================================
+// ULP Wake Button
+// ========================================
+// Runs the button_debounce.h state machine on the ULP coprocessor while
+// the main cores sleep, so they are only woken by a press that has
+// already been qualified, BUTTON_LONG_PRESS_MS into it. The classic ESP32 cannot combine the ULP and
+// ext0 wake sources, so the same program also watches RTC_ALARM_PIN and
+// wakes the cores when the DS3231 pulls it low.
+
+// Words at the start of the ULP reserved area (512 bytes in the Arduino
+// core's sdkconfig, ahead of the RTC_DATA_ATTR variables). The ULP only
+// stores the low 16 bits of a word, as in struct ButtonDebounce.
+#define ULP_SLOT_STATE 0
+#define ULP_SLOT_HELD 1
+#define ULP_SLOT_WAKE 2             // UlpWakeReason of the last ULP wake
+#define ULP_PROGRAM_START 3
+
+enum UlpWakeReason : uint16_t {
+    ULP_WAKE_NONE,
+    ULP_WAKE_BUTTON,
+    ULP_WAKE_ALARM
+};
+
+// Loads the program, starts it sampling both pins every BUTTON_SAMPLE_MS
+// and enables the ULP wake source. Returns false if the ULP could not be
+// started; the caller then falls back to ext0 and ext1 wakes.
+bool startWakeUlp();
+
+// Hands both pins back to the digital GPIO matrix after a wake
+void releaseWakeUlp();
+
+// esp_sleep_get_wakeup_cause() with the ULP's wakes told apart: an RTC
+// alarm it saw reads as ESP_SLEEP_WAKEUP_EXT0, like the ext0 fallback,
+// and a debounced press as ESP_SLEEP_WAKEUP_ULP
+esp_sleep_wakeup_cause_t wakeupCause();
+
+#endif // BUTTON_ULP_H
@@ -22,31 +22,129 @@
 #define SERVO_ANGLE_OFFSET 5
 #define SERVO_ANGLE_STEP 60
 #define SERVO_FINAL_DELAY 2000  // Delay before returning to deadspace (ms)
+#define SERVO_SETTLE_MS 300     // Time for the servo to settle after a ramp ends (ms)
+#define SERVO_RAMP_MS_PER_DEG 4 // Ramp duration per degree of travel (ms)
+#define SERVO_RAMP_STEP_MS 20   // One ramp step per 50 Hz PWM frame
+#define SERVO_POWER_UP_MS 20    // Supply settle after the transistor turns on, before the first step (ms)
+#define SERVO_POWER_HOLD_MS 500 // Power stays on this long after the last move settles (ms)
+#define MOTION_QUEUE_LENGTH 4   // Moves waiting or running
+#define MOTION_HISTORY_LENGTH 8 // Finished moves kept for /api/jobs
+
+// ========================================
+// Wake Button Debounce (ULP)
+// ========================================
+#define BUTTON_SAMPLE_MS 10             // ULP sampling period while asleep
+#define BUTTON_LONG_PRESS_MS 300        // Held this long without a bounce to count as a press
+
+// ========================================
+// Battery Monitoring
+// ========================================
+#define BATTERY_SAMPLE_INTERVAL 5000    // Background INA219 read period in AP mode (ms)
+#define BATTERY_EWMA_ALPHA 0.2f         // Weight of each new sample in the filtered voltage
+#define BATTERY_INTERNAL_OHMS 0.15f     // Pack and wiring resistance, used to undo load sag
+
+// ========================================
+// Energy Model
+// ========================================
+// Estimates used until the feeder has measured the phase itself
+#define BATTERY_CAPACITY_MAH 2500       // 2S pack
+#define BATTERY_NOMINAL_V 7.4f
+#define ENERGY_SLEEP_UA 1200            // Deep sleep draw, mostly the INA219 and DS3231 (never measurable awake)
+#define ENERGY_AWAKE_MA 45              // ESP32 awake with the radio off
+#define ENERGY_DISPENSE_MJ 1000         // One carousel move
+#define ENERGY_AP_MA 155                // Configuration portal with the servo unpowered
+#define ENERGY_AP_MINUTES_PER_DAY 2     // Expected portal use when projecting
+#define ENERGY_LIGHT_SLEEP_UA 800       // Light sleep draw over deep sleep (RAM and CPU kept powered)
+#define ENERGY_LIGHT_SLEEP_ENTRY_MS 15  // Awake arming the wake ULP, flushing serial and entering and leaving light sleep
+#define SLEEP_MIN_SECONDS 2             // Closer triggers are waited for awake; the RTC alarm counts whole seconds
+#define ENERGY_ROM_BOOT_MS 300          // ROM bootloader and app start-up before millis() counts
+#define ENERGY_COST_ALPHA 0.25f         // Weight of each new measurement
+
+// ========================================
+// Boot Profiling
+// ========================================
+#define BOOT_PROFILE_HISTORY 4          // Profiles kept in RTC memory for each wake reason
+
+// ========================================
+// Dispense Current Capture
+// ========================================
+#define CAPTURE_MAX_SAMPLES 1536        // Preallocated current trace, 2 bytes per sample (~0.4 ms reads)
+#define CAPTURE_MOVING_MA 300           // Supply current above this means the servo is driving
+#define CAPTURE_STALL_TAIL_MS 100       // Still driving this close to the end of the move = stalled
 
 // ========================================
 // Timing Constants
 // ========================================
 #define AP_TIMEOUT_MS 900000UL  // 15 minutes in milliseconds
-#define MAX_EVENTS_IN_MEMORY 100
+#define AP_IDLE_GRACE_MS 180000UL      // End the portal early once no client has been associated this long
+#define MAX_EVENTS_IN_MEMORY 2048      // Events kept in RAM (8 bytes each)
 #define EVENT_RETENTION_SECONDS 86400  // 24 hours
+#define EVENT_LOG_CAPACITY 4096        // Records in the events.bin ring (8 bytes each)
+#define EVENT_PAGE_LIMIT 100           // Default events per GET /api/events page
 #define TRIGGER_CHECK_INTERVAL 1000    // Check triggers every 1 second
 #define COUNTDOWN_INTERVAL 60000       // Show AP countdown every 60 seconds
 
+// ========================================
+// Interval Modes
+// ========================================
+// The RTC alarm matches the day of the month, so no trigger may be a month
+// away; set-times triggers are at most a week away and intervals likewise
+#define INTERVAL_MIN_MINUTES 1
+#define INTERVAL_MAX_MINUTES (7 * 24 * 60)
+
+// ========================================
+// Set-Times Alarms
+// ========================================
+#define MAX_ALARMS 256              // Set-times slots, all of which fit the RTC snapshot
+#define ALARM_DAYS_ALL 0x7F         // Weekday mask, bit 0 = Sunday
+#define ALARM_DAYS_WEEKDAYS 0x3E
+#define ALARM_DAYS_WEEKENDS 0x41
+
+// ========================================
+// RTC Memory State
+// ========================================
+#define RTC_STATE_MAX_ALARMS MAX_ALARMS  // Alarms held in the RTC memory snapshot
+#define RTC_STATE_BACKUP_WAKES 6    // Scheduled wakes between flash backups of the snapshot
+
+// ========================================
+// Random Interval Plan
+// ========================================
+#define RANDOM_PLAN_HOURS 24            // Time one plan covers
+#define RANDOM_PLAN_MAX_TRIGGERS 96     // Triggers held in RTC memory (4 bytes each)
+#define RANDOM_PLAN_MAX_DRAWS 64        // Empty plans (all quiet hours) drawn before giving up
+
 // ========================================
 // WiFi Configuration
 // ========================================
 #define DEFAULT_SSID "Taronga Zoo Curlew Feeder"
 #define DNS_PORT 53
+#define HTTP_MAX_BODY 4096              // Larger request bodies are ignored
+#define ASSET_CACHE_CONTROL "no-cache"  // Always revalidate; unchanged assets cost a 304
+#define STATUS_CHECK_INTERVAL 1000      // How often loop() looks for status changes to push
+#define STATUS_RECONNECT_MS 3000        // Browser retry delay after the stream drops
+#define STATUS_MAX_EVENTS_PER_PUSH 8    // Larger bursts make the page reload its history
+
+// ========================================
+// Config Store (NVS)
+// ========================================
+#define NVS_NAMESPACE "feeder"
+#define NVS_KEY_CONFIG "config"         // Mode, servo position, WiFi and UI settings
+#define NVS_KEY_ALARMS "alarms"         // Alarm table
 
 // ========================================
 // File Paths
 // ========================================
+// JSON config from before the NVS store, imported on first boot and removed
 #define FILE_ALARMS "/alarms.json"
 #define FILE_MODE "/mode.json"
 #define FILE_SERVO "/servo.json"
 #define FILE_WIFI "/wifi.json"
 #define FILE_SETTINGS "/settings.json"
-#define FILE_EVENTS "/events.log"
+
+#define FILE_EVENTS "/events.bin"
+#define FILE_EVENTS_LEGACY "/events.log"     // CSV log, migrated on first use
+#define FILE_FLASH_STATS "/flash_stats.bin"  // Per-file write counters
+#define FILE_TEMP_SUFFIX ".tmp"              // Atomic writes go here first, then are renamed
 
 // ========================================
 // JSON Buffer Sizes
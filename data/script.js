@@ -5,6 +5,7 @@ const tabContents = document.querySelectorAll('.tab-content');
 // Set Time Elements
 const alarmForm = document.getElementById('alarm-form');
 const alarmTimeInput = document.getElementById('alarm-time');
+const alarmDaysSelect = document.getElementById('alarm-days');
 const alarmsListEl = document.getElementById('alarms-list');
 const setTimeSaveBtn = document.getElementById('set-times-save-btn');
 
@@ -21,6 +22,15 @@ const regIntervalSaveBtn = document.getElementById('reg-interval-save-btn');
 const randIntervalHoursInput = document.getElementById('rand-interval-hours');
 const randIntervalMinutesInput = document.getElementById('rand-interval-minutes');
 const randIntervalSaveBtn = document.getElementById('rand-interval-save-btn');
+const randMinGapInput = document.getElementById('rand-min-gap');
+const randQuietStartInput = document.getElementById('rand-quiet-start');
+const randQuietEndInput = document.getElementById('rand-quiet-end');
+const randPlanList = document.getElementById('rand-plan-list');
+
+// Battery Projection Elements
+const setTimesProjectionEl = document.getElementById('set-times-projection');
+const regIntervalProjectionEl = document.getElementById('reg-interval-projection');
+const randIntervalProjectionEl = document.getElementById('rand-interval-projection');
 
 // Settings Elements
 const settingsForm = document.getElementById('settings-form');
@@ -58,7 +68,6 @@ let eventStats = null;
 
 let alarms = [];
 let settings = { timeFormat: '24', theme: 'light' };
-let timeUpdateInterval = null;
 
 // Modes enum (different mode types)
 const MODES = Object.freeze({
@@ -154,44 +163,123 @@ function updateServoDisplay() {
 }
 
 // ----------------------
-// Load System Clock Time
+// Live status
 // ----------------------
-async function updateCurrentTime() {
-    try {
-        const res = await fetch('/api/time');
-        const data = await res.json();
-        
-        if (data) {
-            const hours = String(data.hour).padStart(2, '0');
-            const minutes = String(data.minute).padStart(2, '0');
-            const seconds = String(data.second).padStart(2, '0');
-            
-            let timeString;
-            if (settings.timeFormat === '12') {
-                const hour12 = data.hour % 12 || 12;
-                const ampm = data.hour >= 12 ? 'PM' : 'AM';
-                timeString = `${String(hour12).padStart(2, '0')}:${minutes}:${seconds} ${ampm}`;
-            } else {
-                timeString = `${hours}:${minutes}:${seconds}`;
-            }
-            
-            document.getElementById('current-time').textContent = timeString;
-        }
-    } catch (error) {
-        console.error('Error fetching time:', error);
-        document.getElementById('current-time').textContent = 'Error';
+// /api/stream pushes a "status" snapshot whenever one of its fields changes
+// and an "event" message for each new log entry. The clock ticks locally
+// from the last RTC time received, so nothing is polled while the page is open.
+let clockOffsetSeconds = null; // RTC time minus browser time
+let statusActiveMode = null;
+
+function renderClock() {
+    if (clockOffsetSeconds === null) return;
+
+    // The RTC keeps AEST wall time, so read the fields back as UTC
+    const now = new Date((Date.now() / 1000 + clockOffsetSeconds) * 1000);
+    const hour = now.getUTCHours();
+    const minutes = String(now.getUTCMinutes()).padStart(2, '0');
+    const seconds = String(now.getUTCSeconds()).padStart(2, '0');
+
+    let timeString;
+    if (settings.timeFormat === '12') {
+        const hour12 = hour % 12 || 12;
+        const ampm = hour >= 12 ? 'PM' : 'AM';
+        timeString = `${String(hour12).padStart(2, '0')}:${minutes}:${seconds} ${ampm}`;
+    } else {
+        timeString = `${String(hour).padStart(2, '0')}:${minutes}:${seconds}`;
     }
+
+    document.getElementById('current-time').textContent = timeString;
 }
 
-function startTimeUpdates() {
-    // Update immediately
-    updateCurrentTime();
-    
-    // Update every second
-    if (timeUpdateInterval) {
-        clearInterval(timeUpdateInterval);
+function applyStatus(data) {
+    clockOffsetSeconds = data.unix - Date.now() / 1000;
+    renderClock();
+
+    renderBattery(data.battery);
+
+    servoPosition.compartment = data.compartment;
+    servoPosition.maxCompartment = data.maxCompartment;
+
+    // The mode label needs the interval settings, so fetch those on a change
+    if (statusActiveMode !== null && data.activeMode !== statusActiveMode) {
+        loadModeStatus();
+    }
+    statusActiveMode = data.activeMode;
+    document.getElementById('next-activation-time').textContent = data.nextActivationTime || 'Not set';
+
+    // Catch up on anything logged while the stream was down
+    const newestId = eventHistory.length > 0 ? eventHistory[0].id : -1;
+    if (data.lastEventId > newestId) {
+        loadEventHistory();
+        loadEventStats();
+    }
+}
+
+function addPushedEvent(event) {
+    const newestId = eventHistory.length > 0 ? eventHistory[0].id : -1;
+    if (event.id <= newestId) return;
+    if (newestId >= 0 && event.id > newestId + 1) {
+        loadEventHistory();
+        loadEventStats();
+        return;
+    }
+
+    eventHistory.unshift(event);
+    renderEventHistory();
+    if (eventStats) {
+        eventStats.totalEvents++;
+        if (event.type === 'SUCCESS') eventStats.successCount++;
+        if (event.type === 'ERROR') eventStats.errorCount++;
+        updateStatsDisplay();
+    }
+}
+
+async function loadStatus() {
+    const data = await apiGet('/api/status');
+    if (data) applyStatus(data);
+}
+
+function startStatusUpdates() {
+    setInterval(renderClock, 1000);
+
+    if (!window.EventSource) {
+        setInterval(loadStatus, 60000);
+        return;
+    }
+
+    // The browser reconnects on its own; the first message is a full snapshot
+    const stream = new EventSource('/api/stream');
+    stream.addEventListener('status', (e) => applyStatus(JSON.parse(e.data)));
+    stream.addEventListener('event', (e) => addPushedEvent(JSON.parse(e.data)));
+    stream.addEventListener('job', (e) => finishJob(JSON.parse(e.data)));
+}
+
+// Servo moves run in the background; the stream reports when each finishes
+const pendingJobs = {};
+
+function queueJob(result, queuedMessage, doneMessage) {
+    if (!result) return;
+    if (result.status === 'busy') {
+        showNotification('Feeder is busy, try again shortly');
+        return;
+    }
+    pendingJobs[result.job] = doneMessage;
+    showNotification(queuedMessage);
+}
+
+function finishJob(job) {
+    const doneMessage = pendingJobs[job.id];
+    if (!doneMessage) return;
+    delete pendingJobs[job.id];
+
+    if (job.result === 'stalled') {
+        showNotification('Servo stalled - check the feeder for a jam');
+    } else if (job.result === 'no_current') {
+        showNotification('Servo drew no current - check the wiring');
+    } else {
+        showNotification(doneMessage);
     }
-    timeUpdateInterval = setInterval(updateCurrentTime, 1000);
 }
 
 // ----------------------
@@ -210,11 +298,35 @@ async function loadSettings() {
 // ----------------------
 // Load event history
 // ----------------------
-async function loadEventHistory() {
+// Events carry increasing ids. A refresh only asks for ids newer than the
+// newest one shown, paging back with `before` when a page comes back full.
+const EVENT_PAGE_LIMIT = 100;
+
+async function fetchEventsSince(sinceId) {
+    let events = [];
+    let before = null;
+    while (true) {
+        let path = `/api/events?limit=${EVENT_PAGE_LIMIT}`;
+        if (sinceId !== null) path += `&since=${sinceId}`;
+        if (before !== null) path += `&before=${before}`;
+
+        const page = await apiGet(path);
+        if (!page) return null;
+        events = events.concat(page);
+
+        // A full first load stops after one page; refreshes fill the gap
+        if (sinceId === null || page.length < EVENT_PAGE_LIMIT) break;
+        before = page[page.length - 1].id;
+    }
+    return events;
+}
+
+async function loadEventHistory(full = false) {
     try {
-        const data = await apiGet('/api/events');
+        const newestId = !full && eventHistory.length > 0 ? eventHistory[0].id : null;
+        const data = await fetchEventsSince(newestId);
         if (data) {
-            eventHistory = data;
+            eventHistory = newestId === null ? data : data.concat(eventHistory);
             renderEventHistory();
         }
     } catch (error) {
@@ -422,6 +534,7 @@ async function clearEventHistory() {
 // ----------------------
 function renderAlarms() {
     alarmsListEl.innerHTML = '';
+    updateSetTimesProjection();
     
     if (alarms.length === 0) {
         alarmsListEl.innerHTML = '<p style="text-align: center; opacity: 0.7;">No times set</p>';
@@ -434,6 +547,7 @@ function renderAlarms() {
         alarmEl.innerHTML = `
             <div>
                 <div class="alarm-time">${formatAlarmTime(alarm.time)}</div>
+                <div class="alarm-days">${formatAlarmDays(alarm.days)}</div>
             </div>
             <div class="alarm-actions">
                 <button class="toggle-btn ${alarm.active ? 'active' : ''}" data-id="${alarm.id}">
@@ -464,6 +578,18 @@ function renderAlarms() {
     });
 }
 
+// ----------------------
+// Format an alarm's weekday mask (bit 0 = Sunday) for display
+// ----------------------
+function formatAlarmDays(days) {
+    if (days === undefined || days === 127) return 'Every day';
+    if (days === 62) return 'Weekdays';
+    if (days === 65) return 'Weekends';
+
+    const names = ['Sun', 'Mon', 'Tue', 'Wed', 'Thu', 'Fri', 'Sat'];
+    return names.filter((name, i) => days & (1 << i)).join(', ');
+}
+
 // ----------------------
 // Format alarm time for display
 // ----------------------
@@ -539,7 +665,8 @@ function setupEventListeners() {
             return;
         }
         
-        const result = await apiPost('/api/alarms', { time });
+        const days = parseInt(alarmDaysSelect.value);
+        const result = await apiPost('/api/alarms', { time, days });
         if (result) {
             alarms = result;
             renderAlarms();
@@ -568,7 +695,7 @@ function setupEventListeners() {
         if (res.ok) {
             applyTheme(settings.theme);
             renderAlarms(); // Re-render to apply time format changes
-            updateCurrentTime();
+            renderClock();
             showNotification('Settings saved successfully');
         } else {
             showNotification('Failed to save settings');
@@ -639,6 +766,11 @@ function setupEventListeners() {
     // Sync System Time button
     syncTimeBtn.addEventListener('click', syncTime);
 
+    regIntervalHoursInput.addEventListener('input', updateRegIntervalProjection);
+    regIntervalMinutesInput.addEventListener('input', updateRegIntervalProjection);
+    randIntervalHoursInput.addEventListener('input', updateRandIntervalProjection);
+    randIntervalMinutesInput.addEventListener('input', updateRandIntervalProjection);
+
     resetMotorBtn.addEventListener('click', async () => {
         if (await customConfirmModal(
             'This will reset the chambers to their default positions. Are you sure?')) {
@@ -674,7 +806,7 @@ function setupEventListeners() {
     if (refreshHistoryBtn) {
         refreshHistoryBtn.addEventListener('click', async () => {
             showNotification('Refreshing history...');
-            await loadEventHistory();
+            await loadEventHistory(true);
             await loadEventStats();
             showNotification('History refreshed');
         });
@@ -702,9 +834,7 @@ function setupEventListeners() {
 
 async function resetMotorPos() {
     const result = await apiPost('/api/reset-motor', {});
-    if (result) {
-        showNotification('Chambers reset to default positions.');
-    }
+    queueJob(result, 'Resetting chambers...', 'Chambers reset to default positions.');
 }
 
 function getAESTOffset() {
@@ -743,7 +873,7 @@ async function syncTime() {
         
         if (result && result.success) {
             showNotification(`System time synced to ${tzName}`);
-            updateCurrentTime();
+            loadStatus();
         } else {
             showNotification('Failed to sync time');
         }
@@ -757,9 +887,7 @@ async function syncTime() {
 // FOR DEBUG / TESTING PURPOSES
 async function triggerNow() {
     const result = await apiPost('/api/trigger-now', {});
-    if (result) {
-        showNotification('Activation Triggered');
-    }
+    queueJob(result, 'Activation Queued', 'Activation Complete');
 }
 
 async function setModeToSetTimes() {
@@ -801,7 +929,10 @@ async function setModeToRandInterval() {
     
     const result = await apiPost('/api/mode/random-interval', { 
         hours, 
-        minutes 
+        minutes,
+        minGapMinutes: parseInt(randMinGapInput.value) || 0,
+        quietStart: timeToMinutes(randQuietStartInput.value),
+        quietEnd: timeToMinutes(randQuietEndInput.value)
     });
     
     if (result) {
@@ -825,6 +956,7 @@ async function loadModeStatus() {
         }
         
         document.getElementById('active-mode').textContent = modeDisplay;
+        statusActiveMode = data.activeMode;
         document.getElementById('next-activation-time').textContent = data.nextActivationTime || 'Not set';
         
         // Update input fields
@@ -832,9 +964,83 @@ async function loadModeStatus() {
         regIntervalMinutesInput.value = data.regIntervalMinutes;
         randIntervalHoursInput.value = data.randIntervalHours;
         randIntervalMinutesInput.value = data.randIntervalMinutes;
+        randMinGapInput.value = data.randMinGapMinutes;
+        randQuietStartInput.value = minutesToTime(data.randQuietStartMinute);
+        randQuietEndInput.value = minutesToTime(data.randQuietEndMinute);
+
+        if (data.activeMode === 'random_interval') {
+            await loadRandomPlan();
+        } else {
+            randPlanList.innerHTML = '';
+        }
     }
 }
 
+// ----------------------
+// Random interval plan
+// ----------------------
+// Quiet hours travel as minutes of the day
+function timeToMinutes(value) {
+    const [hours, minutes] = (value || '00:00').split(':');
+    return (parseInt(hours) || 0) * 60 + (parseInt(minutes) || 0);
+}
+
+function minutesToTime(total) {
+    total = total || 0;
+    return `${String(Math.floor(total / 60)).padStart(2, '0')}:${String(total % 60).padStart(2, '0')}`;
+}
+
+// Lists the triggers of the plan drawn on the feeder; ones already past
+// are struck through
+async function loadRandomPlan() {
+    const plan = await apiGet('/api/mode/random-plan');
+    if (!plan) return;
+
+    randPlanList.innerHTML = '';
+    plan.forEach(trigger => {
+        // The RTC keeps AEST wall time, so read the fields back as UTC
+        const at = new Date(trigger.unix * 1000);
+        const item = document.createElement('li');
+        item.textContent = formatAlarmTime(`${at.getUTCHours()}:${String(at.getUTCMinutes()).padStart(2, '0')}`);
+        if (trigger.done) item.className = 'done';
+        randPlanList.appendChild(item);
+    });
+}
+
+// ----------------------
+// Battery projection
+// ----------------------
+// Shows how long the battery would last on the schedule being edited,
+// before it is saved
+async function updateProjection(el, query) {
+    const data = await apiGet(`/api/energy?${query}`);
+    if (!data) return;
+    if (data.feedsPerDay === 0) {
+        el.textContent = '';
+        return;
+    }
+    el.textContent = `Battery lasts about ${Math.floor(data.daysLeft)} days ` +
+                     `(${data.feedsLeft} feeds) at ${data.feedsPerDay.toFixed(1)} feeds a day`;
+}
+
+function intervalQuery(mode, hoursInput, minutesInput) {
+    return `mode=${mode}&hours=${parseInt(hoursInput.value) || 0}&minutes=${parseInt(minutesInput.value) || 0}`;
+}
+
+function updateSetTimesProjection() {
+    updateProjection(setTimesProjectionEl, `mode=${MODES.SET_TIMES}`);
+}
+
+function updateRegIntervalProjection() {
+    updateProjection(regIntervalProjectionEl,
+                     intervalQuery(MODES.REGULAR_INTERVAL, regIntervalHoursInput, regIntervalMinutesInput));
+}
+
+function updateRandIntervalProjection() {
+    updateProjection(randIntervalProjectionEl,
+                     intervalQuery(MODES.RANDOM_INTERVAL, randIntervalHoursInput, randIntervalMinutesInput));
+}
+
 function percentageToColor(percentage) {
     // Ensure the percentage is within the valid range [0, 100]
     percentage = Math.max(0, Math.min(100, percentage));
@@ -849,26 +1055,15 @@ function percentageToColor(percentage) {
     return `hsl(${hue}, 100%, 50%)`;
   }
 
-// Get Battery Charge
-async function loadBatteryCharge() {
-    const data = await apiGet('/api/battery');
-    if (data) {
-        const batteryStatus = document.getElementById('battery-status');
-        batteryStatus.textContent = data.battery + "%";
-
-        let color = percentageToColor(data.battery);
-        const batteryIndicator = document.getElementById('battery-indicator');
-        batteryIndicator.style.background = color;
-    }
-
-    // let test = 100;
-    // const batteryStatus = document.getElementById('battery-status');
-    // batteryStatus.textContent = test + "%";
+// Show Battery Charge
+function renderBattery(percentage) {
+    const batteryStatus = document.getElementById('battery-status');
+    batteryStatus.textContent = percentage + "%";
 
-    // let color = percentageToColor(test);
-    // const batteryIndicator = document.getElementById('battery-indicator');
-    // batteryIndicator.style.background = color;
-}   
+    let color = percentageToColor(percentage);
+    const batteryIndicator = document.getElementById('battery-indicator');
+    batteryIndicator.style.background = color;
+}
 
 function customConfirmModal(message) {
     return new Promise((resolve) => {
@@ -937,32 +1132,22 @@ async function init() {
 
     // Load Mode Status
     await loadModeStatus();
+    updateRegIntervalProjection();
+    updateRandIntervalProjection();
 
     // Load event history
     await loadEventHistory();
     await loadEventStats();
 
-    // Load battery charge
-    await loadBatteryCharge();
-
-    // Refresh battery charge every 60 seconds
-    setInterval(loadBatteryCharge, 60000);
+    // Load clock, battery and next activation
+    await loadStatus();
     
     // Set up event listeners
     setupEventListeners();
 
-    // Start System Clock
+    // Start System Clock and the status stream
     syncTime();
-    startTimeUpdates();
-
-    // Refresh Mode Status every 60 seconds
-    setInterval(loadModeStatus, 60000);
-
-    // Refresh event history every 5 minutes
-    setInterval(() => {
-        loadEventHistory();
-        loadEventStats();
-    }, 300000);
+    startStatusUpdates();
 
     
     console.log('App initialized');
@@ -0,0 +1,158 @@
+#include "energy_model.h"
+#include "servo_control.h"
+
+// ========================================
+// Helpers
+// ========================================
+
+// Moving average of a cost; the first measurement replaces the estimate
+static void foldCost(float &cost, float measuredMj) {
+    if (measuredMj <= 0) return;
+    cost = cost == 0 ? measuredMj : cost + ENERGY_COST_ALPHA * (measuredMj - cost);
+}
+
+// ========================================
+// Phase Costs
+// ========================================
+
+float dispenseCostMj() {
+    return energyCosts.dispenseMj > 0 ? energyCosts.dispenseMj : ENERGY_DISPENSE_MJ;
+}
+
+float wakeCostMj() {
+    if (energyCosts.wakeMj > 0) return energyCosts.wakeMj;
+    // About half a second awake before and after the move
+    return ENERGY_AWAKE_MA * BATTERY_NOMINAL_V * 0.5f;
+}
+
+float apMinuteCostMj() {
+    return energyCosts.apMinuteMj > 0 ? energyCosts.apMinuteMj : ENERGY_AP_MA * BATTERY_NOMINAL_V * 60.0f;
+}
+
+float sleepCostMjPerDay() {
+    return ENERGY_SLEEP_UA / 1000.0f * BATTERY_NOMINAL_V * 86400.0f;
+}
+
+// ========================================
+// Waiting Between Triggers
+// ========================================
+
+float waitCostMj(SleepChoice choice, uint32_t seconds) {
+    // Deep sleep's own draw is already in sleepCostMjPerDay()
+    switch (choice) {
+        case SLEEP_STAY_AWAKE:
+            return ENERGY_AWAKE_MA * BATTERY_NOMINAL_V * seconds;
+        case SLEEP_LIGHT:
+            return ENERGY_LIGHT_SLEEP_UA / 1000.0f * BATTERY_NOMINAL_V * seconds +
+                   ENERGY_AWAKE_MA * BATTERY_NOMINAL_V * ENERGY_LIGHT_SLEEP_ENTRY_MS / 1000.0f;
+        default:
+            // The wake cost only starts at millis() 0; the ROM boot before it
+            // is charged at the awake current
+            return wakeCostMj() + ENERGY_AWAKE_MA * BATTERY_NOMINAL_V * ENERGY_ROM_BOOT_MS / 1000.0f;
+    }
+}
+
+SleepChoice cheapestWait(uint32_t seconds) {
+    // An alarm less than a whole RTC second or two ahead can pass while the
+    // feeder is still going to sleep, and would then not match for a month
+    if (seconds < SLEEP_MIN_SECONDS) return SLEEP_STAY_AWAKE;
+
+    SleepChoice best = SLEEP_DEEP;
+    for (SleepChoice choice : {SLEEP_LIGHT, SLEEP_STAY_AWAKE}) {
+        if (waitCostMj(choice, seconds) < waitCostMj(best, seconds)) best = choice;
+    }
+    return best;
+}
+
+// ========================================
+// Schedule Rates
+// ========================================
+
+float setTimesFeedsPerDay() {
+    int perWeek = 0;
+    for (auto &a : alarms) {
+        if (!a.active) continue;
+        for (int day = 0; day < 7; day++) {
+            if (a.days & (1 << day)) perWeek++;
+        }
+    }
+    return perWeek / 7.0f;
+}
+
+float intervalFeedsPerDay(uint32_t intervalSeconds) {
+    return intervalSeconds > 0 ? 86400.0f / intervalSeconds : 0;
+}
+
+float scheduleFeedsPerDay(ScheduleMode mode) {
+    switch (mode) {
+        case SCHEDULE_SET_TIMES:
+            return setTimesFeedsPerDay();
+        case SCHEDULE_REGULAR_INTERVAL:
+            return intervalFeedsPerDay(modeConfig.regIntervalHours * 3600UL + modeConfig.regIntervalMinutes * 60UL);
+        case SCHEDULE_RANDOM_INTERVAL:
+            // One trigger in each interval block
+            return intervalFeedsPerDay(modeConfig.randIntervalHours * 3600UL + modeConfig.randIntervalMinutes * 60UL);
+        default:
+            return 0;
+    }
+}
+
+// ========================================
+// Projection
+// ========================================
+
+EnergyProjection projectEnergy(float feedsPerDay, float apMinutesPerDay) {
+    EnergyProjection p;
+    int percent = batteryReading.valid ? batteryReading.percent : 100;
+
+    // Each feed pays for the cheapest wait over the average gap before it
+    uint32_t gapSeconds = feedsPerDay > 0 ? (uint32_t)(86400.0f / feedsPerDay) : 86400;
+    float waitMj = waitCostMj(cheapestWait(gapSeconds), gapSeconds);
+
+    p.feedsPerDay = feedsPerDay;
+    p.dailyMj = sleepCostMjPerDay() +
+                feedsPerDay * (waitMj + dispenseCostMj()) +
+                apMinutesPerDay * apMinuteCostMj();
+    // mAh x V is mWh, and a mWh is 3600 mJ
+    p.remainingMj = percent / 100.0f * BATTERY_CAPACITY_MAH * BATTERY_NOMINAL_V * 3600.0f;
+    p.daysLeft = p.remainingMj / p.dailyMj;
+    p.feedsLeft = (uint32_t)(p.daysLeft * feedsPerDay);
+    return p;
+}
+
+void printEnergyProjection(const EnergyProjection &projection) {
+    Serial.printf("Phase costs: sleep %.0f J/day, wake %.0f mJ%s, dispense %.0f mJ%s, portal %.0f mJ/min%s\n",
+                  sleepCostMjPerDay() / 1000.0f,
+                  wakeCostMj(), energyCosts.wakeMj > 0 ? "" : " (est.)",
+                  dispenseCostMj(), energyCosts.dispenseMj > 0 ? "" : " (est.)",
+                  apMinuteCostMj(), energyCosts.apMinuteMj > 0 ? "" : " (est.)");
+    Serial.printf("%.1f feeds/day uses %.0f J/day; %.0f J left lasts %.1f days (%lu feeds)\n",
+                  projection.feedsPerDay, projection.dailyMj / 1000.0f, projection.remainingMj / 1000.0f,
+                  projection.daysLeft, (unsigned long)projection.feedsLeft);
+}
+
+// ========================================
+// Measurements
+// ========================================
+
+void recordDispenseEnergy(float energyMj) {
+    foldCost(energyCosts.dispenseMj, energyMj);
+}
+
+void recordScheduledWake(uint32_t awakeMs, uint32_t moveMs) {
+    if (awakeMs <= moveMs) return;
+    // Nothing samples the supply on a scheduled wake; the time awake
+    // around the move is measured and charged at the awake current
+    foldCost(energyCosts.wakeMj, (awakeMs - moveMs) / 1000.0f * ENERGY_AWAKE_MA * BATTERY_NOMINAL_V);
+}
+
+void energyModelTick() {
+    static uint32_t lastSampledAt = 0;
+    if (!apModeActive || !batteryReading.valid || batteryReading.sampledAt == lastSampledAt) return;
+    lastSampledAt = batteryReading.sampledAt;
+
+    // Samples from before the AP started or during a move would charge the
+    // idle CPU or the servo to the portal
+    if (batteryReading.sampledAt < apStartTime || servoPowered()) return;
+    foldCost(energyCosts.apMinuteMj, batteryReading.busVoltage * batteryReading.currentMa * 60.0f);
+}
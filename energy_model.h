@@ -0,0 +1,50 @@
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "scheduler.h"
+
+// ========================================
+// Energy Model
+// ========================================
+// Projects battery life from the cost of each phase of the feeder's day:
+// deep sleep, a scheduled wake, the move it makes and minutes of portal
+// use. The config.h estimates are replaced by measurements as they come
+// in (the current capture for moves, the wake timing for scheduled wakes
+// and background battery samples while the portal is open) and kept in
+// energyCosts across deep sleep.
+
+// Current cost of each phase (mJ), measured or estimated
+float dispenseCostMj();
+float wakeCostMj();
+float apMinuteCostMj();
+float sleepCostMjPerDay();
+
+// Cost (mJ) of waiting seconds for the next trigger after a scheduled
+// dispense: the extra draw of staying awake or light sleeping for that
+// long (plus getting in and out of light sleep), or a full boot (ROM
+// start-up plus the measured wake) for deep sleep
+float waitCostMj(SleepChoice choice, uint32_t seconds);
+
+// Triggers under SLEEP_MIN_SECONDS away are always waited for awake
+SleepChoice cheapestWait(uint32_t seconds);
+
+// Feeds per day of a schedule. Set times count the active alarms across
+// the week; the interval modes fire once per interval.
+float setTimesFeedsPerDay();
+float intervalFeedsPerDay(uint32_t intervalSeconds);
+float scheduleFeedsPerDay(ScheduleMode mode);
+
+EnergyProjection projectEnergy(float feedsPerDay, float apMinutesPerDay = ENERGY_AP_MINUTES_PER_DAY);
+void printEnergyProjection(const EnergyProjection &projection);
+
+// Measurements
+void recordDispenseEnergy(float energyMj);
+void recordScheduledWake(uint32_t awakeMs, uint32_t moveMs);
+
+// Folds portal battery samples into the AP cost; call from loop()
+void energyModelTick();
+
+#endif // ENERGY_MODEL_H
@@ -3,7 +3,7 @@
 // ========================================
 
 #include <WiFi.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <DNSServer.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
@@ -22,6 +22,11 @@
 #include "alarm_manager.h"
 #include "power_management.h"
 #include "web_server.h"
+#include "rtc_state.h"
+#include "scheduler.h"
+#include "energy_model.h"
+#include "boot_profile.h"
+#include "button_ulp.h"
 
 // ========================================
 // Global Variable Definitions
@@ -30,12 +35,14 @@
 // Hardware objects
 Servo myServo;
 Adafruit_INA219 ina219;
+bool currentSensorFound = false;
 RTC_DS3231 rtc;
-WebServer server(80);
+AsyncWebServer server(80);
+AsyncEventSource statusEvents("/api/stream");
 DNSServer dnsServer;
 
 // Data structures
-std::vector<EventLog> eventHistory;
+EventHistory eventHistory;
 std::vector<Alarm> alarms;
 ModeConfig modeConfig;
 
@@ -45,47 +52,154 @@ int maxCompartment = MAX_COMPARTMENTS;
 unsigned long apStartTime = 0;
 bool apModeActive = false;
 String currentSSID = DEFAULT_SSID;
+BatteryReading batteryReading = {false, 0, 0, 0, 0, 0};
+
+// Shared with the web handlers on the async_tcp task
+std::recursive_mutex stateMutex;
+volatile bool sleepRequested = false;
+
+// Timing of the last scheduled dispense, kept across deep sleep
+RTC_DATA_ATTR ScheduledWakeTiming scheduledWakeTiming = {0, 0, 0};
+
+// Current trace features of the last dispense, kept across deep sleep
+RTC_DATA_ATTR DispenseCapture lastDispenseCapture = {0, 0, CAPTURE_NONE, 0, 0, 0, 0, 0, 0};
+
+// Measured costs for the battery-life projection, kept across deep sleep
+RTC_DATA_ATTR EnergyCosts energyCosts = {0, 0, 0};
+
+// ========================================
+// Scheduled Dispense Boot
+// ========================================
+// An RTC alarm wake only needs the servo position, mode and alarms to
+// dispense and arm the next alarm. The WiFi settings, the event log load
+// and the battery check are left to button and reset boots. When
+// the next trigger is close enough that another boot would cost more than
+// waiting for it, the feeder waits in-process and dispenses again; it only
+// returns if the button is pressed while it waits.
+
+void runScheduledWake() {
+    Serial.println("\nRTC alarm wake - triggering scheduled event...");
+
+    releaseWakeUlp();
+    pinMode(RTC_ALARM_PIN, INPUT_PULLUP);
+    pinMode(BUTTON_PIN, INPUT);
+    pinMode(LED_PIN, OUTPUT);
+    pinMode(SERVO_TRANSISTOR_PIN, OUTPUT);
+
+    // The motion engine powers the servo for the dispense
+    digitalWrite(SERVO_TRANSISTOR_PIN, LOW);
+
+    bootPhaseBegin(BOOT_PHASE_FS);
+    if (!LittleFS.begin(true)) {
+        Serial.println("LittleFS Mount Failed");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_FS_STARTUP_ERROR);
+    }
+    bootPhaseEnd(BOOT_PHASE_FS);
+
+    bootPhaseBegin(BOOT_PHASE_RTC);
+    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+    if (!rtc.begin(&Wire)) {
+        Serial.println("RTC not found!");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_RTC_STARTUP_ERROR);
+    } else {
+        rtc.clearAlarm(1);
+        rtc.clearAlarm(2);
+    }
+    bootPhaseEnd(BOOT_PHASE_RTC);
+
+    // Needed for the current capture during the move
+    bootPhaseBegin(BOOT_PHASE_INA219);
+    currentSensorFound = ina219.begin();
+    bootPhaseEnd(BOOT_PHASE_INA219);
+
+    bootPhaseBegin(BOOT_PHASE_STATE);
+    loadSchedulerState();
+    bootPhaseEnd(BOOT_PHASE_STATE);
+
+    bool firstDispense = true;
+    for (;;) {
+        uint32_t currentUnix = rtc.now().unixtime();
+
+        // Nothing else runs on this wake, so just drive the move to completion
+        bootPhaseBegin(BOOT_PHASE_DISPENSE);
+        triggerActivation();
+        waitForMotion();
+        bootPhaseEnd(BOOT_PHASE_DISPENSE);
+        if (firstDispense) {
+            scheduledWakeTiming.timestamp = currentUnix;
+            scheduledWakeTiming.wakeToDispenseMs = millis();
+            firstDispense = false;
+        }
+
+        // Advance the active mode past this trigger
+        bootPhaseBegin(BOOT_PHASE_SCHEDULE);
+        scheduleFired(currentUnix);
+        configureNextWake();
+        bootPhaseEnd(BOOT_PHASE_SCHEDULE);
+
+        uint32_t nowUnix = rtc.now().unixtime();
+        uint32_t wakeUnix = nextWakeUnix(nowUnix);
+        if (wakeUnix == 0) break;
+
+        SleepChoice choice = chooseSleep(wakeUnix - nowUnix);
+        if (choice == SLEEP_DEEP) break;
+        if (!waitForTrigger(choice, wakeUnix)) return;
+    }
+
+    enterDeepSleep();
+}
 
 // ========================================
 // Setup
 // ========================================
 void setup() {
     Serial.begin(115200);
+    startBootProfile();
+
+    // Check wake reason
+    esp_sleep_wakeup_cause_t wakeup_reason = wakeupCause();
+
+    // Scheduled dispenses take the short path; it only comes back here if
+    // the button was pressed between triggers, which boots like a button
+    // wake (an unqualified one if it was seen while staying awake)
+    if (wakeup_reason == ESP_SLEEP_WAKEUP_EXT0) {
+        runScheduledWake();
+        wakeup_reason = wakeupCause();
+        if (wakeup_reason == ESP_SLEEP_WAKEUP_EXT0) wakeup_reason = ESP_SLEEP_WAKEUP_EXT1;
+    }
+
     delay(1000);
     
     Serial.println("\n\n=== ESP32 Alarm System Starting ===");
     
     // Configure pins
+    releaseWakeUlp();
     pinMode(RTC_ALARM_PIN, INPUT_PULLUP);
     pinMode(BUTTON_PIN, INPUT);
     pinMode(LED_PIN, OUTPUT);
     pinMode(SERVO_TRANSISTOR_PIN, OUTPUT);
 
-    // Turn on servo transistor
-    digitalWrite(SERVO_TRANSISTOR_PIN, HIGH);
-
-    // Initialize servo
-    myServo.attach(SERVO_PIN);
-    myServo.setPeriodHertz(50);
+    // The servo stays unpowered until a move needs it (servoPowerUp)
+    digitalWrite(SERVO_TRANSISTOR_PIN, LOW);
 
     // Start file system
+    bootPhaseBegin(BOOT_PHASE_FS);
     if (!LittleFS.begin(true)) {
         Serial.println("LittleFS Mount Failed");
-        logEvent("ERROR", "System", "Flash Memory (LittleFS) error on startup");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_FS_STARTUP_ERROR);
         return;
     }
+    bootPhaseEnd(BOOT_PHASE_FS);
     Serial.println("LittleFS mounted");
-    
-    // Check wake reason
-    esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
 
     // Initialize I2C
+    bootPhaseBegin(BOOT_PHASE_RTC);
     Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
 
     // Initialize RTC
     if (!rtc.begin(&Wire)) {
         Serial.println("RTC not found!");
-        logEvent("ERROR", "System", "RTC communication error on startup - clock may have lost power");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_RTC_STARTUP_ERROR);
     } else {
         Serial.println("RTC initialized");
         
@@ -102,44 +216,54 @@ void setup() {
         Serial.printf("Current RTC time: %02d:%02d:%02d\n", 
                       now.hour(), now.minute(), now.second());
     }
+    bootPhaseEnd(BOOT_PHASE_RTC);
 
     // Initialize battery sensor
-    if (!ina219.begin()) {
+    bootPhaseBegin(BOOT_PHASE_INA219);
+    currentSensorFound = ina219.begin();
+    if (!currentSensorFound) {
         Serial.println("Failed to find INA219 chip");
-        logEvent("ERROR", "System", "Failed to find INA219 (battery sensor) on startup");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_INA219_NOT_FOUND);
     } else {
         Serial.println("INA219 (Battery Sensor) Found");
         runBatteryCheck();
     }
+    bootPhaseEnd(BOOT_PHASE_INA219);
 
     // Load configuration from storage
-    loadCompartmentPosition();
+    bootPhaseBegin(BOOT_PHASE_STATE);
+    loadSchedulerState();
+    bootPhaseEnd(BOOT_PHASE_STATE);
+
+    bootPhaseBegin(BOOT_PHASE_WIFI_SETTINGS);
     loadWiFiSettings();
-    initSettings();
-    alarms.clear();
-    loadAlarms();
-    loadModeConfig();
+    bootPhaseEnd(BOOT_PHASE_WIFI_SETTINGS);
+
+    bootPhaseBegin(BOOT_PHASE_EVENTS);
     loadEventsFromFile();
+    bootPhaseEnd(BOOT_PHASE_EVENTS);
     
     // Handle wake reason
     Serial.print("Wake reason: ");
     switch(wakeup_reason) {
-        case ESP_SLEEP_WAKEUP_EXT0:
-            Serial.println("RTC Alarm");
-            apModeActive = false;
-            break;
-            
+        case ESP_SLEEP_WAKEUP_ULP:
         case ESP_SLEEP_WAKEUP_EXT1:
             Serial.println("Button wake detected - starting AP mode");
-            delay(300);
-            
-            // If button is still low after delay, false alarm -> go back to sleep
-            if (digitalRead(BUTTON_PIN) == 0) {
-                configureNextWake();
-                enterDeepSleep();
+
+            // The ULP has already seen the button held for
+            // BUTTON_LONG_PRESS_MS; an ext1 wake (the fallback when the ULP
+            // could not start) comes from any contact, so check it here
+            if (wakeup_reason == ESP_SLEEP_WAKEUP_EXT1) {
+                delay(BUTTON_LONG_PRESS_MS);
+                
+                // If button is still low after delay, false alarm -> go back to sleep
+                if (digitalRead(BUTTON_PIN) == 0) {
+                    configureNextWake();
+                    enterDeepSleep();
+                }
             }
 
-            logEvent("SUCCESS", "System", "System started/woke from sleep");
+            logEvent(EVENT_SUCCESS, EVENT_MODE_SYSTEM, MSG_WOKE_FROM_SLEEP);
             apModeActive = true;
             apStartTime = millis();
             break;
@@ -151,51 +275,28 @@ void setup() {
         case ESP_SLEEP_WAKEUP_UNDEFINED:
         default:
             Serial.println("Not from deep sleep (first boot or reset)");
-            logEvent("SUCCESS", "System", "Initial system start");
+            logEvent(EVENT_SUCCESS, EVENT_MODE_SYSTEM, MSG_INITIAL_START);
             apModeActive = true;
             apStartTime = millis();
             break;
     }
     
-    // If woken by RTC alarm, trigger event and go back to sleep
-    if (wakeup_reason == ESP_SLEEP_WAKEUP_EXT0) {
-        Serial.println("\nRTC alarm wake - triggering scheduled event...");
-
-        DateTime now = rtc.now();
-        uint32_t currentUnix = now.unixtime();
-        
-        triggerActivation();
-        
-        // Update trigger times based on mode
-        if (modeConfig.activeMode == "set_times") {
-            Serial.println("Set times mode - no update needed");
-        }
-        else if (modeConfig.activeMode == "regular_interval") {
-            modeConfig.regIntervalLastTriggerUnix = currentUnix;
-            saveModeConfig();
-            Serial.printf("Updated last trigger to: %lu\n", currentUnix);
-        }
-        else if (modeConfig.activeMode == "random_interval") {
-            calculateNextRandomInterval();
-        }
-        
-        // Go back to sleep immediately after triggering
-        configureNextWake();
-        delay(1000);
-        enterDeepSleep();
-    }
-    
     // Start AP mode if needed
     if (apModeActive) {
+        bootPhaseBegin(BOOT_PHASE_PORTAL);
         setupCaptivePortal();
         registerRoutes();
         server.begin();
+        bootPhaseEnd(BOOT_PHASE_PORTAL);
         digitalWrite(LED_PIN, HIGH);
         
         Serial.println("Web server started.");
-        Serial.printf("AP mode will timeout in %lu minutes\n", AP_TIMEOUT_MS / 60000);
+        Serial.printf("AP mode will timeout in %lu minutes (%lu without a client)\n",
+                      AP_TIMEOUT_MS / 60000, AP_IDLE_GRACE_MS / 60000);
     }
-    
+
+    finishBootProfile();
+    printBootProfiles();
     Serial.println("================================");
 }
 
@@ -204,17 +305,38 @@ void setup() {
 // ========================================
 void loop() {
     if (apModeActive) {
-        // Handle web server in AP mode
+        // Web requests are served by the async server; the loop answers
+        // DNS and drives the servo, schedule and background work
         dnsServer.processNextRequest();
-        server.handleClient();
-        checkTriggers();
+        {
+            std::lock_guard<std::recursive_mutex> lock(stateMutex);
+            servoTick();
+            checkTriggers();
+            flushDirty();
+            sampleBattery();
+            energyModelTick();
+            publishStatus();
+        }
         
-        // Check if AP timeout has expired
-        if (millis() - apStartTime >= AP_TIMEOUT_MS) {
-            Serial.println("\n>>> AP mode timeout - preparing for sleep <<<");
+        // Check if AP timeout has expired, the portal has been left unused
+        // or sleep was requested
+        bool timedOut = millis() - apStartTime >= AP_TIMEOUT_MS;
+        bool idle = portalIdle();
+        if (timedOut || idle || sleepRequested) {
+            if (timedOut) {
+                Serial.println("\n>>> AP mode timeout - preparing for sleep <<<");
+            } else if (idle) {
+                Serial.printf("\n>>> No client for %lu minutes - preparing for sleep <<<\n", AP_IDLE_GRACE_MS / 60000);
+            } else {
+                delay(500);  // Let the /api/sleep reply go out
+            }
             
-            // Shutdown cleanly
-            server.stop();
+            // Shutdown cleanly, letting a dispense in progress finish first
+            server.end();
+            {
+                std::lock_guard<std::recursive_mutex> lock(stateMutex);
+                waitForMotion();
+            }
             WiFi.softAPdisconnect(true);
             WiFi.mode(WIFI_OFF);
             digitalWrite(LED_PIN, LOW);
@@ -240,5 +362,6 @@ void loop() {
         enterDeepSleep();
     }
     
-    delay(100);
+    // Ramp steps are due every SERVO_RAMP_STEP_MS while the servo moves
+    delay(servoBusy() ? 1 : 100);
 }
@@ -0,0 +1,30 @@
+#ifndef HOST_ADAFRUIT_INA219_H
+#define HOST_ADAFRUIT_INA219_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define INA219_ADDRESS (0x40)
+
+// Readings come from the host battery/load model; each read costs
+// simulated I2C bus time.
+class Adafruit_INA219 {
+public:
+    Adafruit_INA219(uint8_t addr = INA219_ADDRESS) : _addr(addr) {}
+
+    bool begin(TwoWire *theWire = &Wire);
+    void setCalibration_32V_2A() {}
+    void setCalibration_32V_1A() {}
+    void setCalibration_16V_400mA() {}
+    float getBusVoltage_V();
+    float getShuntVoltage_mV();
+    float getCurrent_mA();
+    float getPower_mW();
+    void powerSave(bool on) { (void)on; }
+    bool success() { return true; }
+
+private:
+    uint8_t _addr;
+};
+
+#endif // HOST_ADAFRUIT_INA219_H
@@ -0,0 +1,21 @@
+#ifndef HOST_DNSSERVER_H
+#define HOST_DNSSERVER_H
+
+#include "Arduino.h"
+
+// Captive-portal DNS has nothing to answer on the host.
+class DNSServer {
+public:
+    bool start(const uint16_t port, const String &domainName, const IPAddress &resolvedIP) {
+        (void)port; (void)domainName; (void)resolvedIP;
+        _running = true;
+        return true;
+    }
+    void processNextRequest() {}
+    void stop() { _running = false; }
+
+private:
+    bool _running = false;
+};
+
+#endif // HOST_DNSSERVER_H
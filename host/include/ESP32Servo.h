@@ -0,0 +1,30 @@
+#ifndef HOST_ESP32SERVO_H
+#define HOST_ESP32SERVO_H
+
+#include "Arduino.h"
+
+#define DEFAULT_uS_LOW 544
+#define DEFAULT_uS_HIGH 2400
+
+// Pulses are recorded in the host device model instead of driving a pin.
+class Servo {
+public:
+    int attach(int pin);
+    int attach(int pin, int min, int max);
+    void detach();
+    void write(int value);
+    void writeMicroseconds(int value);
+    int read();
+    int readMicroseconds();
+    bool attached();
+    void setPeriodHertz(int hertz) { _hertz = hertz; }
+
+private:
+    int _pin = -1;
+    int _min = DEFAULT_uS_LOW;
+    int _max = DEFAULT_uS_HIGH;
+    int _hertz = 50;
+    int _pulse = 0;
+};
+
+#endif // HOST_ESP32SERVO_H
@@ -0,0 +1,263 @@
+#ifndef HOST_ESPASYNCWEBSERVER_H
+#define HOST_ESPASYNCWEBSERVER_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "FS.h"
+
+// ========================================
+// ESPAsyncWebServer (host implementation)
+// ========================================
+// The subset of the ESPAsyncWebServer API the firmware uses. As on the
+// ESP32, where AsyncTCP runs handlers on its own task, the server runs on
+// its own thread: begin() starts it, and it multiplexes every connection
+// with poll(), keeps HTTP/1.1 connections alive and pulls chunked
+// responses from their filler as the socket drains. The listening socket
+// is bound to 127.0.0.1 on the port given to feeder_host.
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index,
+                           uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len,
+                           size_t index, size_t total)> ArBodyHandlerFunction;
+typedef std::function<void(void)> ArDisconnectHandler;
+
+// Fills buffer with up to maxLen bytes of the body starting at index;
+// returns 0 at the end or RESPONSE_TRY_AGAIN if nothing is ready yet
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String &name, const String &value) : _name(name), _value(value) {}
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+// Headers added to every response
+class DefaultHeaders {
+public:
+    static DefaultHeaders &Instance();
+    void addHeader(const String &name, const String &value) { _headers.emplace_back(name, value); }
+    const std::vector<AsyncWebHeader> &headers() const { return _headers; }
+
+private:
+    std::vector<AsyncWebHeader> _headers;
+};
+
+// ========================================
+// Responses
+// ========================================
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code, const String &contentType);
+    virtual ~AsyncWebServerResponse() {}
+
+    void setCode(int code) { _code = code; }
+    void addHeader(const String &name, const String &value) { _headers.emplace_back(name, value); }
+    void setContentLength(size_t len) { _contentLength = len; }
+
+    // Host side: the status line and headers, then the body piece by piece
+    String _head(bool keepAlive) const;
+    virtual size_t _fill(uint8_t *buffer, size_t maxLen) = 0;
+    virtual bool _chunked() const { return false; }
+    // Body with no length that runs until the connection closes
+    virtual bool _unbounded() const { return false; }
+    int _statusCode() const { return _code; }
+
+protected:
+    int _code;
+    String _contentType;
+    size_t _contentLength = 0;
+    std::vector<AsyncWebHeader> _headers;
+    size_t _sent = 0;
+};
+
+// ========================================
+// Requests
+// ========================================
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest();
+    ~AsyncWebServerRequest();
+
+    // Scratch pointer owned by the request, released with free()
+    void *_tempObject = nullptr;
+
+    const String &url() const { return _url; }
+    WebRequestMethodComposite method() const { return _method; }
+    const char *methodToString() const;
+
+    size_t params() const { return _params.size(); }
+    bool hasParam(const String &name, bool post = false, bool file = false) const;
+    AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const;
+    bool hasHeader(const String &name) const;
+    AsyncWebHeader *getHeader(const String &name) const;
+
+    void send(AsyncWebServerResponse *response);
+    void send(int code, const String &contentType = String(), const String &content = String());
+    void send(fs::FS &fs, const String &path, const String &contentType = String());
+    void redirect(const String &url);
+
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(),
+                                          const String &content = String());
+    AsyncWebServerResponse *beginResponse_P(int code, const String &contentType,
+                                            const uint8_t *content, size_t len);
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller callback);
+
+    void onDisconnect(ArDisconnectHandler fn) { _onDisconnect = fn; }
+
+private:
+    friend class AsyncWebServer;
+    friend struct HostConnection;
+
+    String _url;
+    WebRequestMethodComposite _method = HTTP_GET;
+    std::vector<std::unique_ptr<AsyncWebParameter>> _params;
+    std::vector<std::unique_ptr<AsyncWebHeader>> _requestHeaders;
+    std::unique_ptr<AsyncWebServerResponse> _response;
+    ArDisconnectHandler _onDisconnect;
+    bool _keepAlive = true;
+};
+
+// ========================================
+// Handlers
+// ========================================
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest *request) = 0;
+    virtual void handleRequest(AsyncWebServerRequest *request) = 0;
+};
+
+// ========================================
+// Server-Sent Events
+// ========================================
+// Each client is a long-lived text/event-stream response. send() may be
+// called from loop() while the server thread drains the queued messages.
+
+class AsyncEventSource;
+
+class AsyncEventSourceClient {
+public:
+    AsyncEventSourceClient(AsyncWebServerRequest *request, AsyncEventSource *server);
+
+    void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+    void close();
+    bool connected() const;
+    uint32_t lastId() const { return _lastId; }
+
+    // Host side: moves queued bytes out; 0 once closed and drained
+    size_t _drain(uint8_t *buffer, size_t maxLen);
+    void _write(const std::string &message);
+
+private:
+    AsyncEventSource *_server;
+    uint32_t _lastId = 0;
+    mutable std::mutex _lock;
+    std::string _queue;
+    bool _closed = false;
+};
+
+typedef std::function<void(AsyncEventSourceClient *client)> ArEventHandlerFunction;
+
+class AsyncEventSource : public AsyncWebHandler {
+public:
+    AsyncEventSource(const String &url) : _url(url) {}
+
+    void onConnect(ArEventHandlerFunction cb) { _connectcb = cb; }
+    void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+    void close();
+    size_t count() const;
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+
+    // Host side: called when a client's response goes away
+    void _removeClient(AsyncEventSourceClient *client);
+
+private:
+    String _url;
+    ArEventHandlerFunction _connectcb;
+    mutable std::mutex _lock;
+    std::vector<std::unique_ptr<AsyncEventSourceClient>> _clients;
+};
+
+// ========================================
+// Server
+// ========================================
+
+class AsyncWebServer {
+public:
+    AsyncWebServer(uint16_t port);
+    ~AsyncWebServer();
+
+    void begin();
+    void end();
+
+    void on(const char *uri, ArRequestHandlerFunction onRequest);
+    void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody = nullptr);
+    AsyncWebHandler &addHandler(AsyncWebHandler *handler);
+    void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+
+    // Host side: runs the matching handler for a parsed request
+    void _dispatch(AsyncWebServerRequest *request, std::string &body);
+
+private:
+    struct Route {
+        String uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction onRequest;
+        ArBodyHandlerFunction onBody;
+        AsyncWebHandler *handler;
+    };
+
+    void _run();
+
+    uint16_t _port;
+    std::vector<Route> _routes;
+    ArRequestHandlerFunction _notFound;
+    struct HostServerThread *_thread = nullptr;
+};
+
+#endif // HOST_ESPASYNCWEBSERVER_H
@@ -0,0 +1,89 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <memory>
+#include <string>
+#include "Arduino.h"
+
+// ========================================
+// fs::FS and fs::File (host implementation)
+// ========================================
+// Paths are rooted in a directory on the host; see host_hal.h.
+
+namespace fs {
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File : public Stream {
+public:
+    File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t *buf, size_t size);
+    size_t readBytes(char *buffer, size_t length) override { return read((uint8_t *)buffer, length); }
+
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char *path() const;
+    const char *name() const;
+
+    bool isDirectory();
+    File openNextFile(const char *mode = FILE_READ);
+    void rewindDirectory();
+
+private:
+    FileImplPtr _p;
+};
+
+class FS {
+public:
+    File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+    File open(const String &path, const char *mode = FILE_READ, const bool create = false);
+
+    bool exists(const char *path);
+    bool exists(const String &path);
+    bool remove(const char *path);
+    bool remove(const String &path);
+    bool rename(const char *pathFrom, const char *pathTo);
+    bool rename(const String &pathFrom, const String &pathTo);
+    bool mkdir(const char *path);
+    bool mkdir(const String &path);
+    bool rmdir(const char *path);
+    bool rmdir(const String &path);
+
+protected:
+    bool _mounted = false;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif // HOST_FS_H
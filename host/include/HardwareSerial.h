@@ -0,0 +1,26 @@
+#ifndef HOST_HARDWARESERIAL_H
+#define HOST_HARDWARESERIAL_H
+
+#include "Print.h"
+
+// Serial output goes to stdout; nothing is ever received.
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_HARDWARESERIAL_H
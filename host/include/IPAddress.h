@@ -0,0 +1,22 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+    IPAddress() : _addr{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return _addr[index]; }
+    bool operator==(const IPAddress &rhs) const;
+
+    String toString() const;
+    size_t printTo(Print &p) const override;
+
+private:
+    uint8_t _addr[4];
+};
+
+#endif // HOST_IPADDRESS_H
@@ -0,0 +1,28 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+
+// NVS key/value store. Each key of a namespace is one file under
+// hostFsRoot()/.nvs/<namespace>/, written whole through a rename like an
+// NVS entry. Only the blob calls the firmware uses are provided.
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+    void end();
+
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putBytes(const char *key, const void *value, size_t len);
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+    String _dir;
+    bool _started = false;
+    bool _readOnly = false;
+};
+
+#endif // HOST_PREFERENCES_H
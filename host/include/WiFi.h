@@ -0,0 +1,27 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+// The soft AP is simulated: no radio, the HTTP server listens on localhost.
+class WiFiClass {
+public:
+    bool softAP(const char *ssid, const char *passphrase = NULL, int channel = 1,
+                int ssid_hidden = 0, int max_connection = 4);
+    bool softAPdisconnect(bool wifioff = false);
+    IPAddress softAPIP();
+    uint8_t softAPgetStationNum();
+    bool mode(wifi_mode_t m);
+    wifi_mode_t getMode();
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
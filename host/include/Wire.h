@@ -0,0 +1,23 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+        (void)sda; (void)scl; (void)frequency;
+        _running = true;
+        return true;
+    }
+    bool end() { _running = false; return true; }
+    bool setClock(uint32_t frequency) { (void)frequency; return true; }
+    bool running() const { return _running; }
+
+private:
+    bool _running = false;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
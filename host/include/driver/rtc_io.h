@@ -0,0 +1,21 @@
+#ifndef HOST_DRIVER_RTC_IO_H
+#define HOST_DRIVER_RTC_IO_H
+
+#include "esp_sleep.h"
+
+typedef enum {
+    RTC_GPIO_MODE_INPUT_ONLY,
+    RTC_GPIO_MODE_OUTPUT_ONLY,
+    RTC_GPIO_MODE_INPUT_OUTPUT,
+    RTC_GPIO_MODE_DISABLED
+} rtc_gpio_mode_t;
+
+// RTC IO number of a GPIO, or -1 if it has none
+int rtc_io_number_get(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_init(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_deinit(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_set_direction(gpio_num_t gpio_num, rtc_gpio_mode_t mode);
+esp_err_t rtc_gpio_pullup_en(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t gpio_num);
+
+#endif // HOST_DRIVER_RTC_IO_H
@@ -0,0 +1,41 @@
+#ifndef HOST_ESP32_ULP_H
+#define HOST_ESP32_ULP_H
+
+#include "esp_sleep.h"
+
+// The host never executes ULP code. ulp_run() only records that the
+// wake program is sampling, and hostNextWake() runs button_debounce.h
+// on the simulated button and watches the RTC alarm in its place. The instruction macros expand to
+// empty instructions, so their register and field arguments are never
+// evaluated.
+
+typedef struct {
+    uint32_t word;
+} ulp_insn_t;
+
+enum { R0, R1, R2, R3 };
+
+#define I_MOVI(...) ulp_insn_t{0}
+#define I_ADDI(...) ulp_insn_t{0}
+#define I_SUBI(...) ulp_insn_t{0}
+#define I_LD(...) ulp_insn_t{0}
+#define I_ST(...) ulp_insn_t{0}
+#define I_RD_REG(...) ulp_insn_t{0}
+#define I_WR_REG(...) ulp_insn_t{0}
+#define I_WAKE() ulp_insn_t{0}
+#define I_END() ulp_insn_t{0}
+#define I_HALT() ulp_insn_t{0}
+#define M_LABEL(...) ulp_insn_t{0}
+#define M_BL(...) ulp_insn_t{0}
+#define M_BGE(...) ulp_insn_t{0}
+#define M_BX(...) ulp_insn_t{0}
+
+// RTC slow memory as seen by the main cores
+extern uint32_t hostRtcSlowMem[];
+#define RTC_SLOW_MEM hostRtcSlowMem
+
+esp_err_t ulp_process_macros_and_load(uint32_t load_addr, const ulp_insn_t *program, size_t *psize);
+esp_err_t ulp_set_wakeup_period(size_t period_index, uint32_t period_us);
+esp_err_t ulp_run(uint32_t entry_point);
+
+#endif // HOST_ESP32_ULP_H
@@ -0,0 +1,230 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+// ========================================
+// Host Hardware Abstraction Layer
+// ========================================
+// Everything the simulated board keeps across a deep sleep lives in one
+// HostDevice block shared between host_main.cpp and the forked process
+// that runs setup()/loop(). Each simulated boot is a fresh fork, so
+// ordinary globals are reset exactly as on the ESP32, while the virtual
+// clock, DS3231 registers, RTC slow memory and the flash directory persist.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HOST_RTC_MEMORY_SIZE 8192
+#define HOST_MAX_BUTTON_PRESSES 64
+#define HOST_MAX_SIM_DAYS 3660
+
+struct HostRtcChip {
+    int64_t offsetSeconds;      // RTC unix time = offsetSeconds + clock seconds
+    bool oscillatorStopped;
+    uint8_t sqwMode;
+    uint32_t alarm1Unix;
+    uint8_t alarm1Mode;
+    bool alarm1Enabled;
+    bool alarm1Fired;
+    uint32_t alarm2Unix;
+    uint8_t alarm2Mode;
+    bool alarm2Enabled;
+    bool alarm2Fired;
+    uint32_t lastEvaluatedUnix; // alarm flags are up to date until here
+};
+
+struct HostSleepConfig {
+    bool ext0Enabled;
+    int ext0Pin;
+    int ext0Level;
+    bool ext1Enabled;
+    uint64_t ext1Mask;
+    int ext1Mode;
+    bool timerEnabled;
+    uint64_t timerUs;
+    bool ulpEnabled;            // ULP wake source
+    bool ulpRunning;            // Wake program loaded and sampling
+    uint32_t ulpPeriodUs;
+    uint64_t rtcInputMask;      // GPIOs handed to the RTC IO mux, readable by the ULP
+};
+
+struct HostFlashStats {
+    uint32_t filesOpenedForWrite;
+    uint32_t bytesWritten;
+    uint32_t filesRead;
+    uint32_t bytesRead;
+};
+
+struct HostServoModel {
+    bool attached;
+    int pulseUs;
+    uint64_t moveStartUs;
+    uint64_t moveEndUs;
+    uint32_t moves;
+    bool jammed;           // Moves never finish, so the servo draws stall current
+};
+
+struct HostBatteryModel {
+    float openCircuitV;
+    float internalOhms;
+    float idleMa;
+    float apMa;
+    float servoHoldMa;
+    float servoMoveMa;
+    float lightSleepMa;
+};
+
+// Energy drawn from the pack while awake (deep sleep is not modelled).
+// Volts x mA x s, so the totals are in millijoules.
+struct HostEnergyMeter {
+    uint64_t accountedUs;  // The load is integrated up to this clock time
+    double bootMj;
+    double servoBootMj;    // Share drawn through the servo transistor
+    double totalMj;
+    double servoTotalMj;
+};
+
+// Totals for one calendar day of a --days run
+struct HostDayStats {
+    uint32_t wakes;             // Boots out of deep sleep or reset
+    uint32_t lightWakes;
+    uint32_t dispenses;
+    uint32_t flashFilesWritten;
+    uint32_t flashBytesWritten;
+    uint32_t alarmMismatches;   // RTC alarm woke at another time than programmed
+    double energyMj;
+};
+
+struct HostDevice {
+    // Virtual clock (microseconds since the simulation started)
+    uint64_t clockUs;
+    uint64_t bootStartUs;
+    bool realtime;
+
+    // Boot bookkeeping
+    uint32_t bootCount;
+    int wakeCause;              // esp_sleep_wakeup_cause_t; EXT0 for any RTC alarm wake
+    bool wakeViaUlp;            // The ULP program woke the CPU, whichever pin it saw
+    bool sleepRequested;
+    bool simulationEnded;       // A light sleep ran past --boots or --until
+    HostSleepConfig sleep;
+
+    // Light sleep within the current boot
+    bool lightSleeping;
+    uint32_t lightSleeps;
+    uint64_t lightSleepUs;
+    uint32_t lightWakesTotal;   // Counted against --boots
+
+    // Peripherals
+    HostRtcChip rtc;
+    HostServoModel servo;
+    HostBatteryModel battery;
+    uint8_t pinLevel[40];
+    uint8_t pinMode[40];
+    bool wifiApActive;
+    uint8_t apStations;         // Clients associated while the AP is up
+    uint32_t rngState;
+
+    // Button presses (RTC unix times) and how long each is held, consumed
+    // as they are used
+    uint32_t buttonPresses[HOST_MAX_BUTTON_PRESSES];
+    uint32_t buttonPressHoldMs[HOST_MAX_BUTTON_PRESSES];
+    int buttonPressCount;
+    uint64_t buttonHeldUntilUs;
+
+    // Accounting
+    HostFlashStats flashBoot;
+    HostFlashStats flashTotal;
+    HostEnergyMeter energy;
+
+    // Dispenses and alarm checks
+    uint32_t countedJobId;      // Motion jobs of this boot already counted
+    uint32_t dispensesBoot;
+    uint32_t dispensesTotal;
+    uint32_t alarmMismatchesTotal;
+
+    // Per-day totals (--days); day 0 is the day of --epoch
+    uint32_t firstDay;
+    uint32_t simDays;
+    HostDayStats days[HOST_MAX_SIM_DAYS];
+
+    // RTC slow memory image (RTC_DATA_ATTR variables)
+    bool rtcMemoryValid;
+    uint32_t rtcMemorySize;
+    uint8_t rtcMemory[HOST_RTC_MEMORY_SIZE];
+
+    // Options
+    bool quiet;
+    bool traceHttp;
+    int httpPort;
+    char fsRoot[512];
+};
+
+extern HostDevice *hostDevice;
+
+// ========================================
+// Virtual clock
+// ========================================
+
+uint64_t hostClockMicros();
+void hostClockAdvance(uint64_t us);
+void hostClockReanchor();
+uint32_t hostRtcUnix();
+void hostRtcSet(uint32_t unixTime);
+
+// Bus cost of an I2C transaction, charged to the virtual clock.
+void hostI2CTransaction(uint32_t us);
+
+// ========================================
+// Peripheral control (tests and the /__host endpoints)
+// ========================================
+
+void hostPressButton(uint32_t atUnix, uint32_t holdMs);
+void hostSetBattery(float openCircuitV);
+float hostLoadCurrentMa();
+
+// Integrates the load up to now; the models call it before anything that
+// changes the load, so each stretch is charged at the current it drew.
+void hostEnergyAccrue();
+
+// Returns the RTC unix time of the next DS3231 alarm match at or after
+// fromUnix, or 0 if the alarm can never fire.
+uint32_t hostRtcNextAlarm(uint32_t fromUnix);
+void hostRtcUpdateFlags();
+
+// Earliest enabled wake source after the current time; returns false if
+// the device would sleep forever. For button wakes releaseUs is when the
+// press ends. An RTC alarm is reported as EXT0 even when the ULP program
+// delivers it; viaUlp tells the two apart.
+bool hostNextWake(uint64_t &wakeUs, int &cause, uint64_t &releaseUs, bool &viaUlp);
+
+// Makes the wake hostNextWake() picked the one the firmware sees; a ULP
+// wake also leaves its reason in RTC slow memory and stops the program.
+void hostDeliverWake(int cause, bool viaUlp);
+
+// Filesystem root helpers
+const char *hostFsRoot();
+void hostFlashCountWrite(size_t bytes, bool newFile);
+void hostFlashCountRead(size_t bytes, bool newFile);
+
+// Called as a file opened for writing is closed (--trace)
+void hostTraceFlashWrite(const char *path, size_t bytes);
+
+// Totals for the day containing unixTime, or nullptr outside a --days run
+HostDayStats *hostDayStats(uint32_t unixTime);
+
+// Handles /__host/* control requests; returns false for firmware routes.
+struct HostHttpReply {
+    int code;
+    const char *type;
+    char body[512];
+};
+bool hostHandleControl(const char *method, const char *uri, const char *query, HostHttpReply &reply);
+
+// Called by esp_deep_sleep_start() in the firmware process.
+[[noreturn]] void hostEndBoot();
+
+// Called by esp_light_sleep_start(); ends the boot instead if the
+// simulation would stop before the wake.
+void hostLightSleep();
+
+#endif // HOST_HAL_H
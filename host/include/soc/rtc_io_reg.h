@@ -0,0 +1,8 @@
+#ifndef HOST_SOC_RTC_IO_REG_H
+#define HOST_SOC_RTC_IO_REG_H
+
+// Only used as ULP instruction arguments, which the host ignores
+#define RTC_GPIO_IN_REG 0x3ff48424
+#define RTC_GPIO_IN_NEXT_S 14
+
+#endif // HOST_SOC_RTC_IO_REG_H
@@ -0,0 +1,306 @@
+#include "Arduino.h"
+#include "host_hal.h"
+#include "config.h"
+#include <malloc.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <mutex>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// ========================================
+// Virtual Clock
+// ========================================
+// In fast mode the clock only moves when the firmware waits (delay(),
+// bus transactions) or a test advances it. In realtime mode it also
+// follows the host's monotonic clock so request latency is measurable.
+// The web server thread reads it too, so updates are serialized.
+
+static uint64_t realAnchorUs = 0;
+static std::recursive_mutex clockMutex;
+
+static uint64_t monotonicMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+uint64_t hostClockMicros() {
+    std::lock_guard<std::recursive_mutex> lock(clockMutex);
+    if (!hostDevice->realtime) {
+        return hostDevice->clockUs;
+    }
+    uint64_t real = monotonicMicros();
+    if (realAnchorUs == 0) {
+        realAnchorUs = real;
+    }
+    // Fold elapsed real time into the shared clock so both views agree
+    hostDevice->clockUs += real - realAnchorUs;
+    realAnchorUs = real;
+    return hostDevice->clockUs;
+}
+
+void hostClockReanchor() {
+    std::lock_guard<std::recursive_mutex> lock(clockMutex);
+    realAnchorUs = 0;
+}
+
+void hostClockAdvance(uint64_t us) {
+    std::lock_guard<std::recursive_mutex> lock(clockMutex);
+    hostClockMicros();
+    hostDevice->clockUs += us;
+}
+
+void hostI2CTransaction(uint32_t us) {
+    hostClockAdvance(us);
+}
+
+unsigned long millis() {
+    return (unsigned long)((hostClockMicros() - hostDevice->bootStartUs) / 1000ULL);
+}
+
+unsigned long micros() {
+    return (unsigned long)(hostClockMicros() - hostDevice->bootStartUs);
+}
+
+void delay(uint32_t ms) {
+    if (hostDevice->realtime) {
+        usleep((useconds_t)ms * 1000);
+        hostClockMicros();
+    } else {
+        hostClockAdvance((uint64_t)ms * 1000ULL);
+    }
+}
+
+void delayMicroseconds(uint32_t us) {
+    if (hostDevice->realtime) {
+        usleep(us);
+        hostClockMicros();
+    } else {
+        hostClockAdvance(us);
+    }
+}
+
+void yield() {}
+
+// ========================================
+// GPIO
+// ========================================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < 40) hostDevice->pinMode[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin == SERVO_TRANSISTOR_PIN) hostEnergyAccrue();
+    if (pin < 40) hostDevice->pinLevel[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin == BUTTON_PIN) {
+        return hostClockMicros() < hostDevice->buttonHeldUntilUs ? HIGH : LOW;
+    }
+    if (pin == RTC_ALARM_PIN) {
+        // SQW/INT is open drain: pulled low while an enabled alarm is flagged
+        hostRtcUpdateFlags();
+        const HostRtcChip &rtc = hostDevice->rtc;
+        bool asserted = rtc.sqwMode == 0x1C &&
+                        ((rtc.alarm1Enabled && rtc.alarm1Fired) ||
+                         (rtc.alarm2Enabled && rtc.alarm2Fired));
+        return asserted ? LOW : HIGH;
+    }
+    if (pin < 40) return hostDevice->pinLevel[pin];
+    return LOW;
+}
+
+// ========================================
+// Random / Math
+// ========================================
+
+static uint32_t nextRandom() {
+    // xorshift32; state lives in HostDevice so each boot draws new values
+    uint32_t x = hostDevice->rngState ? hostDevice->rngState : 0x2545F491u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    hostDevice->rngState = x;
+    return x;
+}
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    return nextRandom() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) hostDevice->rngState = (uint32_t)seed;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    const long dividend = out_max - out_min;
+    const long divisor = in_max - in_min;
+    const long delta = x - in_min;
+    if (divisor == 0) return -1;
+    return (delta * dividend + (divisor / 2)) / divisor + out_min;
+}
+
+// ========================================
+// ESP object
+// ========================================
+
+#define HOST_HEAP_SIZE 327680U
+
+uint32_t EspClass::getHeapSize() { return HOST_HEAP_SIZE; }
+
+uint32_t EspClass::getFreeHeap() {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks >= HOST_HEAP_SIZE ? 0 : HOST_HEAP_SIZE - (uint32_t)mi.uordblks;
+}
+
+uint32_t EspClass::getMinFreeHeap() { return getFreeHeap(); }
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
+
+void EspClass::restart() {
+    hostDevice->wakeCause = 0;
+    hostDevice->wakeViaUlp = false;
+    hostEndBoot();
+}
+
+// ========================================
+// Print / Stream
+// ========================================
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (write(*buffer++)) n++;
+        else break;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+    char stackBuf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(stackBuf)) {
+        return write((const uint8_t *)stackBuf, len);
+    }
+    char *heapBuf = (char *)malloc(len + 1);
+    if (!heapBuf) return 0;
+    va_start(args, format);
+    vsnprintf(heapBuf, len + 1, format, args);
+    va_end(args);
+    size_t n = write((const uint8_t *)heapBuf, len);
+    free(heapBuf);
+    return n;
+}
+
+size_t Print::print(const __FlashStringHelper *str) { return write(reinterpret_cast<const char *>(str)); }
+size_t Print::print(const String &str) { return write(str.c_str(), str.length()); }
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(int value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(unsigned int value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(long value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(unsigned long value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(long long value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(unsigned long long value, int base) { return print(String(value, (unsigned char)base)); }
+size_t Print::print(double value, int digits) { return print(String(value, (unsigned int)digits)); }
+size_t Print::print(const Printable &value) { return value.printTo(*this); }
+
+size_t Print::println(void) { return write("\r\n"); }
+size_t Print::println(const __FlashStringHelper *str) { return print(str) + println(); }
+size_t Print::println(const String &str) { return print(str) + println(); }
+size_t Print::println(const char str[]) { return print(str) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char value, int base) { return print(value, base) + println(); }
+size_t Print::println(int value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned int value, int base) { return print(value, base) + println(); }
+size_t Print::println(long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long value, int base) { return print(value, base) + println(); }
+size_t Print::println(long long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long long value, int base) { return print(value, base) + println(); }
+size_t Print::println(double value, int digits) { return print(value, digits) + println(); }
+size_t Print::println(const Printable &value) { return print(value) + println(); }
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String ret;
+    char buf[256];
+    size_t n;
+    while ((n = readBytes(buf, sizeof(buf))) > 0) {
+        ret.concat(buf, n);
+    }
+    return ret;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String ret;
+    int c = timedRead();
+    while (c >= 0 && c != terminator) {
+        ret.concat((char)c);
+        c = timedRead();
+    }
+    return ret;
+}
+
+// ========================================
+// Serial
+// ========================================
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (hostDevice->quiet) return size;
+    // Strip the CR from println() so host logs read cleanly
+    for (size_t i = 0; i < size; i++) {
+        if (buffer[i] != '\r') fputc(buffer[i], stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+// ========================================
+// IPAddress
+// ========================================
+
+bool IPAddress::operator==(const IPAddress &rhs) const {
+    return memcmp(_addr, rhs._addr, sizeof(_addr)) == 0;
+}
+
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _addr[0], _addr[1], _addr[2], _addr[3]);
+    return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const {
+    return p.print(toString());
+}
@@ -0,0 +1,706 @@
+#include "ESPAsyncWebServer.h"
+#include "host_hal.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Idle keep-alive connections are closed after this long
+#define HOST_KEEPALIVE_MS 10000
+// Response bytes buffered per connection before waiting for the socket
+#define HOST_SEND_BUFFER 8192
+#define HOST_CHUNK_SIZE 1436
+#define HOST_MAX_CONNECTIONS 16
+// Event stream bytes held for a slow client before messages are dropped
+#define HOST_EVENT_QUEUE_LIMIT 16384
+
+// ========================================
+// Helpers
+// ========================================
+
+static const char *statusText(int code) {
+    switch (code) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+    }
+}
+
+static WebRequestMethodComposite parseMethod(const std::string &m) {
+    if (m == "GET") return HTTP_GET;
+    if (m == "HEAD") return HTTP_HEAD;
+    if (m == "POST") return HTTP_POST;
+    if (m == "PUT") return HTTP_PUT;
+    if (m == "PATCH") return HTTP_PATCH;
+    if (m == "DELETE") return HTTP_DELETE;
+    if (m == "OPTIONS") return HTTP_OPTIONS;
+    return 0;
+}
+
+static String urlDecode(const std::string &in) {
+    std::string out;
+    for (size_t i = 0; i < in.size(); i++) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < in.size()) {
+            out += (char)strtol(in.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return String(out.c_str(), out.size());
+}
+
+static uint64_t wallMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+DefaultHeaders &DefaultHeaders::Instance() {
+    static DefaultHeaders instance;
+    return instance;
+}
+
+// ========================================
+// Responses
+// ========================================
+
+AsyncWebServerResponse::AsyncWebServerResponse(int code, const String &contentType)
+    : _code(code), _contentType(contentType) {}
+
+String AsyncWebServerResponse::_head(bool keepAlive) const {
+    String head = "HTTP/1.1 " + String(_code) + " " + statusText(_code) + "\r\n";
+    if (_contentType.length()) head += "Content-Type: " + _contentType + "\r\n";
+    if (_chunked()) head += "Transfer-Encoding: chunked\r\n";
+    else if (!_unbounded()) head += "Content-Length: " + String((unsigned long)_contentLength) + "\r\n";
+    for (auto &h : DefaultHeaders::Instance().headers()) head += h.name() + ": " + h.value() + "\r\n";
+    for (auto &h : _headers) head += h.name() + ": " + h.value() + "\r\n";
+    head += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    return head;
+}
+
+class BasicResponse : public AsyncWebServerResponse {
+public:
+    BasicResponse(int code, const String &contentType, const String &content)
+        : AsyncWebServerResponse(code, contentType), _content(content) {
+        _contentLength = content.length();
+    }
+
+    size_t _fill(uint8_t *buffer, size_t maxLen) override {
+        size_t n = std::min(maxLen, _contentLength - _sent);
+        memcpy(buffer, _content.c_str() + _sent, n);
+        _sent += n;
+        return n;
+    }
+
+private:
+    String _content;
+};
+
+// Body stays where it is (flash on the device) and is copied out as sent
+class ProgmemResponse : public AsyncWebServerResponse {
+public:
+    ProgmemResponse(int code, const String &contentType, const uint8_t *content, size_t len)
+        : AsyncWebServerResponse(code, contentType), _content(content) {
+        _contentLength = len;
+    }
+
+    size_t _fill(uint8_t *buffer, size_t maxLen) override {
+        size_t n = std::min(maxLen, _contentLength - _sent);
+        memcpy(buffer, _content + _sent, n);
+        _sent += n;
+        return n;
+    }
+
+private:
+    const uint8_t *_content;
+};
+
+class ChunkedResponse : public AsyncWebServerResponse {
+public:
+    ChunkedResponse(const String &contentType, AwsResponseFiller filler)
+        : AsyncWebServerResponse(200, contentType), _filler(filler) {}
+
+    bool _chunked() const override { return true; }
+
+    size_t _fill(uint8_t *buffer, size_t maxLen) override {
+        size_t n = _filler(buffer, maxLen, _sent);
+        if (n != RESPONSE_TRY_AGAIN) _sent += n;
+        return n;
+    }
+
+private:
+    AwsResponseFiller _filler;
+};
+
+// An event stream: whatever the client has queued, until it is closed
+class EventSourceResponse : public AsyncWebServerResponse {
+public:
+    EventSourceResponse(AsyncEventSource *source, AsyncEventSourceClient *client)
+        : AsyncWebServerResponse(200, "text/event-stream"), _source(source), _client(client) {
+        addHeader("Cache-Control", "no-cache");
+    }
+
+    ~EventSourceResponse() override { _source->_removeClient(_client); }
+
+    bool _unbounded() const override { return true; }
+
+    size_t _fill(uint8_t *buffer, size_t maxLen) override {
+        size_t n = _client->_drain(buffer, maxLen);
+        if (n != RESPONSE_TRY_AGAIN) _sent += n;
+        return n;
+    }
+
+private:
+    AsyncEventSource *_source;
+    AsyncEventSourceClient *_client;
+};
+
+// ========================================
+// Server-Sent Events
+// ========================================
+
+static std::string formatEvent(const char *message, const char *event, uint32_t id, uint32_t reconnect) {
+    std::string out;
+    if (reconnect) out += "retry: " + std::to_string(reconnect) + "\n";
+    if (id) out += "id: " + std::to_string(id) + "\n";
+    if (event) out += std::string("event: ") + event + "\n";
+    const char *line = message ? message : "";
+    do {
+        const char *end = strchr(line, '\n');
+        size_t len = end ? (size_t)(end - line) : strlen(line);
+        out += "data: " + std::string(line, len) + "\n";
+        line = end ? end + 1 : nullptr;
+    } while (line);
+    out += "\n";
+    return out;
+}
+
+AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, AsyncEventSource *server)
+    : _server(server) {
+    AsyncWebHeader *last = request->getHeader("Last-Event-ID");
+    if (last) _lastId = last->value().toInt();
+}
+
+void AsyncEventSourceClient::_write(const std::string &message) {
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_closed || _queue.size() + message.size() > HOST_EVENT_QUEUE_LIMIT) return;
+    _queue += message;
+}
+
+void AsyncEventSourceClient::send(const char *message, const char *event, uint32_t id, uint32_t reconnect) {
+    _write(formatEvent(message, event, id, reconnect));
+}
+
+void AsyncEventSourceClient::close() {
+    std::lock_guard<std::mutex> lock(_lock);
+    _closed = true;
+}
+
+bool AsyncEventSourceClient::connected() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return !_closed;
+}
+
+size_t AsyncEventSourceClient::_drain(uint8_t *buffer, size_t maxLen) {
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_queue.empty()) return _closed ? 0 : RESPONSE_TRY_AGAIN;
+    size_t n = std::min(maxLen, _queue.size());
+    memcpy(buffer, _queue.data(), n);
+    _queue.erase(0, n);
+    return n;
+}
+
+void AsyncEventSource::send(const char *message, const char *event, uint32_t id, uint32_t reconnect) {
+    std::string formatted = formatEvent(message, event, id, reconnect);
+    std::lock_guard<std::mutex> lock(_lock);
+    for (auto &c : _clients) c->_write(formatted);
+}
+
+void AsyncEventSource::close() {
+    std::lock_guard<std::mutex> lock(_lock);
+    for (auto &c : _clients) c->close();
+}
+
+size_t AsyncEventSource::count() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    size_t n = 0;
+    for (auto &c : _clients) if (c->connected()) n++;
+    return n;
+}
+
+bool AsyncEventSource::canHandle(AsyncWebServerRequest *request) {
+    return request->method() == HTTP_GET && request->url() == _url;
+}
+
+void AsyncEventSource::handleRequest(AsyncWebServerRequest *request) {
+    AsyncEventSourceClient *client = new AsyncEventSourceClient(request, this);
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _clients.emplace_back(client);
+    }
+    request->send(new EventSourceResponse(this, client));
+    if (_connectcb) _connectcb(client);
+}
+
+void AsyncEventSource::_removeClient(AsyncEventSourceClient *client) {
+    std::lock_guard<std::mutex> lock(_lock);
+    for (auto it = _clients.begin(); it != _clients.end(); ++it) {
+        if (it->get() == client) {
+            _clients.erase(it);
+            return;
+        }
+    }
+}
+
+// ========================================
+// Requests
+// ========================================
+
+AsyncWebServerRequest::AsyncWebServerRequest() {}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+    if (_tempObject) free(_tempObject);
+}
+
+const char *AsyncWebServerRequest::methodToString() const {
+    switch (_method) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_DELETE: return "DELETE";
+    case HTTP_PUT: return "PUT";
+    case HTTP_PATCH: return "PATCH";
+    case HTTP_HEAD: return "HEAD";
+    case HTTP_OPTIONS: return "OPTIONS";
+    default: return "UNKNOWN";
+    }
+}
+
+bool AsyncWebServerRequest::hasParam(const String &name, bool post, bool file) const {
+    return getParam(name, post, file) != nullptr;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const {
+    (void)post;
+    (void)file;
+    for (auto &p : _params) if (p->name() == name) return p.get();
+    return nullptr;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String &name) const {
+    return getHeader(name) != nullptr;
+}
+
+AsyncWebHeader *AsyncWebServerRequest::getHeader(const String &name) const {
+    for (auto &h : _requestHeaders) if (h->name().equalsIgnoreCase(name)) return h.get();
+    return nullptr;
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response) {
+    if (_response) {
+        delete response;
+        return;
+    }
+    _response.reset(response);
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content) {
+    send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send(fs::FS &fs, const String &path, const String &contentType) {
+    File f = fs.open(path, "r");
+    if (!f) {
+        send(404);
+        return;
+    }
+    String content = f.readString();
+    f.close();
+    send(200, contentType, content);
+}
+
+void AsyncWebServerRequest::redirect(const String &url) {
+    AsyncWebServerResponse *response = beginResponse(302);
+    response->addHeader("Location", url);
+    send(response);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType,
+                                                             const String &content) {
+    return new BasicResponse(code, contentType, content);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse_P(int code, const String &contentType,
+                                                               const uint8_t *content, size_t len) {
+    return new ProgmemResponse(code, contentType, content, len);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String &contentType,
+                                                                    AwsResponseFiller callback) {
+    return new ChunkedResponse(contentType, callback);
+}
+
+// ========================================
+// Connections
+// ========================================
+
+struct HostConnection {
+    int fd;
+    std::string in;
+    std::string out;
+    std::unique_ptr<AsyncWebServerRequest> request;
+    bool headSent = false;
+    bool bodyDone = false;
+    bool closeAfter = false;
+    uint64_t lastActivityUs;
+    uint64_t requestStartUs = 0;
+
+    explicit HostConnection(int f) : fd(f), lastActivityUs(wallMicros()) {}
+
+    // A client that leaves mid-response is reported to the request
+    ~HostConnection() {
+        if (request && request->_onDisconnect) request->_onDisconnect();
+        ::close(fd);
+    }
+
+    // Parses one complete request out of the input buffer, if there is one
+    bool parseRequest(AsyncWebServer &server);
+
+    // Moves response bytes into the output buffer; returns false while a
+    // chunked filler has nothing ready
+    bool produce();
+
+    void finishRequest();
+};
+
+static void writeControlReply(HostConnection &c, const HostHttpReply &reply) {
+    char hdr[256];
+    int len = snprintf(hdr, sizeof(hdr),
+                       "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                       reply.code, statusText(reply.code), reply.type, strlen(reply.body));
+    c.out.append(hdr, len);
+    c.out.append(reply.body);
+    c.closeAfter = true;
+}
+
+bool HostConnection::parseRequest(AsyncWebServer &server) {
+    size_t headerEnd = in.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        if (in.size() > 65536) closeAfter = true;
+        return false;
+    }
+    std::string head = in.substr(0, headerEnd);
+
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+    size_t sp1 = requestLine.find(' ');
+    size_t sp2 = requestLine.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) {
+        closeAfter = true;
+        in.clear();
+        return false;
+    }
+    std::string methodStr = requestLine.substr(0, sp1);
+    std::string target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string version = requestLine.substr(sp2 + 1);
+
+    std::unique_ptr<AsyncWebServerRequest> req(new AsyncWebServerRequest());
+    req->_keepAlive = version == "HTTP/1.1";
+    size_t contentLength = 0;
+    size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+    while (pos < head.size()) {
+        size_t next = head.find("\r\n", pos);
+        if (next == std::string::npos) next = head.size();
+        std::string line = head.substr(pos, next - pos);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            std::string key = line.substr(0, colon);
+            std::string value = line.substr(colon + 1);
+            while (!value.empty() && value[0] == ' ') value.erase(0, 1);
+            req->_requestHeaders.emplace_back(new AsyncWebHeader(String(key.c_str()), String(value.c_str())));
+            if (strcasecmp(key.c_str(), "Content-Length") == 0) contentLength = strtoul(value.c_str(), nullptr, 10);
+            if (strcasecmp(key.c_str(), "Connection") == 0) {
+                if (strcasecmp(value.c_str(), "close") == 0) req->_keepAlive = false;
+                if (strcasecmp(value.c_str(), "keep-alive") == 0) req->_keepAlive = true;
+            }
+        }
+        pos = next + 2;
+    }
+
+    if (in.size() < headerEnd + 4 + contentLength) {
+        return false;
+    }
+    std::string body = in.substr(headerEnd + 4, contentLength);
+    in.erase(0, headerEnd + 4 + contentLength);
+
+    std::string path = target;
+    std::string query;
+    size_t q = target.find('?');
+    if (q != std::string::npos) {
+        path = target.substr(0, q);
+        query = target.substr(q + 1);
+    }
+
+    requestStartUs = wallMicros();
+    headSent = false;
+    bodyDone = false;
+    closeAfter = !req->_keepAlive;
+
+    // Host control endpoints never reach the firmware
+    if (path.compare(0, 8, "/__host/") == 0) {
+        HostHttpReply reply;
+        if (hostHandleControl(methodStr.c_str(), path.c_str(), query.c_str(), reply)) {
+            writeControlReply(*this, reply);
+            in.clear();
+            return false;
+        }
+    }
+
+    req->_method = parseMethod(methodStr);
+    req->_url = urlDecode(path);
+    size_t start = 0;
+    while (start < query.size()) {
+        size_t amp = query.find('&', start);
+        if (amp == std::string::npos) amp = query.size();
+        std::string pair = query.substr(start, amp - start);
+        size_t eq = pair.find('=');
+        if (eq == std::string::npos) req->_params.emplace_back(new AsyncWebParameter(urlDecode(pair), String()));
+        else req->_params.emplace_back(new AsyncWebParameter(urlDecode(pair.substr(0, eq)), urlDecode(pair.substr(eq + 1))));
+        start = amp + 1;
+    }
+
+    request = std::move(req);
+    server._dispatch(request.get(), body);
+    if (!request->_response) {
+        request->send(500, "text/plain", "No response");
+    }
+    return true;
+}
+
+bool HostConnection::produce() {
+    AsyncWebServerResponse *response = request->_response.get();
+    if (!headSent) {
+        if (response->_unbounded()) closeAfter = true;
+        String head = response->_head(!closeAfter);
+        out.append(head.c_str(), head.length());
+        headSent = true;
+    }
+
+    uint8_t buf[HOST_CHUNK_SIZE];
+    while (!bodyDone && out.size() < HOST_SEND_BUFFER) {
+        size_t n = response->_fill(buf, sizeof(buf));
+        if (n == RESPONSE_TRY_AGAIN) return false;
+        if (response->_chunked()) {
+            char sizeLine[16];
+            int len = snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", n);
+            out.append(sizeLine, len);
+            out.append((const char *)buf, n);
+            out.append("\r\n");
+        } else {
+            out.append((const char *)buf, n);
+        }
+        if (n == 0) bodyDone = true;
+    }
+    return true;
+}
+
+void HostConnection::finishRequest() {
+    if (hostDevice->traceHttp) {
+        fprintf(stderr, "[host] %s %s -> %d in %llu us\n", request->methodToString(), request->url().c_str(),
+                request->_response->_statusCode(), (unsigned long long)(wallMicros() - requestStartUs));
+    }
+    request.reset();
+}
+
+// ========================================
+// Server
+// ========================================
+
+struct HostServerThread {
+    int listenFd = -1;
+    std::atomic<bool> stop{false};
+    std::thread thread;
+};
+
+AsyncWebServer::AsyncWebServer(uint16_t port) : _port(port) {}
+
+AsyncWebServer::~AsyncWebServer() {
+    end();
+}
+
+void AsyncWebServer::begin() {
+    // Only the firmware's single server listens; the port comes from feeder_host
+    if (hostDevice->httpPort <= 0 || _thread) return;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(hostDevice->httpPort);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        fprintf(stderr, "[host] cannot listen on 127.0.0.1:%d: %s\n", hostDevice->httpPort, strerror(errno));
+        ::close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fprintf(stderr, "[host] async HTTP server on http://127.0.0.1:%d/ (port %d on the device)\n",
+            hostDevice->httpPort, _port);
+
+    _thread = new HostServerThread();
+    _thread->listenFd = fd;
+    _thread->thread = std::thread([this]() { _run(); });
+}
+
+void AsyncWebServer::end() {
+    if (!_thread) return;
+    _thread->stop = true;
+    if (_thread->thread.joinable()) _thread->thread.join();
+    ::close(_thread->listenFd);
+    delete _thread;
+    _thread = nullptr;
+}
+
+void AsyncWebServer::on(const char *uri, ArRequestHandlerFunction onRequest) {
+    on(uri, HTTP_ANY, onRequest);
+}
+
+void AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+    _routes.push_back({String(uri), method, onRequest, nullptr, nullptr});
+}
+
+void AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                        ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+    (void)onUpload;
+    _routes.push_back({String(uri), method, onRequest, onBody, nullptr});
+}
+
+AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler) {
+    _routes.push_back({String(), 0, nullptr, nullptr, handler});
+    return *handler;
+}
+
+void AsyncWebServer::_dispatch(AsyncWebServerRequest *request, std::string &body) {
+    const String &url = request->url();
+    for (auto &r : _routes) {
+        // Handlers and routes are tried in the order they were added
+        if (r.handler) {
+            if (!r.handler->canHandle(request)) continue;
+            r.handler->handleRequest(request);
+            return;
+        }
+        // Same matching as AsyncCallbackWebHandler: the URI itself or anything below it
+        if (!(r.method & request->method())) continue;
+        if (r.uri != url && !url.startsWith(r.uri + "/")) continue;
+
+        if (r.onBody && !body.empty()) {
+            r.onBody(request, (uint8_t *)&body[0], body.size(), 0, body.size());
+        }
+        r.onRequest(request);
+        return;
+    }
+    if (_notFound) {
+        _notFound(request);
+    } else {
+        request->send(404, "text/plain", "Not found");
+    }
+}
+
+void AsyncWebServer::_run() {
+    std::vector<std::unique_ptr<HostConnection>> conns;
+
+    while (!_thread->stop) {
+        std::vector<struct pollfd> fds;
+        fds.push_back({_thread->listenFd, POLLIN, 0});
+        bool busy = false;
+        for (auto &c : conns) {
+            short events = POLLIN;
+            if (!c->out.empty()) events |= POLLOUT;
+            // A filler with nothing ready yet, or a pipelined request
+            if (c->request ? !c->bodyDone && c->out.empty() : !c->in.empty()) busy = true;
+            fds.push_back({c->fd, events, 0});
+        }
+
+        poll(fds.data(), fds.size(), busy ? 10 : 50);
+
+        uint64_t now = wallMicros();
+        std::vector<bool> dead(conns.size(), false);
+        for (size_t i = 0; i < conns.size(); i++) {
+            HostConnection &c = *conns[i];
+
+            if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                char buf[4096];
+                ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+                if (n > 0) {
+                    c.in.append(buf, n);
+                    c.lastActivityUs = now;
+                } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    dead[i] = true;
+                    continue;
+                }
+            }
+
+            // One request at a time per connection; pipelined ones wait in c.in
+            if (!c.request && !c.in.empty() && !c.closeAfter) {
+                c.parseRequest(*this);
+            }
+            if (c.request && !c.bodyDone) {
+                c.produce();
+            }
+
+            if (!c.out.empty()) {
+                ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+                if (n > 0) {
+                    c.out.erase(0, n);
+                    c.lastActivityUs = now;
+                } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    dead[i] = true;
+                    continue;
+                }
+            }
+
+            if (c.out.empty() && (!c.request || c.bodyDone)) {
+                if (c.request) c.finishRequest();
+                if (c.closeAfter || now - c.lastActivityUs > HOST_KEEPALIVE_MS * 1000ULL) dead[i] = true;
+            }
+        }
+
+        for (size_t i = dead.size(); i-- > 0;) {
+            if (dead[i]) conns.erase(conns.begin() + i);
+        }
+
+        if ((fds[0].revents & POLLIN) && conns.size() < HOST_MAX_CONNECTIONS) {
+            int fd;
+            while (conns.size() < HOST_MAX_CONNECTIONS &&
+                   (fd = accept(_thread->listenFd, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                conns.emplace_back(new HostConnection(fd));
+            }
+        }
+    }
+}
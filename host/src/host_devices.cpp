@@ -0,0 +1,731 @@
+#include "Arduino.h"
+#include "RTClib.h"
+#include "Wire.h"
+#include "WiFi.h"
+#include "ESP32Servo.h"
+#include "Adafruit_INA219.h"
+#include "esp_sleep.h"
+#include "host_hal.h"
+#include "config.h"
+#include "button_debounce.h"
+#include "button_ulp.h"
+#include "esp32/ulp.h"
+#include "driver/rtc_io.h"
+#include <mutex>
+
+TwoWire Wire;
+WiFiClass WiFi;
+
+// Approximate bus cost of each transaction at 100 kHz
+#define HOST_I2C_RTC_READ_US 350
+#define HOST_I2C_RTC_WRITE_US 250
+#define HOST_I2C_INA219_READ_US 550
+
+// Time for the servo to sweep its full pulse range
+#define HOST_SERVO_SWEEP_US 1200000ULL
+
+// ========================================
+// DateTime (same arithmetic as Adafruit RTClib)
+// ========================================
+
+static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30};
+
+static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) {
+    if (y >= 2000U) y -= 2000U;
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i) days += daysInMonth[i - 1];
+    if (m > 2 && y % 4 == 0) ++days;
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+static uint32_t time2ulong(uint16_t days, uint8_t h, uint8_t m, uint8_t s) {
+    return ((days * 24UL + h) * 60 + m) * 60 + s;
+}
+
+static uint8_t conv2d(const char *p) {
+    uint8_t v = 0;
+    if ('0' <= *p && *p <= '9') v = *p - '0';
+    return 10 * v + *++p - '0';
+}
+
+DateTime::DateTime(uint32_t t) {
+    t -= SECONDS_FROM_1970_TO_2000;
+    ss = t % 60;
+    t /= 60;
+    mm = t % 60;
+    t /= 60;
+    hh = t % 24;
+    uint16_t days = t / 24;
+    uint8_t leap;
+    for (yOff = 0;; ++yOff) {
+        leap = yOff % 4 == 0;
+        if (days < 365U + leap) break;
+        days -= 365 + leap;
+    }
+    for (m = 1; m < 12; ++m) {
+        uint8_t dim = daysInMonth[m - 1];
+        if (leap && m == 2) ++dim;
+        if (days < dim) break;
+        days -= dim;
+    }
+    d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour,
+                   uint8_t min, uint8_t sec) {
+    if (year >= 2000U) year -= 2000U;
+    yOff = year;
+    m = month;
+    d = day;
+    hh = hour;
+    mm = min;
+    ss = sec;
+}
+
+DateTime::DateTime(const char *date, const char *time) {
+    yOff = conv2d(date + 9);
+    switch (date[0]) {
+    case 'J': m = (date[1] == 'a') ? 1 : ((date[2] == 'n') ? 6 : 7); break;
+    case 'F': m = 2; break;
+    case 'A': m = date[2] == 'r' ? 4 : 8; break;
+    case 'M': m = date[2] == 'r' ? 3 : 5; break;
+    case 'S': m = 9; break;
+    case 'O': m = 10; break;
+    case 'N': m = 11; break;
+    case 'D': m = 12; break;
+    default: m = 1; break;
+    }
+    d = conv2d(date + 4);
+    hh = conv2d(time);
+    mm = conv2d(time + 3);
+    ss = conv2d(time + 6);
+}
+
+DateTime::DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time)
+    : DateTime(reinterpret_cast<const char *>(date), reinterpret_cast<const char *>(time)) {}
+
+bool DateTime::isValid() const {
+    if (yOff >= 100) return false;
+    DateTime other(unixtime());
+    return yOff == other.yOff && m == other.m && d == other.d &&
+           hh == other.hh && mm == other.mm && ss == other.ss;
+}
+
+uint8_t DateTime::twelveHour() const {
+    if (hh == 0 || hh == 12) return 12;
+    return hh > 12 ? hh - 12 : hh;
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+    uint16_t day = date2days(yOff, m, d);
+    return (day + 6) % 7; // Jan 1, 2000 is a Saturday, i.e. returns 6
+}
+
+uint32_t DateTime::secondstime() const {
+    return time2ulong(date2days(yOff, m, d), hh, mm, ss);
+}
+
+uint32_t DateTime::unixtime() const {
+    return secondstime() + SECONDS_FROM_1970_TO_2000;
+}
+
+String DateTime::timestamp() const {
+    char buf[20];
+    snprintf(buf, sizeof(buf), "%04u-%02u-%02uT%02u:%02u:%02u",
+             2000U + yOff, m, d, hh, mm, ss);
+    return String(buf);
+}
+
+DateTime DateTime::operator+(const TimeSpan &span) const {
+    return DateTime(unixtime() + span.totalseconds());
+}
+
+DateTime DateTime::operator-(const TimeSpan &span) const {
+    return DateTime(unixtime() - span.totalseconds());
+}
+
+TimeSpan DateTime::operator-(const DateTime &right) const {
+    return TimeSpan(unixtime() - right.unixtime());
+}
+
+// ========================================
+// DS3231 model
+// ========================================
+
+uint32_t hostRtcUnix() {
+    return (uint32_t)(hostDevice->rtc.offsetSeconds + (int64_t)(hostClockMicros() / 1000000ULL));
+}
+
+void hostRtcSet(uint32_t unixTime) {
+    HostRtcChip &rtc = hostDevice->rtc;
+    rtc.offsetSeconds = (int64_t)unixTime - (int64_t)(hostClockMicros() / 1000000ULL);
+    rtc.lastEvaluatedUnix = unixTime;
+}
+
+// Next time at or after fromUnix whose registers match the alarm, using
+// the DS3231 alarm-mask semantics of alarm 1.
+static uint32_t nextAlarmMatch(uint32_t alarmUnix, uint8_t mode, uint32_t fromUnix) {
+    DateTime a(alarmUnix);
+    switch (mode) {
+    case DS3231_A1_PerSecond:
+        return fromUnix;
+    case DS3231_A1_Second: {
+        uint32_t base = fromUnix - fromUnix % 60 + a.second();
+        return base >= fromUnix ? base : base + 60;
+    }
+    case DS3231_A1_Minute: {
+        uint32_t base = fromUnix - fromUnix % 3600 + a.minute() * 60 + a.second();
+        return base >= fromUnix ? base : base + 3600;
+    }
+    default:
+        break;
+    }
+
+    // Hour, date and day-of-week matches: walk forward day by day
+    DateTime from(fromUnix);
+    uint32_t dayStart = fromUnix - (from.hour() * 3600UL + from.minute() * 60UL + from.second());
+    for (int i = 0; i < 400; i++) {
+        uint32_t candidate = dayStart + i * 86400UL + a.hour() * 3600UL + a.minute() * 60UL + a.second();
+        if (candidate < fromUnix) continue;
+        DateTime c(candidate);
+        if (mode == DS3231_A1_Hour) return candidate;
+        if (mode == DS3231_A1_Date && c.day() == a.day()) return candidate;
+        if (mode == DS3231_A1_Day && c.dayOfTheWeek() == a.dayOfTheWeek()) return candidate;
+    }
+    return 0;
+}
+
+static uint8_t alarm2AsAlarm1Mode(uint8_t mode) {
+    switch (mode) {
+    case DS3231_A2_PerMinute: return DS3231_A1_Second;
+    case DS3231_A2_Minute: return DS3231_A1_Minute;
+    case DS3231_A2_Hour: return DS3231_A1_Hour;
+    case DS3231_A2_Day: return DS3231_A1_Day;
+    default: return DS3231_A1_Date;
+    }
+}
+
+static void updateFlagsAt(uint32_t nowUnix) {
+    HostRtcChip &rtc = hostDevice->rtc;
+    if (nowUnix <= rtc.lastEvaluatedUnix) {
+        if (nowUnix < rtc.lastEvaluatedUnix) rtc.lastEvaluatedUnix = nowUnix;
+        return;
+    }
+    uint32_t from = rtc.lastEvaluatedUnix + 1;
+    if (rtc.alarm1Unix != 0) {
+        uint32_t t = nextAlarmMatch(rtc.alarm1Unix, rtc.alarm1Mode, from);
+        if (t != 0 && t <= nowUnix) rtc.alarm1Fired = true;
+    }
+    if (rtc.alarm2Unix != 0) {
+        uint32_t t = nextAlarmMatch(rtc.alarm2Unix, alarm2AsAlarm1Mode(rtc.alarm2Mode), from);
+        if (t != 0 && t <= nowUnix) rtc.alarm2Fired = true;
+    }
+    rtc.lastEvaluatedUnix = nowUnix;
+}
+
+void hostRtcUpdateFlags() {
+    updateFlagsAt(hostRtcUnix());
+}
+
+uint32_t hostRtcNextAlarm(uint32_t fromUnix) {
+    const HostRtcChip &rtc = hostDevice->rtc;
+    if (rtc.sqwMode != DS3231_OFF) return 0;  // INTCN clear: no interrupt output
+    if ((rtc.alarm1Enabled && rtc.alarm1Fired) || (rtc.alarm2Enabled && rtc.alarm2Fired)) {
+        return fromUnix;
+    }
+    uint32_t best = 0;
+    if (rtc.alarm1Enabled && rtc.alarm1Unix != 0) {
+        best = nextAlarmMatch(rtc.alarm1Unix, rtc.alarm1Mode, fromUnix);
+    }
+    if (rtc.alarm2Enabled && rtc.alarm2Unix != 0) {
+        uint32_t t = nextAlarmMatch(rtc.alarm2Unix, alarm2AsAlarm1Mode(rtc.alarm2Mode), fromUnix);
+        if (t != 0 && (best == 0 || t < best)) best = t;
+    }
+    return best;
+}
+
+bool RTC_DS3231::begin(TwoWire *wireInstance) {
+    (void)wireInstance;
+    hostI2CTransaction(HOST_I2C_RTC_READ_US);
+    return true;
+}
+
+void RTC_DS3231::adjust(const DateTime &dt) {
+    hostI2CTransaction(HOST_I2C_RTC_WRITE_US);
+    hostRtcSet(dt.unixtime());
+    hostDevice->rtc.oscillatorStopped = false;
+}
+
+bool RTC_DS3231::lostPower() {
+    hostI2CTransaction(HOST_I2C_RTC_READ_US);
+    return hostDevice->rtc.oscillatorStopped;
+}
+
+DateTime RTC_DS3231::now() {
+    hostI2CTransaction(HOST_I2C_RTC_READ_US);
+    return DateTime(hostRtcUnix());
+}
+
+Ds3231SqwPinMode RTC_DS3231::readSqwPinMode() {
+    hostI2CTransaction(HOST_I2C_RTC_READ_US);
+    return (Ds3231SqwPinMode)hostDevice->rtc.sqwMode;
+}
+
+void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode mode) {
+    hostI2CTransaction(HOST_I2C_RTC_WRITE_US);
+    hostDevice->rtc.sqwMode = mode;
+}
+
+bool RTC_DS3231::setAlarm1(const DateTime &dt, Ds3231Alarm1Mode alarm_mode) {
+    hostI2CTransaction(HOST_I2C_RTC_WRITE_US);
+    HostRtcChip &rtc = hostDevice->rtc;
+    if (rtc.sqwMode != DS3231_OFF) return false;  // RTClib refuses without INTCN
+    hostRtcUpdateFlags();
+    rtc.alarm1Unix = dt.unixtime();
+    rtc.alarm1Mode = alarm_mode;
+    rtc.alarm1Enabled = true;
+    return true;
+}
+
+bool RTC_DS3231::setAlarm2(const DateTime &dt, Ds3231Alarm2Mode alarm_mode) {
+    hostI2CTransaction(HOST_I2C_RTC_WRITE_US);
+    HostRtcChip &rtc = hostDevice->rtc;
+    if (rtc.sqwMode != DS3231_OFF) return false;
+    hostRtcUpdateFlags();
+    rtc.alarm2Unix = dt.unixtime() - dt.second();
+    rtc.alarm2Mode = alarm_mode;
+    rtc.alarm2Enabled = true;
+    return true;
+}
+
+DateTime RTC_DS3231::getAlarm1() {
+    hostI2CTransaction(HOST_I2C_RTC_READ_US);
+    return DateTime(hostDevice->rtc.alarm1Unix);
+}
+
+Ds3231Alarm1Mode RTC_DS3231::getAlarm1Mode() {
+    hostI2CTransaction(HOST_I2C_RTC_READ_US);
+    return (Ds3231Alarm1Mode)hostDevice->rtc.alarm1Mode;
+}
+
+void RTC_DS3231::disableAlarm(uint8_t alarm_num) {
+    hostI2CTransaction(HOST_I2C_RTC_WRITE_US);
+    if (alarm_num == 1) hostDevice->rtc.alarm1Enabled = false;
+    if (alarm_num == 2) hostDevice->rtc.alarm2Enabled = false;
+}
+
+void RTC_DS3231::clearAlarm(uint8_t alarm_num) {
+    hostI2CTransaction(HOST_I2C_RTC_WRITE_US);
+    hostRtcUpdateFlags();
+    if (alarm_num == 1) hostDevice->rtc.alarm1Fired = false;
+    if (alarm_num == 2) hostDevice->rtc.alarm2Fired = false;
+}
+
+bool RTC_DS3231::alarmFired(uint8_t alarm_num) {
+    hostI2CTransaction(HOST_I2C_RTC_READ_US);
+    hostRtcUpdateFlags();
+    return alarm_num == 1 ? hostDevice->rtc.alarm1Fired : hostDevice->rtc.alarm2Fired;
+}
+
+// ========================================
+// Servo model
+// ========================================
+
+int Servo::attach(int pin) {
+    return attach(pin, DEFAULT_uS_LOW, DEFAULT_uS_HIGH);
+}
+
+int Servo::attach(int pin, int min, int max) {
+    // ESP32Servo clamps the requested range to 500..2500 us
+    _pin = pin;
+    _min = min < MIN_PULSE ? MIN_PULSE : min;
+    _max = max > MAX_PULSE ? MAX_PULSE : max;
+    hostEnergyAccrue();
+    hostDevice->servo.attached = true;
+    return 1;
+}
+
+void Servo::detach() {
+    _pin = -1;
+    hostEnergyAccrue();
+    hostDevice->servo.attached = false;
+}
+
+void Servo::write(int value) {
+    if (value < _min) {
+        // Values below the minimum pulse are angles, as in ESP32Servo
+        value = constrain(value, 0, 180);
+        value = map(value, 0, 180, _min, _max);
+    }
+    writeMicroseconds(value);
+}
+
+void Servo::writeMicroseconds(int value) {
+    if (_pin < 0) return;
+    value = constrain(value, _min, _max);
+
+    hostEnergyAccrue();
+    HostServoModel &servo = hostDevice->servo;
+    if (value != servo.pulseUs) {
+        uint64_t now = hostClockMicros();
+        uint64_t travel = (uint64_t)abs(value - servo.pulseUs) * HOST_SERVO_SWEEP_US /
+                          (MAX_PULSE - MIN_PULSE);
+        servo.moveStartUs = now;
+        servo.moveEndUs = servo.jammed ? UINT64_MAX : now + travel;
+        servo.moves++;
+    }
+    servo.pulseUs = value;
+    _pulse = value;
+}
+
+int Servo::read() {
+    return map(readMicroseconds(), _min, _max, 0, 180);
+}
+
+int Servo::readMicroseconds() {
+    return _pin < 0 ? 0 : _pulse;
+}
+
+bool Servo::attached() {
+    return _pin >= 0;
+}
+
+// ========================================
+// Battery and INA219 model
+// ========================================
+
+// Supply current at atUs; servoMa is the part through the servo transistor
+static float loadCurrentMa(uint64_t atUs, float &servoMa) {
+    const HostBatteryModel &b = hostDevice->battery;
+    servoMa = 0;
+    if (hostDevice->lightSleeping) return b.lightSleepMa;
+
+    float ma = b.idleMa;
+    if (hostDevice->wifiApActive) ma += b.apMa;
+
+    if (hostDevice->pinLevel[SERVO_TRANSISTOR_PIN] == HIGH) {
+        servoMa = b.servoHoldMa;
+        const HostServoModel &servo = hostDevice->servo;
+        if (servo.attached && atUs >= servo.moveStartUs && atUs < servo.moveEndUs) {
+            servoMa += b.servoMoveMa;
+        }
+    }
+    return ma + servoMa;
+}
+
+float hostLoadCurrentMa() {
+    float servoMa;
+    return loadCurrentMa(hostClockMicros(), servoMa);
+}
+
+static std::mutex energyMutex;
+
+void hostEnergyAccrue() {
+    std::lock_guard<std::mutex> lock(energyMutex);
+    HostEnergyMeter &energy = hostDevice->energy;
+    const HostBatteryModel &b = hostDevice->battery;
+    uint64_t now = hostClockMicros();
+
+    while (energy.accountedUs < now) {
+        // A move ends without any call into the model, so split the
+        // stretch there
+        uint64_t until = now;
+        uint64_t moveEndUs = hostDevice->servo.moveEndUs;
+        if (moveEndUs > energy.accountedUs && moveEndUs < now) until = moveEndUs;
+
+        float servoMa;
+        float ma = loadCurrentMa(energy.accountedUs, servoMa);
+        double volts = b.openCircuitV - ma * b.internalOhms / 1000.0f;
+        double seconds = (until - energy.accountedUs) / 1e6;
+        energy.bootMj += volts * ma * seconds;
+        energy.totalMj += volts * ma * seconds;
+        uint32_t unixTime = (uint32_t)(hostDevice->rtc.offsetSeconds + (int64_t)(energy.accountedUs / 1000000ULL));
+        if (HostDayStats *day = hostDayStats(unixTime)) day->energyMj += volts * ma * seconds;
+        energy.servoBootMj += volts * servoMa * seconds;
+        energy.servoTotalMj += volts * servoMa * seconds;
+        energy.accountedUs = until;
+    }
+}
+
+void hostSetBattery(float openCircuitV) {
+    hostEnergyAccrue();
+    hostDevice->battery.openCircuitV = openCircuitV;
+}
+
+bool Adafruit_INA219::begin(TwoWire *theWire) {
+    (void)theWire;
+    hostI2CTransaction(HOST_I2C_INA219_READ_US);
+    return true;
+}
+
+float Adafruit_INA219::getBusVoltage_V() {
+    hostI2CTransaction(HOST_I2C_INA219_READ_US);
+    const HostBatteryModel &b = hostDevice->battery;
+    return b.openCircuitV - hostLoadCurrentMa() * b.internalOhms / 1000.0f;
+}
+
+float Adafruit_INA219::getShuntVoltage_mV() {
+    hostI2CTransaction(HOST_I2C_INA219_READ_US);
+    return hostLoadCurrentMa() * 0.1f;  // 0.1 ohm shunt
+}
+
+float Adafruit_INA219::getCurrent_mA() {
+    hostI2CTransaction(HOST_I2C_INA219_READ_US);
+    return hostLoadCurrentMa();
+}
+
+float Adafruit_INA219::getPower_mW() {
+    hostI2CTransaction(HOST_I2C_INA219_READ_US);
+    const HostBatteryModel &b = hostDevice->battery;
+    float ma = hostLoadCurrentMa();
+    return (b.openCircuitV - ma * b.internalOhms / 1000.0f) * ma;
+}
+
+// ========================================
+// WiFi
+// ========================================
+
+bool WiFiClass::softAP(const char *ssid, const char *passphrase, int channel,
+                       int ssid_hidden, int max_connection) {
+    (void)ssid; (void)passphrase; (void)channel; (void)ssid_hidden; (void)max_connection;
+    hostEnergyAccrue();
+    hostDevice->wifiApActive = true;
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifioff) {
+    (void)wifioff;
+    hostEnergyAccrue();
+    hostDevice->wifiApActive = false;
+    return true;
+}
+
+IPAddress WiFiClass::softAPIP() {
+    return IPAddress(127, 0, 0, 1);
+}
+
+uint8_t WiFiClass::softAPgetStationNum() {
+    return hostDevice->wifiApActive ? hostDevice->apStations : 0;
+}
+
+bool WiFiClass::mode(wifi_mode_t m) {
+    hostEnergyAccrue();
+    if (m == WIFI_OFF) hostDevice->wifiApActive = false;
+    return true;
+}
+
+wifi_mode_t WiFiClass::getMode() {
+    return hostDevice->wifiApActive ? WIFI_AP : WIFI_OFF;
+}
+
+// ========================================
+// Sleep
+// ========================================
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    if (hostDevice->wakeViaUlp) return ESP_SLEEP_WAKEUP_ULP;
+    return (esp_sleep_wakeup_cause_t)hostDevice->wakeCause;
+}
+
+// The classic ESP32 cannot arm ext0 and the ULP together, whichever
+// comes first; ESP-IDF refuses the second one
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level) {
+    if (hostDevice->sleep.ulpEnabled) return ESP_ERR_INVALID_STATE;
+    hostDevice->sleep.ext0Enabled = true;
+    hostDevice->sleep.ext0Pin = gpio_num;
+    hostDevice->sleep.ext0Level = level;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t mask, esp_sleep_ext1_wakeup_mode_t mode) {
+    hostDevice->sleep.ext1Enabled = true;
+    hostDevice->sleep.ext1Mask = mask;
+    hostDevice->sleep.ext1Mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    hostDevice->sleep.timerEnabled = true;
+    hostDevice->sleep.timerUs = time_in_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ulp_wakeup() {
+    if (hostDevice->sleep.ext0Enabled) return ESP_ERR_INVALID_STATE;
+    hostDevice->sleep.ulpEnabled = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+    HostSleepConfig &s = hostDevice->sleep;
+    if (source == ESP_SLEEP_WAKEUP_ALL || source == ESP_SLEEP_WAKEUP_EXT0) s.ext0Enabled = false;
+    if (source == ESP_SLEEP_WAKEUP_ALL || source == ESP_SLEEP_WAKEUP_EXT1) s.ext1Enabled = false;
+    if (source == ESP_SLEEP_WAKEUP_ALL || source == ESP_SLEEP_WAKEUP_TIMER) s.timerEnabled = false;
+    if (source == ESP_SLEEP_WAKEUP_ALL || source == ESP_SLEEP_WAKEUP_ULP) s.ulpEnabled = false;
+    return ESP_OK;
+}
+
+uint64_t esp_sleep_get_ext1_wakeup_status() {
+    return hostDevice->wakeCause == ESP_SLEEP_WAKEUP_EXT1 ? (1ULL << BUTTON_PIN) : 0;
+}
+
+void esp_deep_sleep_start() {
+    hostDevice->sleepRequested = true;
+    hostEndBoot();
+}
+
+esp_err_t esp_light_sleep_start() {
+    hostLightSleep();
+    return ESP_OK;
+}
+
+// Time within a press when the ULP's debounce qualifies it, or false if
+// it is released too soon
+static bool ulpQualifiesPress(uint64_t holdUs, uint32_t periodUs, uint64_t &afterUs) {
+    ButtonDebounce debounce;
+    buttonDebounceReset(debounce);
+
+    // The pin reads low before the press
+    buttonDebounceStep(debounce, false);
+    for (uint64_t t = 0; t < holdUs; t += periodUs) {
+        if (buttonDebounceStep(debounce, true)) {
+            afterUs = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hostNextWake(uint64_t &wakeUs, int &cause, uint64_t &releaseUs, bool &viaUlp) {
+    const HostSleepConfig &s = hostDevice->sleep;
+    uint64_t nowUs = hostDevice->clockUs;
+    uint32_t nowUnix = (uint32_t)(hostDevice->rtc.offsetSeconds + (int64_t)(nowUs / 1000000ULL));
+    bool found = false;
+
+    updateFlagsAt(nowUnix);
+
+    // The ULP can only read pins that were handed to the RTC IO mux
+    bool ulp = s.ulpEnabled && s.ulpRunning && s.ulpPeriodUs > 0;
+    bool ext0 = s.ext0Enabled && s.ext0Pin == RTC_ALARM_PIN && s.ext0Level == 0;
+    bool ulpAlarm = ulp && (s.rtcInputMask & (1ULL << RTC_ALARM_PIN));
+    bool ulpButton = ulp && (s.rtcInputMask & (1ULL << BUTTON_PIN));
+    if (ext0 || ulpAlarm) {
+        uint32_t t = hostRtcNextAlarm(nowUnix);
+        if (t != 0) {
+            uint64_t us = (uint64_t)((int64_t)t - hostDevice->rtc.offsetSeconds) * 1000000ULL;
+            if (us < nowUs) us = nowUs;
+            wakeUs = us;
+            cause = ESP_SLEEP_WAKEUP_EXT0;
+            viaUlp = !ext0;
+            found = true;
+        }
+    }
+
+    bool ext1 = s.ext1Enabled && (s.ext1Mask & (1ULL << BUTTON_PIN)) && s.ext1Mode == ESP_EXT1_WAKEUP_ANY_HIGH;
+    if (ext1 || ulpButton) {
+        for (int i = 0; i < hostDevice->buttonPressCount; i++) {
+            uint32_t press = hostDevice->buttonPresses[i];
+            if (press < nowUnix) continue;
+            uint64_t pressUs = (uint64_t)((int64_t)press - hostDevice->rtc.offsetSeconds) * 1000000ULL;
+            uint64_t holdUs = hostDevice->buttonPressHoldMs[i] * 1000ULL;
+
+            // ext1 wakes on first contact; the ULP only once it has
+            // debounced the press, and never for a knock
+            uint64_t us = pressUs;
+            int pressCause = ESP_SLEEP_WAKEUP_EXT1;
+            if (!ext1) {
+                uint64_t afterUs = 0;
+                if (!ulpQualifiesPress(holdUs, s.ulpPeriodUs, afterUs)) continue;
+                us += afterUs;
+                pressCause = ESP_SLEEP_WAKEUP_ULP;
+            }
+            if (!found || us < wakeUs) {
+                wakeUs = us;
+                cause = pressCause;
+                viaUlp = !ext1;
+                releaseUs = pressUs + holdUs;
+                found = true;
+            }
+        }
+    }
+
+    if (s.timerEnabled) {
+        uint64_t us = nowUs + s.timerUs;
+        if (!found || us < wakeUs) {
+            wakeUs = us;
+            cause = ESP_SLEEP_WAKEUP_TIMER;
+            viaUlp = false;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+void hostDeliverWake(int cause, bool viaUlp) {
+    hostDevice->wakeCause = cause;
+    hostDevice->wakeViaUlp = viaUlp;
+    if (viaUlp) {
+        // What the program stores before I_WAKE; I_END stops its timer
+        hostRtcSlowMem[ULP_SLOT_WAKE] = cause == ESP_SLEEP_WAKEUP_EXT0 ? ULP_WAKE_ALARM : ULP_WAKE_BUTTON;
+        hostDevice->sleep.ulpRunning = false;
+    }
+}
+
+// ========================================
+// ULP and RTC IO
+// ========================================
+
+uint32_t hostRtcSlowMem[2048];
+
+esp_err_t ulp_process_macros_and_load(uint32_t load_addr, const ulp_insn_t *program, size_t *psize) {
+    return ESP_OK;
+}
+
+esp_err_t ulp_set_wakeup_period(size_t period_index, uint32_t period_us) {
+    if (period_index == 0) hostDevice->sleep.ulpPeriodUs = period_us;
+    return ESP_OK;
+}
+
+esp_err_t ulp_run(uint32_t entry_point) {
+    hostDevice->sleep.ulpRunning = true;
+    return ESP_OK;
+}
+
+int rtc_io_number_get(gpio_num_t gpio_num) {
+    switch (gpio_num) {
+        case GPIO_NUM_0: return 11;
+        case GPIO_NUM_12: return 15;
+        case GPIO_NUM_13: return 14;
+        case GPIO_NUM_14: return 16;
+        case GPIO_NUM_25: return 6;
+        case GPIO_NUM_32: return 9;
+        case GPIO_NUM_33: return 8;
+        case GPIO_NUM_34: return 4;
+        default: return -1;
+    }
+}
+
+esp_err_t rtc_gpio_init(gpio_num_t gpio_num) {
+    if (rtc_io_number_get(gpio_num) < 0) return ESP_ERR_INVALID_ARG;
+    hostDevice->sleep.rtcInputMask |= 1ULL << gpio_num;
+    return ESP_OK;
+}
+
+esp_err_t rtc_gpio_deinit(gpio_num_t gpio_num) {
+    if (rtc_io_number_get(gpio_num) < 0) return ESP_ERR_INVALID_ARG;
+    hostDevice->sleep.rtcInputMask &= ~(1ULL << gpio_num);
+    return ESP_OK;
+}
+
+esp_err_t rtc_gpio_set_direction(gpio_num_t gpio_num, rtc_gpio_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t rtc_gpio_pullup_en(gpio_num_t gpio_num) {
+    return ESP_OK;
+}
+
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t gpio_num) {
+    return ESP_OK;
+}
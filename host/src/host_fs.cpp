@@ -0,0 +1,309 @@
+#include "LittleFS.h"
+#include "host_hal.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+fs::LittleFSFS LittleFS;
+
+// ========================================
+// Host file backend
+// ========================================
+// Each LittleFS path maps onto hostFsRoot() + path. Every byte written or
+// read is counted in HostDevice so flash traffic per boot can be reported.
+
+#define HOST_FLASH_PARTITION_BYTES 0x170000
+#define HOST_FLASH_BLOCK_BYTES 4096
+
+namespace fs {
+
+class FileImpl {
+public:
+    FILE *fp = nullptr;
+    DIR *dir = nullptr;
+    bool writable = false;
+    size_t bytesWritten = 0;
+    std::string path;
+    std::string fullPath;
+    std::string baseName;
+
+    ~FileImpl() { close(); }
+
+    void close() {
+        if (fp) {
+            fclose(fp);
+            fp = nullptr;
+            if (writable) hostTraceFlashWrite(path.c_str(), bytesWritten);
+        }
+        if (dir) { closedir(dir); dir = nullptr; }
+    }
+};
+
+} // namespace fs
+
+static std::string hostPath(const char *path) {
+    std::string p = path ? path : "/";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return std::string(hostFsRoot()) + p;
+}
+
+static std::string baseNameOf(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// ========================================
+// fs::File
+// ========================================
+
+size_t fs::File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t fs::File::write(const uint8_t *buf, size_t size) {
+    if (!_p || !_p->fp || !_p->writable) return 0;
+    size_t n = fwrite(buf, 1, size, _p->fp);
+    _p->bytesWritten += n;
+    hostFlashCountWrite(n, false);
+    return n;
+}
+
+int fs::File::available() {
+    if (!_p || !_p->fp) return 0;
+    long pos = ftell(_p->fp);
+    size_t total = size();
+    return pos < 0 || (size_t)pos >= total ? 0 : (int)(total - pos);
+}
+
+int fs::File::read() {
+    if (!_p || !_p->fp) return -1;
+    int c = fgetc(_p->fp);
+    if (c != EOF) hostFlashCountRead(1, false);
+    return c == EOF ? -1 : c;
+}
+
+int fs::File::peek() {
+    if (!_p || !_p->fp) return -1;
+    int c = fgetc(_p->fp);
+    if (c == EOF) return -1;
+    ungetc(c, _p->fp);
+    return c;
+}
+
+size_t fs::File::read(uint8_t *buf, size_t size) {
+    if (!_p || !_p->fp) return 0;
+    size_t n = fread(buf, 1, size, _p->fp);
+    hostFlashCountRead(n, false);
+    return n;
+}
+
+void fs::File::flush() {
+    if (_p && _p->fp) fflush(_p->fp);
+}
+
+bool fs::File::seek(uint32_t pos, SeekMode mode) {
+    if (!_p || !_p->fp) return false;
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(_p->fp, (long)pos, whence) == 0;
+}
+
+size_t fs::File::position() const {
+    if (!_p || !_p->fp) return 0;
+    long pos = ftell(_p->fp);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t fs::File::size() const {
+    if (!_p || !_p->fp) return 0;
+    fflush(_p->fp);
+    struct stat st;
+    if (fstat(fileno(_p->fp), &st) != 0) return 0;
+    return (size_t)st.st_size;
+}
+
+void fs::File::close() {
+    if (_p) _p->close();
+    _p.reset();
+}
+
+fs::File::operator bool() const {
+    return _p && (_p->fp || _p->dir);
+}
+
+time_t fs::File::getLastWrite() {
+    if (!_p) return 0;
+    struct stat st;
+    if (stat(_p->fullPath.c_str(), &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+const char *fs::File::path() const {
+    return _p ? _p->path.c_str() : nullptr;
+}
+
+const char *fs::File::name() const {
+    return _p ? _p->baseName.c_str() : nullptr;
+}
+
+bool fs::File::isDirectory() {
+    return _p && _p->dir;
+}
+
+fs::File fs::File::openNextFile(const char *mode) {
+    if (!_p || !_p->dir) return File();
+    struct dirent *entry;
+    while ((entry = readdir(_p->dir)) != nullptr) {
+        // Hidden entries (the NVS store) are not on the LittleFS partition
+        if (entry->d_name[0] == '.') continue;
+        std::string child = _p->path;
+        if (child.empty() || child.back() != '/') child += "/";
+        child += entry->d_name;
+        return LittleFS.open(child.c_str(), mode);
+    }
+    return File();
+}
+
+void fs::File::rewindDirectory() {
+    if (_p && _p->dir) rewinddir(_p->dir);
+}
+
+// ========================================
+// fs::FS
+// ========================================
+
+fs::File fs::FS::open(const char *path, const char *mode, const bool create) {
+    (void)create;
+    if (!_mounted || !path) return File();
+
+    std::string full = hostPath(path);
+    FileImplPtr impl = std::make_shared<FileImpl>();
+    impl->path = path;
+    impl->fullPath = full;
+    impl->baseName = baseNameOf(impl->path);
+
+    struct stat st;
+    if (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        impl->dir = opendir(full.c_str());
+        return impl->dir ? File(impl) : File();
+    }
+
+    const char *fmode = "rb";
+    if (strcmp(mode, "w") == 0) fmode = "wb";
+    else if (strcmp(mode, "a") == 0) fmode = "ab";
+    else if (strcmp(mode, "r+") == 0) fmode = "r+b";
+    else if (strcmp(mode, "w+") == 0) fmode = "w+b";
+    else if (strcmp(mode, "a+") == 0) fmode = "a+b";
+
+    impl->fp = fopen(full.c_str(), fmode);
+    if (!impl->fp) return File();
+    impl->writable = fmode[0] != 'r' || fmode[1] == '+' || fmode[2] == '+';
+
+    if (impl->writable) hostFlashCountWrite(0, true);
+    else hostFlashCountRead(0, true);
+    return File(impl);
+}
+
+fs::File fs::FS::open(const String &path, const char *mode, const bool create) {
+    return open(path.c_str(), mode, create);
+}
+
+bool fs::FS::exists(const char *path) {
+    if (!_mounted) return false;
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool fs::FS::exists(const String &path) { return exists(path.c_str()); }
+
+bool fs::FS::remove(const char *path) {
+    if (!_mounted) return false;
+    return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool fs::FS::remove(const String &path) { return remove(path.c_str()); }
+
+bool fs::FS::rename(const char *pathFrom, const char *pathTo) {
+    if (!_mounted) return false;
+    return ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool fs::FS::rename(const String &pathFrom, const String &pathTo) {
+    return rename(pathFrom.c_str(), pathTo.c_str());
+}
+
+bool fs::FS::mkdir(const char *path) {
+    if (!_mounted) return false;
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool fs::FS::mkdir(const String &path) { return mkdir(path.c_str()); }
+
+bool fs::FS::rmdir(const char *path) {
+    if (!_mounted) return false;
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+bool fs::FS::rmdir(const String &path) { return rmdir(path.c_str()); }
+
+// ========================================
+// LittleFS
+// ========================================
+
+bool fs::LittleFSFS::begin(bool formatOnFail, const char *basePath,
+                           uint8_t maxOpenFiles, const char *partitionLabel) {
+    (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+    struct stat st;
+    if (stat(hostFsRoot(), &st) != 0) {
+        if (!formatOnFail || ::mkdir(hostFsRoot(), 0755) != 0) return false;
+    }
+    _mounted = true;
+    return true;
+}
+
+bool fs::LittleFSFS::format() {
+    DIR *d = opendir(hostFsRoot());
+    if (!d) return false;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+        unlink((std::string(hostFsRoot()) + "/" + entry->d_name).c_str());
+    }
+    closedir(d);
+    return true;
+}
+
+size_t fs::LittleFSFS::totalBytes() {
+    return HOST_FLASH_PARTITION_BYTES;
+}
+
+static size_t usedBlocks(const std::string &dirPath) {
+    DIR *d = opendir(dirPath.c_str());
+    if (!d) return 0;
+    size_t blocks = 1;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr) {
+        // Hidden entries (the NVS store) are not on the LittleFS partition
+        if (entry->d_name[0] == '.') continue;
+        std::string child = dirPath + "/" + entry->d_name;
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            blocks += usedBlocks(child);
+        } else {
+            blocks += 1 + (st.st_size + HOST_FLASH_BLOCK_BYTES - 1) / HOST_FLASH_BLOCK_BYTES;
+        }
+    }
+    closedir(d);
+    return blocks;
+}
+
+size_t fs::LittleFSFS::usedBytes() {
+    return usedBlocks(hostFsRoot()) * HOST_FLASH_BLOCK_BYTES;
+}
+
+void fs::LittleFSFS::end() {
+    _mounted = false;
+}
@@ -0,0 +1,685 @@
+// ========================================
+// feeder_host - runs the firmware on Linux
+// ========================================
+// Each simulated boot forks a child that runs the real setup()/loop().
+// When the firmware calls esp_deep_sleep_start() the child exits, the
+// parent fast-forwards the virtual clock to the earliest armed wake
+// source and forks the next boot. With --fast a simulated year of wakes
+// takes seconds; --days reports it per calendar day and --trace writes
+// every wake, dispense and flash write to a CSV file.
+
+#include "Arduino.h"
+#include "RTClib.h"
+#include "esp_sleep.h"
+#include "host_hal.h"
+#include "config.h"
+#include "LittleFS.h"
+#include "Wire.h"
+#include "alarm_manager.h"
+#include "servo_control.h"
+#include "rtc_state.h"
+#include "energy_model.h"
+#include "servo_control.h"
+#include <dirent.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <string>
+#include <algorithm>
+
+void setup();
+void loop();
+
+HostDevice *hostDevice = nullptr;
+
+// Bounds of the RTC_DATA_ATTR section, provided by the linker
+extern "C" char __start_rtc_data[] __attribute__((weak));
+extern "C" char __stop_rtc_data[] __attribute__((weak));
+
+// ROM bootloader and app start-up before setup() runs
+#define HOST_WAKE_LATENCY_US 300000ULL
+// How long a simulated button press is held down
+#define HOST_BUTTON_HOLD_US 1500000ULL
+
+// Simulation limits (--boots, --until), also checked by light sleeps
+static uint32_t maxBoots = 0;
+static uint32_t until = 0;
+
+// --trace output; written by the parent and, between its flushes, each boot
+static FILE *traceFile = nullptr;
+
+// ========================================
+// Accounting
+// ========================================
+
+const char *hostFsRoot() {
+    return hostDevice->fsRoot;
+}
+
+void hostFlashCountWrite(size_t bytes, bool newFile) {
+    hostDevice->flashBoot.bytesWritten += bytes;
+    hostDevice->flashTotal.bytesWritten += bytes;
+    if (newFile) {
+        hostDevice->flashBoot.filesOpenedForWrite++;
+        hostDevice->flashTotal.filesOpenedForWrite++;
+    }
+    if (HostDayStats *day = hostDayStats(hostRtcUnix())) {
+        day->flashBytesWritten += bytes;
+        if (newFile) day->flashFilesWritten++;
+    }
+}
+
+void hostFlashCountRead(size_t bytes, bool newFile) {
+    hostDevice->flashBoot.bytesRead += bytes;
+    hostDevice->flashTotal.bytesRead += bytes;
+    if (newFile) {
+        hostDevice->flashBoot.filesRead++;
+        hostDevice->flashTotal.filesRead++;
+    }
+}
+
+HostDayStats *hostDayStats(uint32_t unixTime) {
+    uint32_t day = unixTime / 86400;
+    if (hostDevice->simDays == 0 || day < hostDevice->firstDay) return nullptr;
+    day -= hostDevice->firstDay;
+    return day < hostDevice->simDays ? &hostDevice->days[day] : nullptr;
+}
+
+// ========================================
+// Trace (--trace)
+// ========================================
+// One CSV row per event: RTC unix time, boot number, event, detail
+
+static void trace(const char *event, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void trace(const char *event, const char *format, ...) {
+    if (!traceFile) return;
+    fprintf(traceFile, "%u,%u,%s,", hostRtcUnix(), hostDevice->bootCount, event);
+    va_list args;
+    va_start(args, format);
+    vfprintf(traceFile, format, args);
+    va_end(args);
+    fputc('\n', traceFile);
+}
+
+void hostTraceFlashWrite(const char *path, size_t bytes) {
+    trace("flash-write", "%s %zu bytes", path, bytes);
+}
+
+// Counts the dispense jobs the motion engine has finished since the last
+// call. Job ids restart with each boot.
+static void countDispenses() {
+    uint32_t last = lastFinishedJobId();
+    for (uint32_t id = hostDevice->countedJobId + 1; id <= last; id++) {
+        MotionJob job;
+        if (!findMotionJob(id, job) || job.kind != MOTION_DISPENSE) continue;
+        hostDevice->dispensesBoot++;
+        hostDevice->dispensesTotal++;
+        if (HostDayStats *day = hostDayStats(hostRtcUnix())) day->dispenses++;
+        trace("dispense", "chamber %u%s", job.chamber, job.manual ? " manual" : "");
+    }
+    if (last > hostDevice->countedJobId) hostDevice->countedJobId = last;
+}
+
+// The firmware programs the full trigger time, but the DS3231 only
+// compares the fields its alarm mode selects. Reports a wake at any
+// other time than the one programmed.
+static void checkAlarmWake(uint64_t wakeUs, int cause) {
+    const HostRtcChip &rtc = hostDevice->rtc;
+    if (cause != ESP_SLEEP_WAKEUP_EXT0 || rtc.alarm1Unix == 0) return;
+    uint32_t wakeUnix = (uint32_t)(rtc.offsetSeconds + (int64_t)(wakeUs / 1000000ULL));
+    if (wakeUnix == rtc.alarm1Unix) return;
+
+    hostDevice->alarmMismatchesTotal++;
+    if (HostDayStats *day = hostDayStats(wakeUnix)) day->alarmMismatches++;
+    fprintf(stderr, "[host] RTC alarm woke the device at %u, programmed for %u\n", wakeUnix, rtc.alarm1Unix);
+}
+
+// ========================================
+// Button
+// ========================================
+
+void hostPressButton(uint32_t atUnix, uint32_t holdMs) {
+    if (atUnix <= hostRtcUnix()) {
+        hostDevice->buttonHeldUntilUs = hostClockMicros() + holdMs * 1000ULL;
+        return;
+    }
+    if (hostDevice->buttonPressCount < HOST_MAX_BUTTON_PRESSES) {
+        hostDevice->buttonPresses[hostDevice->buttonPressCount] = atUnix;
+        hostDevice->buttonPressHoldMs[hostDevice->buttonPressCount] = holdMs;
+        hostDevice->buttonPressCount++;
+    }
+}
+
+// ========================================
+// Control endpoints (/__host/*)
+// ========================================
+
+static long queryValue(const char *query, const char *key, bool &found) {
+    size_t keyLen = strlen(key);
+    const char *p = query;
+    while (p && *p) {
+        if (strncmp(p, key, keyLen) == 0 && p[keyLen] == '=') {
+            found = true;
+            return strtol(p + keyLen + 1, nullptr, 10);
+        }
+        p = strchr(p, '&');
+        if (p) p++;
+    }
+    found = false;
+    return 0;
+}
+
+bool hostHandleControl(const char *method, const char *uri, const char *query, HostHttpReply &reply) {
+    reply.code = 200;
+    reply.type = "application/json";
+    reply.body[0] = '\0';
+    bool found = false;
+
+    if (strcmp(uri, "/__host/clock") == 0) {
+        if (strcmp(method, "POST") == 0) {
+            long advance = queryValue(query, "advance", found);
+            if (found && advance > 0) hostClockAdvance((uint64_t)advance * 1000000ULL);
+            long set = queryValue(query, "set", found);
+            if (found) hostRtcSet((uint32_t)set);
+        }
+        snprintf(reply.body, sizeof(reply.body),
+                 "{\"clockUs\":%llu,\"millis\":%lu,\"rtcUnix\":%u,\"boot\":%u}",
+                 (unsigned long long)hostClockMicros(), millis(), hostRtcUnix(), hostDevice->bootCount);
+        return true;
+    }
+
+    if (strcmp(uri, "/__host/button") == 0 && strcmp(method, "POST") == 0) {
+        long ms = queryValue(query, "ms", found);
+        hostPressButton(hostRtcUnix(), found ? (uint32_t)ms : HOST_BUTTON_HOLD_US / 1000);
+        snprintf(reply.body, sizeof(reply.body), "{\"pressed\":true}");
+        return true;
+    }
+
+    if (strcmp(uri, "/__host/battery") == 0) {
+        if (strcmp(method, "POST") == 0) {
+            long mv = queryValue(query, "mv", found);
+            if (found) hostSetBattery(mv / 1000.0f);
+        }
+        snprintf(reply.body, sizeof(reply.body), "{\"openCircuitV\":%.3f,\"loadMa\":%.1f}",
+                 hostDevice->battery.openCircuitV, hostLoadCurrentMa());
+        return true;
+    }
+
+    if (strcmp(uri, "/__host/wifi") == 0) {
+        if (strcmp(method, "POST") == 0) {
+            long stations = queryValue(query, "stations", found);
+            if (found) hostDevice->apStations = (uint8_t)stations;
+        }
+        snprintf(reply.body, sizeof(reply.body), "{\"apActive\":%s,\"stations\":%u}",
+                 hostDevice->wifiApActive ? "true" : "false", hostDevice->apStations);
+        return true;
+    }
+
+    if (strcmp(uri, "/__host/servo") == 0) {
+        if (strcmp(method, "POST") == 0) {
+            long jam = queryValue(query, "jam", found);
+            if (found) hostDevice->servo.jammed = jam != 0;
+        }
+        snprintf(reply.body, sizeof(reply.body), "{\"pulseUs\":%d,\"moves\":%u,\"jammed\":%s}",
+                 hostDevice->servo.pulseUs, hostDevice->servo.moves,
+                 hostDevice->servo.jammed ? "true" : "false");
+        return true;
+    }
+
+    if (strcmp(uri, "/__host/status") == 0) {
+        hostEnergyAccrue();
+        snprintf(reply.body, sizeof(reply.body),
+                 "{\"boot\":%u,\"wakeCause\":%d,\"rtcUnix\":%u,\"servoPulseUs\":%d,\"servoMoves\":%u,"
+                 "\"servoPowered\":%s,\"flashFilesWritten\":%u,\"flashBytesWritten\":%u,\"flashFilesRead\":%u,"
+                 "\"energyMj\":%.1f,\"servoEnergyMj\":%.1f}",
+                 hostDevice->bootCount, hostDevice->wakeCause, hostRtcUnix(),
+                 hostDevice->servo.pulseUs, hostDevice->servo.moves,
+                 hostDevice->pinLevel[SERVO_TRANSISTOR_PIN] == HIGH ? "true" : "false",
+                 hostDevice->flashBoot.filesOpenedForWrite, hostDevice->flashBoot.bytesWritten,
+                 hostDevice->flashBoot.filesRead, hostDevice->energy.bootMj, hostDevice->energy.servoBootMj);
+        return true;
+    }
+
+    reply.code = 404;
+    snprintf(reply.body, sizeof(reply.body), "{\"error\":\"unknown host endpoint\"}");
+    return true;
+}
+
+// ========================================
+// Boot cycle
+// ========================================
+
+static const char *wakeCauseName(int cause) {
+    switch (cause) {
+    case ESP_SLEEP_WAKEUP_EXT0: return "rtc-alarm";
+    case ESP_SLEEP_WAKEUP_EXT1: return "button";
+    case ESP_SLEEP_WAKEUP_TIMER: return "timer";
+    case ESP_SLEEP_WAKEUP_ULP: return "ulp-button";
+    default: return "reset";
+    }
+}
+
+void hostEndBoot() {
+    // Collapse realtime drift into the shared clock before leaving
+    hostClockMicros();
+    hostEnergyAccrue();
+    countDispenses();
+
+    size_t rtcSize = (size_t)(__stop_rtc_data - __start_rtc_data);
+    if (__start_rtc_data && rtcSize <= HOST_RTC_MEMORY_SIZE) {
+        memcpy(hostDevice->rtcMemory, __start_rtc_data, rtcSize);
+        hostDevice->rtcMemorySize = rtcSize;
+        hostDevice->rtcMemoryValid = true;
+    }
+
+    if (traceFile) fflush(traceFile);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+
+void hostLightSleep() {
+    hostClockMicros();
+    hostEnergyAccrue();
+    countDispenses();
+
+    uint64_t nowUs = hostDevice->clockUs;
+    uint64_t wakeUs = 0;
+    uint64_t releaseUs = 0;
+    int cause = 0;
+    bool viaUlp = false;
+    if (!hostNextWake(wakeUs, cause, releaseUs, viaUlp)) {
+        fprintf(stderr, "[host] no wake source armed, device sleeps forever\n");
+        hostDevice->simulationEnded = true;
+        hostEndBoot();
+    }
+    if (wakeUs < nowUs) wakeUs = nowUs;
+
+    uint32_t wakeUnix = (uint32_t)(hostDevice->rtc.offsetSeconds + (int64_t)(wakeUs / 1000000ULL));
+    bool outOfBoots = maxBoots != 0 && hostDevice->bootCount + hostDevice->lightWakesTotal >= maxBoots;
+    if (outOfBoots || (until != 0 && wakeUnix > until)) {
+        hostDevice->simulationEnded = true;
+        hostEndBoot();
+    }
+
+    hostDevice->lightSleeping = true;
+    hostClockAdvance(wakeUs - nowUs);
+    hostEnergyAccrue();
+    hostDevice->lightSleeping = false;
+
+    hostDevice->lightSleeps++;
+    hostDevice->lightSleepUs += wakeUs - nowUs;
+    hostDevice->lightWakesTotal++;
+    hostDeliverWake(cause, viaUlp);
+    checkAlarmWake(wakeUs, cause);
+    if (HostDayStats *day = hostDayStats(wakeUnix)) day->lightWakes++;
+    trace("light-wake", "%s", wakeCauseName(cause));
+    if (cause == ESP_SLEEP_WAKEUP_EXT1 || cause == ESP_SLEEP_WAKEUP_ULP) {
+        hostDevice->buttonHeldUntilUs = releaseUs;
+    }
+}
+
+static void restoreRtcMemory(bool keep) {
+    size_t rtcSize = (size_t)(__stop_rtc_data - __start_rtc_data);
+    if (rtcSize > HOST_RTC_MEMORY_SIZE) {
+        fprintf(stderr, "[host] RTC_DATA_ATTR section is %zu bytes, only %d simulated\n",
+                rtcSize, HOST_RTC_MEMORY_SIZE);
+        _exit(2);
+    }
+    if (keep && __start_rtc_data && hostDevice->rtcMemoryValid && hostDevice->rtcMemorySize == rtcSize) {
+        memcpy(__start_rtc_data, hostDevice->rtcMemory, rtcSize);
+    }
+}
+
+[[noreturn]] static void runFirmware() {
+    // Like ESP-IDF, RTC_DATA_ATTR variables are only kept on deep sleep wakes;
+    // a reset boot starts from their initializers
+    restoreRtcMemory(hostDevice->wakeCause != ESP_SLEEP_WAKEUP_UNDEFINED);
+
+    hostClockReanchor();
+    setup();
+    for (;;) {
+        loop();
+    }
+}
+
+// ========================================
+// Battery-life projection (--project)
+// ========================================
+// Runs the firmware's energy model against the flash image and the RTC
+// memory left by the last simulated boot, so the costs measured during a
+// run feed the projection. A child process keeps the firmware globals
+// out of the parent, as for a boot.
+
+[[noreturn]] static void runProjection(long intervalMinutes) {
+    restoreRtcMemory(true);
+    hostDevice->quiet = false;
+
+    LittleFS.begin(true);
+    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+    rtc.begin(&Wire);
+    currentSensorFound = ina219.begin();
+    loadSchedulerState();
+    sampleBattery(true);
+
+    float feedsPerDay;
+    if (intervalMinutes > 0) {
+        Serial.printf("Projecting a %ld minute interval at %d%% charge\n", intervalMinutes, batteryReading.percent);
+        feedsPerDay = intervalFeedsPerDay(intervalMinutes * 60UL);
+    } else {
+        Serial.printf("Projecting the stored %s schedule at %d%% charge\n",
+                      modeConfig.activeMode.c_str(), batteryReading.percent);
+        feedsPerDay = scheduleFeedsPerDay(scheduleModeFromString(modeConfig.activeMode));
+    }
+    printEnergyProjection(projectEnergy(feedsPerDay));
+
+    fflush(stdout);
+    _exit(0);
+}
+
+static void copyDataDir(const char *from, const char *to) {
+    DIR *d = opendir(from);
+    if (!d) {
+        fprintf(stderr, "[host] cannot read data directory %s\n", from);
+        return;
+    }
+    mkdir(to, 0755);
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+        std::string src = std::string(from) + "/" + entry->d_name;
+        std::string dst = std::string(to) + "/" + entry->d_name;
+        FILE *in = fopen(src.c_str(), "rb");
+        if (!in) continue;
+        FILE *out = fopen(dst.c_str(), "wb");
+        if (out) {
+            char buf[4096];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), in)) > 0) fwrite(buf, 1, n, out);
+            fclose(out);
+        }
+        fclose(in);
+    }
+    closedir(d);
+}
+
+// ========================================
+// Daily report (--days)
+// ========================================
+
+static double secondsSince(const struct timespec &start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void printDailyReport(uint32_t lastUnix, double wallSeconds) {
+    fprintf(stderr, "[host] day         wakes  light  dispenses  flash files  flash bytes  energy mJ  alarm mismatches\n");
+    uint32_t wakes = 0;
+    for (uint32_t i = 0; i < hostDevice->simDays && hostDevice->firstDay + i <= lastUnix / 86400; i++) {
+        const HostDayStats &day = hostDevice->days[i];
+        DateTime date((hostDevice->firstDay + i) * 86400UL);
+        fprintf(stderr, "[host] %04d-%02d-%02d  %5u  %5u  %9u  %11u  %11u  %9.1f  %16u\n",
+                date.year(), date.month(), date.day(), day.wakes, day.lightWakes, day.dispenses,
+                day.flashFilesWritten, day.flashBytesWritten, day.energyMj, day.alarmMismatches);
+        wakes += day.wakes + day.lightWakes;
+    }
+
+    double simulatedDays = (lastUnix - hostDevice->rtc.offsetSeconds) / 86400.0;
+    if (simulatedDays <= 0) return;
+    fprintf(stderr, "[host] %.1f days simulated in %.2f s: %u wakes, %u dispenses, %u alarm mismatches, "
+                    "%.2f ms per simulated day\n",
+            simulatedDays, wallSeconds, wakes, hostDevice->dispensesTotal, hostDevice->alarmMismatchesTotal,
+            wallSeconds * 1000.0 / simulatedDays);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --fs DIR          directory backing LittleFS (default ./host_fs)\n"
+            "  --data DIR        seed an empty --fs directory from DIR (e.g. ../data)\n"
+            "  --port N          serve HTTP on 127.0.0.1:N (default 8080, 0 disables)\n"
+            "  --fast            virtual time only moves on delay(); sleeps are instant\n"
+            "  --epoch UNIX      initial RTC time (default: host local time)\n"
+            "  --wake CAUSE      first boot cause: reset, button or rtc (default reset)\n"
+            "  --press UNIX[:MS] schedule a button press held MS ms (default 1500, repeatable)\n"
+            "  --boots N         stop after N boots (light-sleep wakes count too)\n"
+            "  --until UNIX      stop once the RTC passes UNIX\n"
+            "  --days N          run N days from --epoch and print a per-day report\n"
+            "                    instead of a line per boot (use with --fast)\n"
+            "  --trace FILE      write every wake, dispense and flash write to FILE as CSV\n"
+            "  --seed N          seed for random()\n"
+            "  --quiet           suppress firmware serial output\n"
+            "  --trace-http      log each request with its latency\n"
+            "  --project[=MIN]   print the battery-life projection for the stored schedule,\n"
+            "                    or a MIN minute interval, after the boots (alone: no boots)\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    void *shared = mmap(nullptr, sizeof(HostDevice), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    hostDevice = (HostDevice *)shared;
+    memset(hostDevice, 0, sizeof(HostDevice));
+
+    // Defaults: a 2S Li-ion pack behind the INA219
+    hostDevice->realtime = true;
+    hostDevice->httpPort = 8080;
+    hostDevice->rngState = 0x12345678u;
+    hostDevice->battery = {7.80f, 0.15f, 45.0f, 110.0f, 12.0f, 550.0f, 0.8f};
+    hostDevice->apStations = 1;
+    hostDevice->servo.pulseUs = MIN_PULSE;
+    hostDevice->rtc.sqwMode = DS3231_SquareWave1Hz;
+    snprintf(hostDevice->fsRoot, sizeof(hostDevice->fsRoot), "host_fs");
+
+    time_t wall = time(nullptr);
+    struct tm local;
+    localtime_r(&wall, &local);
+    uint32_t epoch = (uint32_t)(wall + local.tm_gmtoff);  // RTC keeps local (AEST) time
+    int firstCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    const char *dataDir = nullptr;
+    bool project = false;
+    long projectMinutes = 0;
+    uint32_t days = 0;
+    const char *tracePath = nullptr;
+
+    static struct option options[] = {
+        {"fs", required_argument, nullptr, 'f'},
+        {"data", required_argument, nullptr, 'd'},
+        {"port", required_argument, nullptr, 'p'},
+        {"fast", no_argument, nullptr, 'F'},
+        {"epoch", required_argument, nullptr, 'e'},
+        {"wake", required_argument, nullptr, 'w'},
+        {"press", required_argument, nullptr, 'b'},
+        {"boots", required_argument, nullptr, 'n'},
+        {"until", required_argument, nullptr, 'u'},
+        {"days", required_argument, nullptr, 'D'},
+        {"trace", required_argument, nullptr, 'T'},
+        {"seed", required_argument, nullptr, 's'},
+        {"quiet", no_argument, nullptr, 'q'},
+        {"trace-http", no_argument, nullptr, 't'},
+        {"project", optional_argument, nullptr, 'P'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", options, nullptr)) != -1) {
+        switch (opt) {
+        case 'f': snprintf(hostDevice->fsRoot, sizeof(hostDevice->fsRoot), "%s", optarg); break;
+        case 'd': dataDir = optarg; break;
+        case 'p': hostDevice->httpPort = atoi(optarg); break;
+        case 'F': hostDevice->realtime = false; break;
+        case 'e': epoch = strtoul(optarg, nullptr, 10); break;
+        case 'w':
+            if (strcmp(optarg, "button") == 0) firstCause = ESP_SLEEP_WAKEUP_EXT1;
+            else if (strcmp(optarg, "rtc") == 0) firstCause = ESP_SLEEP_WAKEUP_EXT0;
+            break;
+        case 'b':
+            if (hostDevice->buttonPressCount < HOST_MAX_BUTTON_PRESSES) {
+                char *end = nullptr;
+                hostDevice->buttonPresses[hostDevice->buttonPressCount] = strtoul(optarg, &end, 10);
+                hostDevice->buttonPressHoldMs[hostDevice->buttonPressCount] =
+                    *end == ':' ? strtoul(end + 1, nullptr, 10) : HOST_BUTTON_HOLD_US / 1000;
+                hostDevice->buttonPressCount++;
+            }
+            break;
+        case 'n': maxBoots = strtoul(optarg, nullptr, 10); break;
+        case 'u': until = strtoul(optarg, nullptr, 10); break;
+        case 'D': days = strtoul(optarg, nullptr, 10); break;
+        case 'T': tracePath = optarg; break;
+        case 's': hostDevice->rngState = strtoul(optarg, nullptr, 10); break;
+        case 'q': hostDevice->quiet = true; break;
+        case 't': hostDevice->traceHttp = true; break;
+        case 'P':
+            project = true;
+            if (optarg) projectMinutes = strtol(optarg, nullptr, 10);
+            break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    struct stat st;
+    if (dataDir && stat(hostDevice->fsRoot, &st) != 0) {
+        copyDataDir(dataDir, hostDevice->fsRoot);
+    }
+
+    if (days > 0) {
+        days = std::min(days, (uint32_t)HOST_MAX_SIM_DAYS - 1);
+        if (until == 0) until = epoch + days * 86400UL;
+        hostDevice->firstDay = epoch / 86400;
+        hostDevice->simDays = days + 1;
+    }
+    if (tracePath) {
+        traceFile = fopen(tracePath, "w");
+        if (!traceFile) {
+            perror(tracePath);
+            return 1;
+        }
+        fprintf(traceFile, "unix,boot,event,detail\n");
+    }
+
+    hostDevice->rtc.offsetSeconds = epoch;
+    hostDevice->rtc.lastEvaluatedUnix = epoch;
+    hostDevice->wakeCause = firstCause;
+    if (firstCause == ESP_SLEEP_WAKEUP_EXT1) hostDevice->buttonHeldUntilUs = HOST_BUTTON_HOLD_US;
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // --project on its own only evaluates the existing flash image
+    bool simulate = !project || maxBoots != 0 || until != 0;
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    for (uint32_t boot = 1; simulate && (maxBoots == 0 || boot + hostDevice->lightWakesTotal <= maxBoots); boot++) {
+        hostDevice->bootCount = boot;
+        hostDevice->bootStartUs = hostDevice->clockUs;
+        hostDevice->sleepRequested = false;
+        hostDevice->lightSleeps = 0;
+        hostDevice->lightSleepUs = 0;
+        int bootCause = hostDevice->wakeCause;
+        memset(&hostDevice->sleep, 0, sizeof(hostDevice->sleep));
+        memset(&hostDevice->flashBoot, 0, sizeof(hostDevice->flashBoot));
+        hostDevice->energy.accountedUs = hostDevice->clockUs;
+        hostDevice->energy.bootMj = 0;
+        hostDevice->energy.servoBootMj = 0;
+        memset(hostDevice->pinLevel, 0, sizeof(hostDevice->pinLevel));
+        memset(hostDevice->pinMode, 0, sizeof(hostDevice->pinMode));
+        hostDevice->servo.attached = false;
+        hostDevice->wifiApActive = false;
+        hostDevice->countedJobId = 0;
+        hostDevice->dispensesBoot = 0;
+
+        if (HostDayStats *day = hostDayStats(hostRtcUnix())) day->wakes++;
+        trace("wake", "%s", wakeCauseName(bootCause));
+
+        if (traceFile) fflush(traceFile);
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            runFirmware();
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "[host] boot %u crashed (status %d)\n", boot, status);
+            return 1;
+        }
+
+        uint64_t awakeUs = hostDevice->clockUs - hostDevice->bootStartUs - hostDevice->lightSleepUs;
+        char lightSleep[64] = "";
+        if (hostDevice->lightSleeps > 0) {
+            snprintf(lightSleep, sizeof(lightSleep), " + %u light sleeps %.1f s",
+                     hostDevice->lightSleeps, hostDevice->lightSleepUs / 1e6);
+        }
+        if (hostDevice->simDays == 0) {
+            fprintf(stderr,
+                    "[host] boot %u (%s) awake %.3f s%s, flash: %u files / %u bytes written, %u files read, "
+                    "energy %.1f mJ (servo %.1f mJ)\n",
+                    boot, wakeCauseName(bootCause), awakeUs / 1e6, lightSleep,
+                    hostDevice->flashBoot.filesOpenedForWrite, hostDevice->flashBoot.bytesWritten,
+                    hostDevice->flashBoot.filesRead, hostDevice->energy.bootMj, hostDevice->energy.servoBootMj);
+        }
+
+        if (hostDevice->simulationEnded) break;
+
+        if (!hostDevice->sleepRequested) {
+            // ESP.restart(): reboot straight away
+            hostDevice->clockUs += HOST_WAKE_LATENCY_US;
+            continue;
+        }
+
+        uint64_t wakeUs = 0;
+        uint64_t releaseUs = 0;
+        int cause = 0;
+        bool viaUlp = false;
+        if (!hostNextWake(wakeUs, cause, releaseUs, viaUlp)) {
+            fprintf(stderr, "[host] no wake source armed, device sleeps forever\n");
+            break;
+        }
+
+        hostDevice->clockUs = wakeUs + HOST_WAKE_LATENCY_US;
+        hostDeliverWake(cause, viaUlp);
+        if (cause == ESP_SLEEP_WAKEUP_EXT1 || cause == ESP_SLEEP_WAKEUP_ULP) {
+            hostDevice->buttonHeldUntilUs = releaseUs;
+        }
+
+        uint32_t nowUnix = (uint32_t)(hostDevice->rtc.offsetSeconds + (int64_t)(hostDevice->clockUs / 1000000ULL));
+        if (until != 0 && nowUnix > until) break;
+        checkAlarmWake(wakeUs, cause);
+    }
+
+    if (simulate) {
+        fprintf(stderr, "[host] total flash: %u files / %u bytes written, %u files / %u bytes read\n",
+                hostDevice->flashTotal.filesOpenedForWrite, hostDevice->flashTotal.bytesWritten,
+                hostDevice->flashTotal.filesRead, hostDevice->flashTotal.bytesRead);
+        fprintf(stderr, "[host] total energy: %.1f mJ awake, %.1f mJ through the servo transistor\n",
+                hostDevice->energy.totalMj, hostDevice->energy.servoTotalMj);
+        if (hostDevice->simDays > 0) printDailyReport(std::min(hostRtcUnix(), until), secondsSince(started));
+    }
+    if (traceFile) fclose(traceFile);
+
+    if (project) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            runProjection(projectMinutes);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+    return 0;
+}
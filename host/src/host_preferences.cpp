@@ -0,0 +1,104 @@
+#include "Preferences.h"
+#include "host_hal.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+// ========================================
+// Host NVS backend
+// ========================================
+// The directory is hidden, so LittleFS.format() and the used-space figure
+// leave it alone, as they do the NVS partition on the ESP32. Writes and
+// reads are counted with the flash traffic, one file per NVS entry.
+
+// NVS namespace and key names are at most 15 characters
+#define HOST_NVS_KEY_MAX 15
+
+static std::string nvsDir(const char *name) {
+    return std::string(hostFsRoot()) + "/.nvs/" + name;
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partitionLabel) {
+    (void)partitionLabel;
+    if (_started || !name || strlen(name) > HOST_NVS_KEY_MAX) return false;
+
+    std::string dir = nvsDir(name);
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0) {
+        // As on the ESP32, a read-only begin needs the namespace to exist
+        if (readOnly) return false;
+        ::mkdir((std::string(hostFsRoot()) + "/.nvs").c_str(), 0755);
+        if (::mkdir(dir.c_str(), 0755) != 0) return false;
+    }
+    _dir = dir.c_str();
+    _readOnly = readOnly;
+    _started = true;
+    return true;
+}
+
+void Preferences::end() {
+    _started = false;
+}
+
+bool Preferences::clear() {
+    if (!_started || _readOnly) return false;
+    DIR *d = opendir(_dir.c_str());
+    if (!d) return false;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+        unlink((std::string(_dir.c_str()) + "/" + entry->d_name).c_str());
+    }
+    closedir(d);
+    return true;
+}
+
+bool Preferences::remove(const char *key) {
+    if (!_started || _readOnly || !key) return false;
+    return unlink((std::string(_dir.c_str()) + "/" + key).c_str()) == 0;
+}
+
+bool Preferences::isKey(const char *key) {
+    return getBytesLength(key) > 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+    if (!_started || _readOnly || !key || strlen(key) > HOST_NVS_KEY_MAX || !value || len == 0) return 0;
+
+    std::string path = std::string(_dir.c_str()) + "/" + key;
+    std::string temp = path + ".tmp";
+    FILE *fp = fopen(temp.c_str(), "wb");
+    if (!fp) return 0;
+    size_t written = fwrite(value, 1, len, fp);
+    fclose(fp);
+    if (written != len || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return 0;
+    }
+
+    hostFlashCountWrite(len, true);
+    hostTraceFlashWrite((std::string("nvs:") + key).c_str(), len);
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    if (!_started || !key) return 0;
+    struct stat st;
+    if (stat((std::string(_dir.c_str()) + "/" + key).c_str(), &st) != 0) return 0;
+    return st.st_size;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+    size_t len = getBytesLength(key);
+    // NVS refuses a buffer smaller than the blob
+    if (len == 0 || !buf || maxLen < len) return 0;
+
+    FILE *fp = fopen((std::string(_dir.c_str()) + "/" + key).c_str(), "rb");
+    if (!fp) return 0;
+    size_t n = fread(buf, 1, len, fp);
+    fclose(fp);
+    hostFlashCountRead(n, true);
+    return n;
+}
@@ -0,0 +1,207 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ========================================
+// Number formatting
+// ========================================
+
+static std::string formatUnsigned(unsigned long long value, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    if (value == 0) return "0";
+    char buf[65];
+    int i = 64;
+    buf[i] = '\0';
+    while (value > 0 && i > 0) {
+        int digit = value % base;
+        buf[--i] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    }
+    return std::string(&buf[i]);
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+    if (value < 0 && base == 10) {
+        return "-" + formatUnsigned((unsigned long long)(-(value + 1)) + 1, base);
+    }
+    return formatUnsigned((unsigned long long)value, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    return std::string(buf);
+}
+
+// ========================================
+// Construction
+// ========================================
+
+String::String(const char *cstr) : _s(cstr ? cstr : "") {}
+String::String(const char *cstr, size_t length) : _s(cstr ? std::string(cstr, length) : "") {}
+String::String(const __FlashStringHelper *str) : _s(str ? reinterpret_cast<const char *>(str) : "") {}
+String::String(char c) : _s(1, c) {}
+String::String(unsigned char value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(long long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+
+String &String::operator=(const char *cstr) {
+    _s = cstr ? cstr : "";
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    _s.reserve(size);
+    return true;
+}
+
+// ========================================
+// Concatenation
+// ========================================
+
+bool String::concat(const String &str) { _s += str._s; return true; }
+bool String::concat(const char *cstr) { if (!cstr) return false; _s += cstr; return true; }
+bool String::concat(const char *cstr, unsigned int length) { if (!cstr) return false; _s.append(cstr, length); return true; }
+bool String::concat(char c) { _s += c; return true; }
+bool String::concat(unsigned char num) { _s += formatUnsigned(num, 10); return true; }
+bool String::concat(int num) { _s += formatSigned(num, 10); return true; }
+bool String::concat(unsigned int num) { _s += formatUnsigned(num, 10); return true; }
+bool String::concat(long num) { _s += formatSigned(num, 10); return true; }
+bool String::concat(unsigned long num) { _s += formatUnsigned(num, 10); return true; }
+bool String::concat(long long num) { _s += formatSigned(num, 10); return true; }
+bool String::concat(unsigned long long num) { _s += formatUnsigned(num, 10); return true; }
+bool String::concat(float num) { _s += formatFloat(num, 2); return true; }
+bool String::concat(double num) { _s += formatFloat(num, 2); return true; }
+
+String operator+(const String &lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, const char *rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const char *lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, char rhs) { String s(lhs); s.concat(rhs); return s; }
+
+// ========================================
+// Comparison and search
+// ========================================
+
+int String::compareTo(const String &s) const { return _s.compare(s._s); }
+
+bool String::equalsIgnoreCase(const String &s) const {
+    if (_s.size() != s._s.size()) return false;
+    for (size_t i = 0; i < _s.size(); i++) {
+        if (tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i])) return false;
+    }
+    return true;
+}
+
+bool String::startsWith(const String &prefix) const { return startsWith(prefix, 0); }
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+    if (offset > _s.size() || prefix._s.size() > _s.size() - offset) return false;
+    return _s.compare(offset, prefix._s.size(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    if (suffix._s.size() > _s.size()) return false;
+    return _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+char String::charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+void String::setCharAt(unsigned int index, char c) { if (index < _s.size()) _s[index] = c; }
+char String::operator[](unsigned int index) const { return charAt(index); }
+
+char &String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _s.size()) { dummy = 0; return dummy; }
+    return _s[index];
+}
+
+void String::toCharArray(char *buf, unsigned int bufsize, unsigned int index) const {
+    if (!buf || bufsize == 0) return;
+    if (index >= _s.size()) { buf[0] = 0; return; }
+    size_t n = std::min((size_t)bufsize - 1, _s.size() - index);
+    memcpy(buf, _s.data() + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    size_t pos = _s.find(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+    size_t pos = _s.find(str._s, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const {
+    size_t pos = _s.rfind(ch);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    size_t pos = _s.rfind(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String &str) const {
+    size_t pos = _s.rfind(str._s);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String &str, unsigned int fromIndex) const {
+    size_t pos = _s.rfind(str._s, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const {
+    if (beginIndex >= _s.size()) return String();
+    return String(_s.c_str() + beginIndex);
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+    if (beginIndex >= _s.size()) return String();
+    if (endIndex > _s.size()) endIndex = _s.size();
+    return String(_s.data() + beginIndex, endIndex - beginIndex);
+}
+
+// ========================================
+// Modification
+// ========================================
+
+void String::replace(char find, char replace) {
+    for (auto &c : _s) if (c == find) c = replace;
+}
+
+void String::replace(const String &find, const String &replace) {
+    if (find._s.empty()) return;
+    size_t pos = 0;
+    while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+        _s.replace(pos, find._s.size(), replace._s);
+        pos += replace._s.size();
+    }
+}
+
+void String::remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+void String::remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+void String::toLowerCase() { for (auto &c : _s) c = tolower((unsigned char)c); }
+void String::toUpperCase() { for (auto &c : _s) c = toupper((unsigned char)c); }
+
+void String::trim() {
+    size_t first = 0;
+    while (first < _s.size() && isspace((unsigned char)_s[first])) first++;
+    size_t last = _s.size();
+    while (last > first && isspace((unsigned char)_s[last - 1])) last--;
+    _s = _s.substr(first, last - first);
+}
+
+long String::toInt() const { return atol(_s.c_str()); }
+float String::toFloat() const { return (float)atof(_s.c_str()); }
+double String::toDouble() const { return atof(_s.c_str()); }
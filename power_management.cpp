@@ -1,9 +1,46 @@
 #include "power_management.h"
 #include "storage.h"
 #include "servo_control.h"
+#include "types.h"
+#include "rtc_state.h"
+#include "energy_model.h"
+#include "boot_profile.h"
+#include "alarm_manager.h"
+#include "button_ulp.h"
 #include <WiFi.h>
 #include <Wire.h>
 
+// ========================================
+// Helpers
+// ========================================
+
+// The wake cost is measured up to the first sleep of a scheduled boot;
+// time spent in light sleep after it would be charged as awake
+static void recordScheduledWakeTiming() {
+    static bool recorded = false;
+    if (recorded) return;
+    recorded = true;
+
+    scheduledWakeTiming.wakeToSleepMs = millis();
+    recordScheduledWake(scheduledWakeTiming.wakeToSleepMs, lastDispenseCapture.durationMs);
+    Serial.printf("Scheduled wake: dispensed at %lu ms, sleeping at %lu ms\n",
+                  scheduledWakeTiming.wakeToDispenseMs, scheduledWakeTiming.wakeToSleepMs);
+}
+
+static void enableWakeSources() {
+    // Sources armed for an earlier light sleep stay armed, and the ESP32
+    // refuses the ULP source while ext0 is one of them
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+
+    // The ULP watches the RTC alarm and only wakes the CPU for a debounced
+    // press; ext1 would wake it on any contact, so ext0 and ext1 are only
+    // the fallback
+    if (!startWakeUlp()) {
+        esp_sleep_enable_ext0_wakeup((gpio_num_t)RTC_ALARM_PIN, 0);
+        esp_sleep_enable_ext1_wakeup(1ULL << BUTTON_PIN, ESP_EXT1_WAKEUP_ANY_HIGH);
+    }
+}
+
 // ========================================
 // Power Management Functions
 // ========================================
@@ -12,22 +49,29 @@ void enterDeepSleep() {
     Serial.println("\n========================================");
     Serial.println("Preparing to enter deep sleep...");
     
-    // Save all data before sleeping
-    saveAlarms();
-    saveModeConfig();
-    saveCompartmentPosition();
+    // RTC memory keeps the state; flash only gets the dirty records
+    bool scheduledWake = wakeupCause() == ESP_SLEEP_WAKEUP_EXT0;
+    bootPhaseBegin(BOOT_PHASE_SLEEP_PREP);
+    captureRtcState();
+    flushDirty(scheduledWake, true);
+    bootPhaseEnd(BOOT_PHASE_SLEEP_PREP);
+    lastWakeFlashWrites = flashWrites;
+    Serial.printf("Flash writes this wake: %lu files, %lu bytes\n",
+                  flashWrites.filesWritten, flashWrites.bytesWritten);
     
-    // Detach servo
-    if (myServo.attached()) {
-        myServo.detach();
-        Serial.println("Servo detached");
-    }
+    // Boots that never finished setup() end their profile here
+    finishBootProfile();
+
+    // Detach the servo and cut its power
+    servoPowerDown();
     
-    // Turn off WiFi
-    WiFi.softAPdisconnect(true);
-    WiFi.mode(WIFI_OFF);
-    delay(100);
-    Serial.println("WiFi turned off");
+    // Turn off WiFi (scheduled wakes never start it)
+    if (WiFi.getMode() != WIFI_OFF) {
+        WiFi.softAPdisconnect(true);
+        WiFi.mode(WIFI_OFF);
+        delay(100);
+        Serial.println("WiFi turned off");
+    }
     
     // Turn off I2C
     Wire.end();
@@ -46,23 +90,20 @@ void enterDeepSleep() {
     }
     Serial.println("Unused GPIOs set low");
 
-    // Turn off servo transistor
-    digitalWrite(SERVO_TRANSISTOR_PIN, LOW);
-    
     // Configure wake sources
-    esp_sleep_enable_ext0_wakeup((gpio_num_t)RTC_ALARM_PIN, 0);
-    esp_sleep_enable_ext1_wakeup(1ULL << BUTTON_PIN, ESP_EXT1_WAKEUP_ANY_HIGH);
-    
-    // Disable other wake sources
-    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+    enableWakeSources();
     
     Serial.println("\nWake sources configured:");
     Serial.printf("  - RTC Alarm on GPIO %d (active LOW)\n", RTC_ALARM_PIN);
-    Serial.printf("  - Button on GPIO %d (active HIGH)\n", BUTTON_PIN);
+    Serial.printf("  - Button on GPIO %d (active HIGH, held %d ms)\n", BUTTON_PIN, BUTTON_LONG_PRESS_MS);
+    if (scheduledWake) {
+        recordScheduledWakeTiming();
+    }
+
     Serial.println("Entering deep sleep NOW...");
     Serial.println("========================================\n");
     
-    delay(100);
+    Serial.flush();
     
     esp_deep_sleep_start();
 }
@@ -83,3 +124,68 @@ bool shouldEnterSleep() {
     
     return true;
 }
+
+bool portalIdle() {
+    extern unsigned long apStartTime;
+    static unsigned long lastClientMs = apStartTime;
+
+    if (WiFi.softAPgetStationNum() > 0) {
+        lastClientMs = millis();
+    }
+    return millis() - lastClientMs >= AP_IDLE_GRACE_MS;
+}
+
+// ========================================
+// Sleep Policy
+// ========================================
+
+const char *sleepChoiceName(SleepChoice choice) {
+    switch (choice) {
+        case SLEEP_STAY_AWAKE: return "stay awake";
+        case SLEEP_LIGHT: return "light sleep";
+        default: return "deep sleep";
+    }
+}
+
+SleepChoice chooseSleep(uint32_t secondsToNext) {
+    SleepChoice choice = cheapestWait(secondsToNext);
+    Serial.printf("Next trigger in %lu s: awake %.0f mJ, light sleep %.0f mJ, deep sleep %.0f mJ -> %s\n",
+                  (unsigned long)secondsToNext,
+                  waitCostMj(SLEEP_STAY_AWAKE, secondsToNext),
+                  waitCostMj(SLEEP_LIGHT, secondsToNext),
+                  waitCostMj(SLEEP_DEEP, secondsToNext),
+                  sleepChoiceName(choice));
+    return choice;
+}
+
+bool waitForTrigger(SleepChoice choice, uint32_t triggerUnix) {
+    recordScheduledWakeTiming();
+    finishBootProfile();
+
+    // A button press turns this into a portal boot, which reloads the
+    // scheduler state from the RTC snapshot
+    captureRtcState();
+    servoPowerDown();
+
+    bool triggered;
+    if (choice == SLEEP_LIGHT) {
+        // WiFi is never started on a scheduled wake, and RAM, the I2C bus
+        // and the GPIO levels all survive light sleep
+        enableWakeSources();
+        Serial.println("Entering light sleep...");
+        Serial.flush();
+        esp_light_sleep_start();
+        releaseWakeUlp();
+        triggered = wakeupCause() == ESP_SLEEP_WAKEUP_EXT0;
+    } else {
+        while (rtc.now().unixtime() < triggerUnix && digitalRead(BUTTON_PIN) == LOW) {
+            delay(10);
+        }
+        triggered = digitalRead(BUTTON_PIN) == LOW;
+    }
+
+    rtc.clearAlarm(1);
+    Serial.printf("Woke from %s: %s\n", sleepChoiceName(choice),
+                  triggered ? "trigger due" : "button pressed");
+    return triggered;
+}
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <esp_sleep.h>
 #include "config.h"
+#include "types.h"
 
 // ========================================
 // Power Management Functions
@@ -12,4 +13,24 @@
 void enterDeepSleep();
 bool shouldEnterSleep();
 
+// True once no client has been associated with the portal for
+// AP_IDLE_GRACE_MS; call from loop() while the AP is up
+bool portalIdle();
+
+// ========================================
+// Sleep Policy
+// ========================================
+// After a scheduled dispense the feeder waits for the next trigger in
+// whichever way the energy model says is cheapest. Deep sleep pays for a
+// full boot on every trigger, so short gaps are spent in light sleep (or,
+// when the trigger is under SLEEP_MIN_SECONDS away, awake) and dispense
+// again in-process.
+
+SleepChoice chooseSleep(uint32_t secondsToNext);
+const char *sleepChoiceName(SleepChoice choice);
+
+// Waits for triggerUnix by staying awake or light sleeping. Returns true
+// once the trigger is due, false if the button was pressed instead.
+bool waitForTrigger(SleepChoice choice, uint32_t triggerUnix);
+
 #endif // POWER_MANAGEMENT_H
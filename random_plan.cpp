@@ -0,0 +1,230 @@
+#include "random_plan.h"
+#include "storage.h"
+#include "alarm_manager.h"
+#include "scheduler.h"
+#include <algorithm>
+
+// ========================================
+// Plan Storage
+// ========================================
+
+struct RandomPlan {
+    // What the plan was drawn from; a mismatch with modeConfig redraws it
+    uint32_t seed;
+    uint32_t startUnix;
+    uint32_t anchorUnix;
+    uint32_t intervalSeconds;
+    uint16_t minGapMinutes;
+    uint16_t quietStartMinute;
+    uint16_t quietEndMinute;
+
+    uint16_t blocks;           // Interval blocks covered; the next plan starts after them
+    uint16_t count;
+    uint16_t cursor;
+    uint32_t triggers[RANDOM_PLAN_MAX_TRIGGERS];
+};
+
+RTC_DATA_ATTR static RandomPlan plan;
+
+// ========================================
+// Helpers
+// ========================================
+
+static uint32_t randomIntervalSeconds() {
+    return modeConfig.randIntervalHours * 3600UL + modeConfig.randIntervalMinutes * 60UL;
+}
+
+// xorshift32: the same seed has to give the same plan on every boot, which
+// random() (the hardware RNG on the ESP32) does not
+static uint32_t nextRandom(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static bool planMatchesConfig() {
+    return plan.seed != 0 && plan.seed == modeConfig.randPlanSeed &&
+           plan.startUnix == modeConfig.randIntervalBlockStartUnix &&
+           plan.anchorUnix == modeConfig.randPlanAnchorUnix &&
+           plan.intervalSeconds == randomIntervalSeconds() &&
+           plan.minGapMinutes == modeConfig.randMinGapMinutes &&
+           plan.quietStartMinute == modeConfig.randQuietStartMinute &&
+           plan.quietEndMinute == modeConfig.randQuietEndMinute &&
+           plan.count <= RANDOM_PLAN_MAX_TRIGGERS;
+}
+
+// Quiet hours run from quietStartMinute up to quietEndMinute, across
+// midnight when the end is earlier in the day
+static bool quietAt(uint32_t t) {
+    uint16_t start = plan.quietStartMinute;
+    uint16_t end = plan.quietEndMinute;
+    uint16_t minute = (t % 86400UL) / 60;
+    if (start == end) return false;
+    if (start < end) return minute >= start && minute < end;
+    return minute >= start || minute < end;
+}
+
+// Seconds from t until quietAt() next changes
+static uint32_t quietRunLength(uint32_t t) {
+    if (plan.quietStartMinute == plan.quietEndMinute) return UINT32_MAX - t;
+
+    uint32_t secondOfDay = t % 86400UL;
+    uint32_t run = 86400UL;
+    for (uint32_t edge : {plan.quietStartMinute * 60UL, plan.quietEndMinute * 60UL}) {
+        uint32_t until = edge > secondOfDay ? edge - secondOfDay : edge + 86400UL - secondOfDay;
+        run = std::min(run, until);
+    }
+    return run;
+}
+
+// Number of seconds in [lo, hi) outside the quiet hours
+static uint32_t allowedSeconds(uint32_t lo, uint32_t hi) {
+    uint32_t total = 0;
+    for (uint32_t t = lo; t < hi; ) {
+        uint32_t run = std::min(hi - t, quietRunLength(t));
+        if (!quietAt(t)) total += run;
+        t += run;
+    }
+    return total;
+}
+
+// The n-th second in [lo, hi) outside the quiet hours
+static uint32_t allowedSecond(uint32_t lo, uint32_t hi, uint32_t n) {
+    for (uint32_t t = lo; t < hi; ) {
+        uint32_t run = std::min(hi - t, quietRunLength(t));
+        if (!quietAt(t)) {
+            if (n < run) return t + n;
+            n -= run;
+        }
+        t += run;
+    }
+    return hi - 1;
+}
+
+// Fills the plan from modeConfig; the same inputs always give the same plan
+static void drawPlan() {
+    uint32_t interval = randomIntervalSeconds();
+    plan.seed = modeConfig.randPlanSeed;
+    plan.startUnix = modeConfig.randIntervalBlockStartUnix;
+    plan.anchorUnix = modeConfig.randPlanAnchorUnix;
+    plan.intervalSeconds = interval;
+    plan.minGapMinutes = modeConfig.randMinGapMinutes;
+    plan.quietStartMinute = modeConfig.randQuietStartMinute;
+    plan.quietEndMinute = modeConfig.randQuietEndMinute;
+    uint32_t blocks = RANDOM_PLAN_HOURS * 3600UL / interval;
+    plan.blocks = blocks == 0 ? 1 : blocks > RANDOM_PLAN_MAX_TRIGGERS ? RANDOM_PLAN_MAX_TRIGGERS : blocks;
+    plan.count = 0;
+    plan.cursor = 0;
+
+    uint32_t state = plan.seed;
+    uint32_t minGap = plan.minGapMinutes * 60UL;
+    uint32_t previous = plan.anchorUnix;
+
+    for (uint16_t b = 0; b < plan.blocks; b++) {
+        uint32_t blockStart = plan.startUnix + b * interval;
+        uint32_t blockEnd = blockStart + interval;
+        uint32_t draw = nextRandom(state);
+
+        // A block that is all quiet hours or too close to the last feed
+        // gets no trigger
+        uint32_t lo = blockStart;
+        if (previous != 0 && previous + minGap > lo) lo = previous + minGap;
+        if (lo >= blockEnd) continue;
+        uint32_t allowed = allowedSeconds(lo, blockEnd);
+        if (allowed == 0) continue;
+
+        previous = allowedSecond(lo, blockEnd, draw % allowed);
+        plan.triggers[plan.count++] = previous;
+    }
+}
+
+// Starts the plan after the current one, or the one covering afterUnix if
+// the feeder has slept through whole plans
+static void drawFollowingPlan(uint32_t afterUnix) {
+    uint32_t interval = randomIntervalSeconds();
+    uint32_t start = plan.startUnix + plan.blocks * interval;
+    if (afterUnix >= start) start += (afterUnix - start) / interval * interval;
+
+    if (plan.count > 0) modeConfig.randPlanAnchorUnix = plan.triggers[plan.count - 1];
+    modeConfig.randIntervalBlockStartUnix = start;
+    modeConfig.randPlanSeed = (uint32_t)random(1, 0x7FFFFFFF);
+    markDirty(RECORD_MODE);
+    drawPlan();
+}
+
+// Makes sure the RTC copy is the plan modeConfig describes. Returns false,
+// without drawing anything, if random mode is not active or has no
+// interval; a preview in another mode must not rewrite the config.
+static bool ensurePlan() {
+    if (scheduleModeFromString(modeConfig.activeMode) != SCHEDULE_RANDOM_INTERVAL) return false;
+    if (randomIntervalSeconds() == 0) return false;
+    if (modeConfig.randPlanSeed == 0 || modeConfig.randIntervalBlockStartUnix == 0) {
+        newRandomPlan(rtc.now().unixtime());
+        return true;
+    }
+    if (planMatchesConfig()) return true;
+
+    // RTC memory was lost (or the settings changed under it): redraw the
+    // same plan and skip what has already passed
+    drawPlan();
+    uint32_t currentUnix = rtc.now().unixtime();
+    while (plan.cursor < plan.count && plan.triggers[plan.cursor] <= currentUnix) plan.cursor++;
+    Serial.printf("Random plan redrawn from seed %lu, %u of %u triggers left\n",
+                  (unsigned long)plan.seed, plan.count - plan.cursor, plan.count);
+    return true;
+}
+
+// ========================================
+// Random Plan Functions
+// ========================================
+
+void newRandomPlan(uint32_t startUnix) {
+    modeConfig.randIntervalBlockStartUnix = startUnix;
+    modeConfig.randPlanAnchorUnix = 0;
+    modeConfig.randPlanSeed = (uint32_t)random(1, 0x7FFFFFFF);
+    markDirty(RECORD_MODE);
+    if (randomIntervalSeconds() == 0) return;
+    drawPlan();
+
+    Serial.printf("\n=== Random Plan Drawn ===\nSeed %lu: %u triggers over %u blocks of %lu minutes\n",
+                  (unsigned long)plan.seed, plan.count, plan.blocks, (unsigned long)(plan.intervalSeconds / 60));
+    if (plan.count > 0) {
+        DateTime first(plan.triggers[0]);
+        Serial.printf("First trigger: %02d:%02d:%02d\n", first.hour(), first.minute(), first.second());
+    }
+    Serial.println("=========================\n");
+}
+
+uint32_t randomPlanNext() {
+    if (!ensurePlan()) return 0;
+    if (plan.cursor >= plan.count) randomPlanAdvance(rtc.now().unixtime());
+    return plan.cursor < plan.count ? plan.triggers[plan.cursor] : 0;
+}
+
+void randomPlanAdvance(uint32_t afterUnix) {
+    if (!ensurePlan()) return;
+
+    for (int draws = 0; ; draws++) {
+        while (plan.cursor < plan.count && plan.triggers[plan.cursor] <= afterUnix) plan.cursor++;
+        if (plan.cursor < plan.count) return;
+        if (draws == RANDOM_PLAN_MAX_DRAWS) {
+            Serial.println("No random trigger fits outside the quiet hours");
+            return;
+        }
+        drawFollowingPlan(afterUnix);
+        Serial.printf("Random plan %lu drawn: %u triggers\n", (unsigned long)plan.seed, plan.count);
+    }
+}
+
+uint16_t randomPlanCount() {
+    return ensurePlan() ? plan.count : 0;
+}
+
+uint16_t randomPlanCursor() {
+    return ensurePlan() ? plan.cursor : 0;
+}
+
+uint32_t randomPlanTrigger(uint16_t i) {
+    return ensurePlan() && i < plan.count ? plan.triggers[i] : 0;
+}
@@ -0,0 +1,34 @@
+#ifndef RANDOM_PLAN_H
+#define RANDOM_PLAN_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+// ========================================
+// Random Interval Plan
+// ========================================
+// Random mode draws its triggers a plan at a time: one in each interval
+// block for RANDOM_PLAN_HOURS (at most RANDOM_PLAN_MAX_TRIGGERS), at least
+// randMinGapMinutes apart and outside the quiet hours. The plan is kept in
+// RTC memory and each trigger only moves its cursor. modeConfig holds what
+// the plan was drawn from (seed, start and the trigger before it), so a
+// cold boot redraws the same plan and the config record is only rewritten
+// when a new plan is drawn.
+
+// Draws a new plan with a fresh seed whose first block starts at startUnix
+void newRandomPlan(uint32_t startUnix);
+
+// Planned trigger under the cursor, or 0 if there is none
+uint32_t randomPlanNext();
+
+// Moves the cursor past afterUnix, drawing the following plans as the
+// current one runs out
+void randomPlanAdvance(uint32_t afterUnix);
+
+// Current plan, for the preview; empty unless random mode is active
+uint16_t randomPlanCount();
+uint16_t randomPlanCursor();
+uint32_t randomPlanTrigger(uint16_t i);
+
+#endif // RANDOM_PLAN_H
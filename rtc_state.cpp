@@ -0,0 +1,138 @@
+#include "rtc_state.h"
+#include "storage.h"
+
+// ========================================
+// Snapshot Layout
+// ========================================
+
+#define RTC_STATE_MAGIC 0x46454544UL  // "FEED"
+#define RTC_STATE_VERSION 3
+
+struct RtcAlarmRecord {
+    uint32_t id;
+    uint16_t minute;
+    uint8_t days;
+    uint8_t active;
+};
+
+struct RtcModeRecord {
+    char activeMode[20];
+    int32_t regIntervalHours;
+    int32_t regIntervalMinutes;
+    uint32_t regIntervalLastTriggerUnix;
+    int32_t randIntervalHours;
+    int32_t randIntervalMinutes;
+    uint32_t randIntervalBlockStartUnix;
+    uint32_t randPlanSeed;
+    uint32_t randPlanAnchorUnix;
+    int32_t randMinGapMinutes;
+    int32_t randQuietStartMinute;
+    int32_t randQuietEndMinute;
+};
+
+struct RtcStateSnapshot {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t alarmCount;
+    int32_t compartment;
+    RtcModeRecord mode;
+    RtcAlarmRecord alarms[RTC_STATE_MAX_ALARMS];
+    uint32_t crc;               // CRC of the snapshot up to this field
+};
+
+RTC_DATA_ATTR static RtcStateSnapshot rtcState;
+
+// ========================================
+// Helpers
+// ========================================
+
+static uint32_t snapshotCrc() {
+    return crc32Update(0, (const uint8_t *)&rtcState, offsetof(RtcStateSnapshot, crc));
+}
+
+// ========================================
+// Snapshot Functions
+// ========================================
+
+bool restoreRtcState() {
+    if (rtcState.magic != RTC_STATE_MAGIC || rtcState.version != RTC_STATE_VERSION ||
+        rtcState.crc != snapshotCrc() || rtcState.alarmCount > RTC_STATE_MAX_ALARMS) {
+        Serial.println("RTC state invalid - loading from flash");
+        return false;
+    }
+
+    modeConfig.activeMode = rtcState.mode.activeMode;
+    modeConfig.regIntervalHours = rtcState.mode.regIntervalHours;
+    modeConfig.regIntervalMinutes = rtcState.mode.regIntervalMinutes;
+    modeConfig.regIntervalLastTriggerUnix = rtcState.mode.regIntervalLastTriggerUnix;
+    modeConfig.randIntervalHours = rtcState.mode.randIntervalHours;
+    modeConfig.randIntervalMinutes = rtcState.mode.randIntervalMinutes;
+    modeConfig.randIntervalBlockStartUnix = rtcState.mode.randIntervalBlockStartUnix;
+    modeConfig.randPlanSeed = rtcState.mode.randPlanSeed;
+    modeConfig.randPlanAnchorUnix = rtcState.mode.randPlanAnchorUnix;
+    modeConfig.randMinGapMinutes = rtcState.mode.randMinGapMinutes;
+    modeConfig.randQuietStartMinute = rtcState.mode.randQuietStartMinute;
+    modeConfig.randQuietEndMinute = rtcState.mode.randQuietEndMinute;
+
+    compartment = rtcState.compartment;
+
+    alarms.clear();
+    for (int i = 0; i < rtcState.alarmCount; i++) {
+        Alarm a;
+        a.id = rtcState.alarms[i].id;
+        a.minute = rtcState.alarms[i].minute;
+        a.days = rtcState.alarms[i].days;
+        a.active = rtcState.alarms[i].active;
+        alarms.push_back(a);
+    }
+
+    Serial.printf("RTC state restored: mode=%s, compartment=%d, %d alarms\n",
+                  modeConfig.activeMode.c_str(), compartment, rtcState.alarmCount);
+    return true;
+}
+
+void captureRtcState() {
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcState.magic = RTC_STATE_MAGIC;
+    rtcState.version = RTC_STATE_VERSION;
+    rtcState.compartment = compartment;
+
+    strlcpy(rtcState.mode.activeMode, modeConfig.activeMode.c_str(), sizeof(rtcState.mode.activeMode));
+    rtcState.mode.regIntervalHours = modeConfig.regIntervalHours;
+    rtcState.mode.regIntervalMinutes = modeConfig.regIntervalMinutes;
+    rtcState.mode.regIntervalLastTriggerUnix = modeConfig.regIntervalLastTriggerUnix;
+    rtcState.mode.randIntervalHours = modeConfig.randIntervalHours;
+    rtcState.mode.randIntervalMinutes = modeConfig.randIntervalMinutes;
+    rtcState.mode.randIntervalBlockStartUnix = modeConfig.randIntervalBlockStartUnix;
+    rtcState.mode.randPlanSeed = modeConfig.randPlanSeed;
+    rtcState.mode.randPlanAnchorUnix = modeConfig.randPlanAnchorUnix;
+    rtcState.mode.randMinGapMinutes = modeConfig.randMinGapMinutes;
+    rtcState.mode.randQuietStartMinute = modeConfig.randQuietStartMinute;
+    rtcState.mode.randQuietEndMinute = modeConfig.randQuietEndMinute;
+
+    size_t count = alarms.size();
+    if (count > RTC_STATE_MAX_ALARMS) {
+        Serial.printf("WARNING: only the first %d alarms fit in RTC memory\n", RTC_STATE_MAX_ALARMS);
+        count = RTC_STATE_MAX_ALARMS;
+    }
+    rtcState.alarmCount = count;
+    for (size_t i = 0; i < count; i++) {
+        rtcState.alarms[i].id = alarms[i].id;
+        rtcState.alarms[i].minute = alarms[i].minute;
+        rtcState.alarms[i].days = alarms[i].days;
+        rtcState.alarms[i].active = alarms[i].active ? 1 : 0;
+    }
+
+    rtcState.crc = snapshotCrc();
+}
+
+void loadSchedulerState() {
+    if (restoreRtcState()) {
+        return;
+    }
+
+    loadCompartmentPosition();
+    loadModeConfig();
+    alarms.clear();
+    loadAlarms();
+}
@@ -0,0 +1,26 @@
+#ifndef RTC_STATE_H
+#define RTC_STATE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+// ========================================
+// RTC Slow Memory State
+// ========================================
+// Mode, servo position and alarms are kept in RTC slow memory across deep
+// sleep. The NVS config and alarm records are a write-behind backup that
+// is only read after a cold boot or when the snapshot fails its checksum.
+
+// Restores modeConfig, compartment and alarms from RTC memory.
+// Returns false if the snapshot is missing or corrupt.
+bool restoreRtcState();
+
+// Copies the current state into RTC memory and updates its checksum.
+void captureRtcState();
+
+// Loads mode, servo position and alarms from RTC memory, falling back to
+// the NVS records when it is not valid.
+void loadSchedulerState();
+
+#endif // RTC_STATE_H
@@ -0,0 +1,165 @@
+#include "scheduler.h"
+#include "storage.h"
+#include "alarm_manager.h"
+#include "random_plan.h"
+#include <algorithm>
+
+static bool scheduleValid = false;
+static bool alarmIndexValid = false;
+static ScheduleMode cachedMode = SCHEDULE_NONE;
+static uint32_t cachedNextFire = 0;
+
+// Sorted minutes of day of the active alarms for each weekday (0 = Sunday)
+static std::vector<uint16_t> alarmIndex[7];
+
+// ========================================
+// Helpers
+// ========================================
+
+ScheduleMode scheduleModeFromString(const String &mode) {
+    if (mode == "set_times") return SCHEDULE_SET_TIMES;
+    if (mode == "regular_interval") return SCHEDULE_REGULAR_INTERVAL;
+    if (mode == "random_interval") return SCHEDULE_RANDOM_INTERVAL;
+    return SCHEDULE_NONE;
+}
+
+bool intervalInRange(long hours, long minutes) {
+    if (hours < 0 || minutes < 0 || minutes >= 60) return false;
+    if (hours > INTERVAL_MAX_MINUTES / 60) return false;
+    long total = hours * 60 + minutes;
+    return total >= INTERVAL_MIN_MINUTES && total <= INTERVAL_MAX_MINUTES;
+}
+
+static uint32_t regularIntervalSeconds() {
+    return modeConfig.regIntervalHours * 3600UL + modeConfig.regIntervalMinutes * 60UL;
+}
+
+static void rebuildAlarmIndex() {
+    for (auto &day : alarmIndex) day.clear();
+
+    for (auto &a : alarms) {
+        if (!a.active) continue;
+        for (int day = 0; day < 7; day++) {
+            if (a.days & (1 << day)) alarmIndex[day].push_back(a.minute);
+        }
+    }
+    for (auto &day : alarmIndex) {
+        std::sort(day.begin(), day.end());
+        day.erase(std::unique(day.begin(), day.end()), day.end());
+    }
+    alarmIndexValid = true;
+}
+
+// Earliest active alarm strictly after afterUnix
+static uint32_t nextSetTime(uint32_t afterUnix) {
+    if (!alarmIndexValid) rebuildAlarmIndex();
+
+    DateTime after(afterUnix);
+    uint16_t minuteNow = after.hour() * 60 + after.minute();
+    uint32_t midnight = afterUnix - minuteNow * 60UL - after.second();
+
+    // Today after the current minute, then each following day; the eighth
+    // pass covers earlier slots on the same weekday next week
+    for (int d = 0; d <= 7; d++) {
+        const std::vector<uint16_t> &day = alarmIndex[(after.dayOfTheWeek() + d) % 7];
+        auto it = d == 0 ? std::upper_bound(day.begin(), day.end(), minuteNow) : day.begin();
+        if (it != day.end()) {
+            return midnight + d * 86400UL + *it * 60UL;
+        }
+    }
+    return 0;
+}
+
+static void refreshSchedule() {
+    uint32_t currentUnix = rtc.now().unixtime();
+    cachedMode = scheduleModeFromString(modeConfig.activeMode);
+    cachedNextFire = 0;
+
+    switch (cachedMode) {
+        case SCHEDULE_SET_TIMES:
+            cachedNextFire = nextSetTime(currentUnix);
+            break;
+
+        case SCHEDULE_REGULAR_INTERVAL:
+            if (regularIntervalSeconds() == 0) break;
+            if (modeConfig.regIntervalLastTriggerUnix == 0) {
+                modeConfig.regIntervalLastTriggerUnix = currentUnix;
+                markDirty(RECORD_MODE);
+                Serial.println("Regular interval initialized");
+            }
+            cachedNextFire = modeConfig.regIntervalLastTriggerUnix + regularIntervalSeconds();
+            break;
+
+        case SCHEDULE_RANDOM_INTERVAL:
+            cachedNextFire = randomPlanNext();
+            break;
+
+        default:
+            break;
+    }
+
+    scheduleValid = true;
+}
+
+// ========================================
+// Scheduler Functions
+// ========================================
+
+void invalidateSchedule() {
+    scheduleValid = false;
+    alarmIndexValid = false;
+}
+
+ScheduleMode activeScheduleMode() {
+    if (!scheduleValid) refreshSchedule();
+    return cachedMode;
+}
+
+uint32_t nextFireUnix() {
+    if (!scheduleValid) refreshSchedule();
+    return cachedNextFire;
+}
+
+bool scheduleDue(uint32_t currentUnix) {
+    uint32_t next = nextFireUnix();
+    return next != 0 && currentUnix >= next;
+}
+
+void scheduleFired(uint32_t currentUnix) {
+    switch (activeScheduleMode()) {
+        case SCHEDULE_REGULAR_INTERVAL:
+            modeConfig.regIntervalLastTriggerUnix = currentUnix;
+            markDirty(RECORD_MODE);
+            Serial.printf("Updated last trigger to: %lu\n", currentUnix);
+            break;
+
+        case SCHEDULE_RANDOM_INTERVAL:
+            randomPlanAdvance(currentUnix);
+            break;
+
+        default:
+            break;
+    }
+    refreshSchedule();
+}
+
+uint32_t nextWakeUnix(uint32_t currentUnix) {
+    uint32_t next = nextFireUnix();
+    if (next == 0 || next > currentUnix) {
+        return next;
+    }
+
+    if (cachedMode == SCHEDULE_REGULAR_INTERVAL) {
+        Serial.println("Overdue - triggering soon");
+        return currentUnix + 60;
+    }
+
+    if (cachedMode == SCHEDULE_RANDOM_INTERVAL) {
+        // The random trigger was missed; move on to the next planned one
+        randomPlanAdvance(currentUnix);
+        Serial.println("Trigger time passed - skipped to the next planned trigger");
+    }
+
+    refreshSchedule();
+    return cachedNextFire > currentUnix ? cachedNextFire : 0;
+}
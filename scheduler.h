@@ -0,0 +1,46 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+// ========================================
+// Scheduler
+// ========================================
+// Works out the next fire time for the active mode once and caches it.
+// checkTriggers(), wake programming and /api/mode all compare against the
+// cached value. Set-times alarms are answered from per-weekday sorted
+// minute-of-day tables with a binary search. Call invalidateSchedule()
+// whenever the mode, alarms or RTC time change.
+
+enum ScheduleMode : uint8_t {
+    SCHEDULE_SET_TIMES,
+    SCHEDULE_REGULAR_INTERVAL,
+    SCHEDULE_RANDOM_INTERVAL,
+    SCHEDULE_NONE
+};
+
+ScheduleMode scheduleModeFromString(const String &mode);
+
+// True if hours:minutes (minutes 0-59) is an interval the modes accept,
+// INTERVAL_MIN_MINUTES to INTERVAL_MAX_MINUTES
+bool intervalInRange(long hours, long minutes);
+
+void invalidateSchedule();
+ScheduleMode activeScheduleMode();
+
+// Unix time (AEST) of the next trigger, or 0 if nothing is scheduled.
+// May be in the past when an interval trigger is overdue.
+uint32_t nextFireUnix();
+
+bool scheduleDue(uint32_t currentUnix);
+
+// Advances the mode's state after a trigger at currentUnix.
+void scheduleFired(uint32_t currentUnix);
+
+// Time to program into the RTC alarm, always after currentUnix, or 0 to
+// wake on the button only.
+uint32_t nextWakeUnix(uint32_t currentUnix);
+
+#endif // SCHEDULER_H
@@ -1,36 +1,384 @@
 #include "servo_control.h"
 #include "storage.h"
 
+// ========================================
+// Dispense Current Capture
+// ========================================
+// While the carousel moves, the INA219 current register is read back to
+// back, as fast as the I2C bus allows, into a preallocated trace. The
+// motion engine feeds it in slices between ramp steps. The trace is reduced
+// to a few features: a servo still driving at the end of the move is
+// stalled, and one that never drives did not move at all.
+
+static int16_t captureTrace[CAPTURE_MAX_SAMPLES];
+static uint16_t captureTraceCount = 0;
+
+struct CaptureState {
+    bool running;
+    float busVoltage;
+    unsigned long startUs;
+    unsigned long lastUs;
+    unsigned long firstActiveUs;
+    unsigned long lastActiveUs;
+    bool active;
+    float chargeMaUs;
+    uint32_t samples;
+};
+
+static CaptureState capture;
+
+const int16_t *dispenseCaptureTrace(uint16_t &count) {
+    count = captureTraceCount;
+    return captureTrace;
+}
+
+const char *captureResultName(uint8_t result) {
+    switch (result) {
+        case CAPTURE_OK: return "ok";
+        case CAPTURE_STALLED: return "stalled";
+        case CAPTURE_NO_CURRENT: return "no_current";
+        default: return "none";
+    }
+}
+
+static void captureStart() {
+    memset(&lastDispenseCapture, 0, sizeof(lastDispenseCapture));
+    lastDispenseCapture.result = CAPTURE_NONE;
+    captureTraceCount = 0;
+
+    memset(&capture, 0, sizeof(capture));
+    if (!currentSensorFound) return;
+
+    capture.busVoltage = checkVoltage();
+    capture.startUs = micros();
+    capture.lastUs = capture.startUs;
+    capture.running = true;
+}
+
+// Reads samples back to back until untilUs (a micros() value)
+static void captureSamples(unsigned long untilUs) {
+    if (!capture.running) return;
+
+    while ((long)(untilUs - micros()) > 0) {
+        float ma = ina219.getCurrent_mA();
+        unsigned long nowUs = micros();
+        if (ma < 0) ma = 0;
+
+        // Each reading stands for the time since the previous one
+        capture.chargeMaUs += ma * (nowUs - capture.lastUs);
+        capture.lastUs = nowUs;
+
+        if (ma > lastDispenseCapture.peakMa) lastDispenseCapture.peakMa = ma;
+        if (ma >= CAPTURE_MOVING_MA) {
+            if (!capture.active) capture.firstActiveUs = nowUs;
+            capture.lastActiveUs = nowUs;
+            capture.active = true;
+        }
+        if (captureTraceCount < CAPTURE_MAX_SAMPLES) {
+            captureTrace[captureTraceCount++] = ma > INT16_MAX ? INT16_MAX : (int16_t)ma;
+        }
+        capture.samples++;
+    }
+}
+
+static void captureFinish() {
+    if (!capture.running) return;
+    capture.running = false;
+
+    DispenseCapture &result = lastDispenseCapture;
+    unsigned long elapsedUs = capture.lastUs - capture.startUs;
+    result.samples = capture.samples > UINT16_MAX ? UINT16_MAX : capture.samples;
+    result.durationMs = elapsedUs / 1000;
+    result.meanMa = elapsedUs > 0 ? capture.chargeMaUs / elapsedUs : 0;
+    result.energyMj = capture.busVoltage * capture.chargeMaUs / 1000000.0f;
+
+    if (!capture.active) {
+        result.result = CAPTURE_NO_CURRENT;
+    } else {
+        result.activeMs = (capture.lastActiveUs - capture.firstActiveUs) / 1000;
+        bool drivingAtEnd = capture.lastActiveUs + CAPTURE_STALL_TAIL_MS * 1000UL >= capture.lastUs;
+        result.result = drivingAtEnd ? CAPTURE_STALLED : CAPTURE_OK;
+    }
+
+    Serial.printf("Move current: %u samples in %u ms, peak %u mA, mean %u mA, driving %u ms, %.1f mJ (%s)\n",
+                  result.samples, result.durationMs, result.peakMa, result.meanMa,
+                  result.activeMs, result.energyMj, captureResultName(result.result));
+}
+
 // ========================================
 // Servo Control Functions
 // ========================================
 
 void moveToAngle(int angle) {
-    float newAngle = angle;
     int pulse = map(angle, 0, MECH_RANGE, MIN_PULSE, MAX_PULSE);
     myServo.writeMicroseconds(pulse);
 }
 
-void advanceCompartment() {
-    loadCompartmentPosition();
+// ========================================
+// Motion Engine
+// ========================================
+// Moves run as queued jobs that servoTick() advances from loop(). Each move
+// ramps the servo along a cosine ease-in/ease-out profile, one step per
+// PWM frame, then waits for it to settle; the last chamber also dwells and
+// ramps back to deadspace. Nothing blocks, so the portal, DNS and the
+// trigger check keep running during a dispense. The job's done handler
+// runs once the carousel is at rest.
 
-    Serial.println(compartment);
-    int angle = (compartment + 1) * SERVO_ANGLE_STEP + SERVO_ANGLE_OFFSET;
+enum MotionPhase : uint8_t {
+    PHASE_RAMP,
+    PHASE_SETTLE,
+    PHASE_DWELL,
+    PHASE_RETURN_RAMP,
+    PHASE_RETURN_SETTLE
+};
+
+struct QueuedMotion {
+    MotionJob job;
+    MotionDoneHandler done;
+};
+
+static QueuedMotion motionQueue[MOTION_QUEUE_LENGTH];  // [0] is the running job
+static uint8_t motionQueueCount = 0;
+static MotionJob motionHistory[MOTION_HISTORY_LENGTH];  // Finished jobs, newest at motionHistoryHead - 1
+static uint8_t motionHistoryHead = 0;
+static uint8_t motionHistoryCount = 0;
+static uint32_t nextJobId = 1;
+
+static MotionPhase phase;
+static unsigned long jobStartMs;
+static unsigned long phaseStartMs;
+static unsigned long lastStepMs;
+static int rampFrom;
+static int rampTo;
+static unsigned long rampMs;
+static int commandedAngle = -1;  // Last angle written, -1 before the first move
+static bool returnToDeadspace;
+
+static bool powered = false;
+static unsigned long poweredAtMs;
+static unsigned long idleSinceMs;
+
+static int compartmentAngle(int index) {
+    return index == 0 ? 0 : index * SERVO_ANGLE_STEP + SERVO_ANGLE_OFFSET;
+}
+
+// ========================================
+// Servo Power
+// ========================================
+
+void servoPowerUp() {
+    if (powered) return;
+
+    // Start the pulse train at the held position before the servo gets
+    // power, so it doesn't twitch
+    if (commandedAngle < 0) commandedAngle = compartmentAngle(compartment);
+    myServo.attach(SERVO_PIN);
+    myServo.setPeriodHertz(50);
+    moveToAngle(commandedAngle);
+
+    digitalWrite(SERVO_TRANSISTOR_PIN, HIGH);
+    powered = true;
+    poweredAtMs = millis();
+    Serial.println("Servo powered up");
+}
+
+void servoPowerDown() {
+    if (myServo.attached()) {
+        myServo.detach();
+    }
+    digitalWrite(SERVO_TRANSISTOR_PIN, LOW);
+    if (powered) Serial.println("Servo powered down");
+    powered = false;
+}
+
+bool servoPowered() {
+    return powered;
+}
+
+static void startRamp(MotionPhase rampPhase, int target, unsigned long now) {
+    // Before the first move the servo is wherever the stored position says
+    if (commandedAngle < 0) commandedAngle = compartmentAngle(compartment);
+
+    phase = rampPhase;
+    phaseStartMs = now;
+    lastStepMs = now;
+    rampFrom = commandedAngle;
+    rampTo = target;
+    rampMs = max(1UL, (unsigned long)abs(rampTo - rampFrom) * SERVO_RAMP_MS_PER_DEG);
+}
 
-    if (angle >= 300) {
+// Writes the profile position for now; returns true once the ramp is done
+static bool rampStep(unsigned long now) {
+    float t = min(1.0f, (float)(now - phaseStartMs) / rampMs);
+    float eased = (1.0f - cosf(PI * t)) / 2.0f;
+    int angle = rampFrom + (int)lroundf((rampTo - rampFrom) * eased);
+    if (angle != commandedAngle) {
         moveToAngle(angle);
-        delay(SERVO_FINAL_DELAY);  // Allow last item to drop
+        commandedAngle = angle;
+    }
+    lastStepMs = now;
+    return t >= 1.0f;
+}
+
+static void startJob(QueuedMotion &queued, unsigned long now) {
+    MotionJob &job = queued.job;
+    job.state = JOB_RUNNING;
+    jobStartMs = now;
+
+    if (job.kind == MOTION_HOME) {
+        Serial.println("Motion: homing to deadspace");
+        returnToDeadspace = false;
+        startRamp(PHASE_RAMP, 0, now);
+        return;
+    }
+
+    int angle = (compartment + 1) * SERVO_ANGLE_STEP + SERVO_ANGLE_OFFSET;
+    returnToDeadspace = angle >= 300;
+    Serial.printf("Motion: job %u, compartment %d -> %d degrees\n", job.id, compartment, angle);
+    captureStart();
+    startRamp(PHASE_RAMP, angle, now);
+}
+
+static void finishJob(unsigned long now) {
+    QueuedMotion finished = motionQueue[0];
+    MotionJob &job = finished.job;
+    idleSinceMs = now;
+
+    if (job.kind == MOTION_HOME) {
         compartment = 0;
+    } else {
+        compartment = returnToDeadspace ? 0 : compartment + 1;
+        // Chamber numbers are 1-based; returning to deadspace emptied chamber 6
+        job.chamber = compartment == 0 ? MAX_COMPARTMENTS : compartment + 1;
+        job.result = lastDispenseCapture.result;
+    }
+    markDirty(RECORD_SERVO);
 
-        moveToAngle(0);  // Return to deadspace
-        saveCompartmentPosition();
+    job.state = JOB_DONE;
+    job.durationMs = now - jobStartMs;
+    Serial.printf("Motion: job %u done in %lu ms\n", job.id, (unsigned long)job.durationMs);
+
+    for (uint8_t i = 1; i < motionQueueCount; i++) motionQueue[i - 1] = motionQueue[i];
+    motionQueueCount--;
+
+    motionHistory[motionHistoryHead] = job;
+    motionHistoryHead = (motionHistoryHead + 1) % MOTION_HISTORY_LENGTH;
+    if (motionHistoryCount < MOTION_HISTORY_LENGTH) motionHistoryCount++;
+
+    if (finished.done) finished.done(job);
+}
+
+uint32_t queueMotion(MotionKind kind, bool manual, MotionDoneHandler done) {
+    if (motionQueueCount >= MOTION_QUEUE_LENGTH) {
+        Serial.println("Motion queue full - request dropped");
+        return 0;
+    }
+
+    QueuedMotion &queued = motionQueue[motionQueueCount++];
+    memset(&queued.job, 0, sizeof(queued.job));
+    queued.job.id = nextJobId++;
+    queued.job.kind = kind;
+    queued.job.manual = manual;
+    queued.job.state = JOB_QUEUED;
+    queued.done = done;
+    return queued.job.id;
+}
+
+void servoTick() {
+    unsigned long now = millis();
+    if (motionQueueCount == 0) {
+        // Keep power briefly in case another move follows, then cut it
+        if (powered && now - idleSinceMs >= SERVO_POWER_HOLD_MS) servoPowerDown();
         return;
     }
 
-    moveToAngle(angle);
+    if (motionQueue[0].job.state == JOB_QUEUED) {
+        servoPowerUp();
+        if (millis() - poweredAtMs < SERVO_POWER_UP_MS) return;
+        startJob(motionQueue[0], now);
+    }
+
+    switch (phase) {
+        case PHASE_RAMP:
+        case PHASE_RETURN_RAMP:
+            if (now - lastStepMs >= SERVO_RAMP_STEP_MS || now - phaseStartMs >= rampMs) {
+                if (rampStep(now)) {
+                    phase = phase == PHASE_RAMP ? PHASE_SETTLE : PHASE_RETURN_SETTLE;
+                    phaseStartMs = now;
+                }
+            }
+            break;
+
+        case PHASE_SETTLE:
+            if (now - phaseStartMs >= SERVO_SETTLE_MS) {
+                captureFinish();
+                if (!returnToDeadspace) {
+                    finishJob(now);
+                    return;
+                }
+                phase = PHASE_DWELL;
+                phaseStartMs = now;
+            }
+            break;
+
+        case PHASE_DWELL:
+            // Allow last item to drop; the full delay counts from reaching
+            // the chamber, as the ramp and settle are over by then
+            if (now - phaseStartMs >= SERVO_FINAL_DELAY) {
+                startRamp(PHASE_RETURN_RAMP, 0, now);
+            }
+            break;
+
+        case PHASE_RETURN_SETTLE:
+            if (now - phaseStartMs >= SERVO_SETTLE_MS) {
+                finishJob(now);
+                return;
+            }
+            break;
+    }
+
+    // Fill the time until the next step, or the end of the settle, with
+    // current samples
+    if (capture.running) {
+        unsigned long sliceMs = SERVO_RAMP_STEP_MS;
+        unsigned long elapsed = millis() - (phase == PHASE_RAMP ? lastStepMs : phaseStartMs);
+        if (phase == PHASE_RAMP) sliceMs -= min(sliceMs, elapsed);
+        else sliceMs = min(sliceMs, (unsigned long)SERVO_SETTLE_MS - min((unsigned long)SERVO_SETTLE_MS, elapsed));
+        captureSamples(micros() + max(1UL, sliceMs) * 1000UL);
+    }
+}
 
-    compartment++;
-    saveCompartmentPosition();
+bool servoBusy() {
+    return motionQueueCount > 0;
+}
+
+void waitForMotion() {
+    while (servoBusy()) {
+        servoTick();
+        if (!capture.running) delay(1);
+    }
+}
+
+bool findMotionJob(uint32_t id, MotionJob &job) {
+    for (uint8_t i = 0; i < motionQueueCount; i++) {
+        if (motionQueue[i].job.id == id) {
+            job = motionQueue[i].job;
+            return true;
+        }
+    }
+    for (uint8_t i = 0; i < motionHistoryCount; i++) {
+        const MotionJob &past = motionHistory[(motionHistoryHead + MOTION_HISTORY_LENGTH - 1 - i) % MOTION_HISTORY_LENGTH];
+        if (past.id == id) {
+            job = past;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t lastFinishedJobId() {
+    if (motionHistoryCount == 0) return 0;
+    return motionHistory[(motionHistoryHead + MOTION_HISTORY_LENGTH - 1) % MOTION_HISTORY_LENGTH].id;
 }
 
 // ========================================
@@ -42,30 +390,58 @@ float checkVoltage() {
     return busvoltage; 
 }
 
+// Rest voltage of the 2S pack at each 10% of charge
+static const float SOC_CURVE[] = {
+    6.30, 6.50, 6.70, 6.90, 7.10, 7.30, 7.50, 7.70, 7.90, 8.10, 8.25
+};
+
 int voltageToSOC(float v) {
-    // Piecewise approximation of the battery's charge
-    if (v >= 8.25) return 100;
-    if (v >= 8.10) return 90;
-    if (v >= 7.90) return 80;
-    if (v >= 7.70) return 70;
-    if (v >= 7.50) return 60;
-    if (v >= 7.30) return 50;
-    if (v >= 7.10) return 40;
-    if (v >= 6.90) return 30;
-    if (v >= 6.70) return 20;
-    if (v >= 6.50) return 10;
-    return 0;
+    // Linear interpolation along the discharge curve
+    const int points = sizeof(SOC_CURVE) / sizeof(SOC_CURVE[0]);
+    if (v <= SOC_CURVE[0]) return 0;
+    if (v >= SOC_CURVE[points - 1]) return 100;
+
+    int i = 1;
+    while (v >= SOC_CURVE[i]) i++;
+    float fraction = (v - SOC_CURVE[i - 1]) / (SOC_CURVE[i] - SOC_CURVE[i - 1]);
+    return (int)((i - 1 + fraction) * 10.0f + 0.5f);
+}
+
+void sampleBattery(bool force) {
+    unsigned long now = millis();
+    if (!force && (!batteryReading.valid || now - batteryReading.sampledAt < BATTERY_SAMPLE_INTERVAL)) {
+        return;
+    }
+
+    float busVoltage = checkVoltage();
+    float currentMa = ina219.getCurrent_mA();
+
+    // Add back the sag across the pack's resistance so a moving servo or
+    // the WiFi radio doesn't read as a flat battery
+    float restVoltage = busVoltage + currentMa / 1000.0f * BATTERY_INTERNAL_OHMS;
+
+    batteryReading.busVoltage = busVoltage;
+    batteryReading.currentMa = currentMa;
+    if (batteryReading.valid) {
+        batteryReading.restVoltage += BATTERY_EWMA_ALPHA * (restVoltage - batteryReading.restVoltage);
+    } else {
+        batteryReading.restVoltage = restVoltage;
+    }
+    batteryReading.percent = voltageToSOC(batteryReading.restVoltage);
+    batteryReading.sampledAt = now;
+    batteryReading.valid = true;
 }
 
 int runBatteryCheck() {
-    float busvoltage = checkVoltage();
-    int batteryPercent = voltageToSOC(busvoltage);
+    sampleBattery(true);
     Serial.print("Supply Voltage: "); 
-    Serial.print(busvoltage); 
-    Serial.println(" V");
+    Serial.print(batteryReading.busVoltage); 
+    Serial.print(" V at ");
+    Serial.print(batteryReading.currentMa);
+    Serial.println(" mA");
     Serial.print("Battery Charge: "); 
-    Serial.print(batteryPercent); 
+    Serial.print(batteryReading.percent); 
     Serial.println(" %");
 
-    return batteryPercent;
+    return batteryReading.percent;
 }
@@ -5,13 +5,46 @@
 #include <ESP32Servo.h>
 #include <Adafruit_INA219.h>
 #include "config.h"
+#include "types.h"
 
 // ========================================
 // Servo Control Functions
 // ========================================
 
 void moveToAngle(int angle);
-void advanceCompartment();
+
+// ========================================
+// Servo Power
+// ========================================
+// The servo is only powered and attached while there is work for it:
+// servoTick() powers it up before a job and cuts it SERVO_POWER_HOLD_MS
+// after the queue drains, so an idle AP session draws no holding current.
+
+void servoPowerUp();
+void servoPowerDown();
+bool servoPowered();
+
+// ========================================
+// Motion Engine
+// ========================================
+
+typedef void (*MotionDoneHandler)(const MotionJob &job);
+
+// Queues a move; done runs from servoTick() once the carousel is at rest.
+// Returns the job id, or 0 if the queue is full.
+uint32_t queueMotion(MotionKind kind, bool manual, MotionDoneHandler done);
+
+// Advances the running move; call from loop() as often as possible
+void servoTick();
+bool servoBusy();
+void waitForMotion();
+
+bool findMotionJob(uint32_t id, MotionJob &job);
+uint32_t lastFinishedJobId();
+
+// Current samples (mA) of the last move made since boot
+const int16_t *dispenseCaptureTrace(uint16_t &count);
+const char *captureResultName(uint8_t result);
 
 // ========================================
 // Battery Monitoring Functions
@@ -21,11 +54,17 @@ float checkVoltage();
 int voltageToSOC(float v);
 int runBatteryCheck();
 
+// Takes a new sample every BATTERY_SAMPLE_INTERVAL once runBatteryCheck()
+// has found the sensor; force samples immediately. Readers use
+// batteryReading and never touch the I2C bus themselves.
+void sampleBattery(bool force = false);
+
 // ========================================
 // Global Hardware Objects (extern)
 // ========================================
 
 extern Servo myServo;
 extern Adafruit_INA219 ina219;
+extern bool currentSensorFound;
 
 #endif // SERVO_CONTROL_H
@@ -1,173 +1,800 @@
 #include "storage.h"
 #include "servo_control.h"
 #include "alarm_manager.h"
+#include "scheduler.h"
+#include <Preferences.h>
 #include <algorithm>
+#include <stddef.h>
+#include <vector>
 
 // ========================================
-// Alarm Storage Functions
+// Write Coalescing
 // ========================================
+// State changes made while dispensing mark their record dirty instead of
+// writing straight away. flushDirty() is the single point where dirty
+// records reach flash. The mask lives in RTC memory so scheduled wakes
+// can defer the flush across sleeps (the RTC snapshot is the primary copy).
+// A record whose write failed stays dirty but is only retried by the flush
+// before sleep, so a failing flash is not hammered (and the failure not
+// logged again) on every pass of the portal loop.
+
+RTC_DATA_ATTR static uint8_t dirtyRecords = 0;
+RTC_DATA_ATTR static uint8_t failedRecords = 0;
+RTC_DATA_ATTR static uint16_t deferredFlushes = 0;
+
+FlashWriteStats flashWrites = {0, 0};
+RTC_DATA_ATTR FlashWriteStats lastWakeFlashWrites = {0, 0};
+
+static bool saveConfigRecords(uint8_t records);
+
+void markDirty(uint8_t records) {
+    dirtyRecords |= records;
+}
+
+// Keeps the records dirty for the next flush before sleep; the event is
+// only logged the first time they fail
+static void writeFailed(uint8_t records, EventMessage message) {
+    dirtyRecords |= records;
+    if ((failedRecords & records) == records) return;
+    failedRecords |= records;
+    logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, message);
+}
 
-String alarmsToJson() {
-    DynamicJsonDocument doc(JSON_BUFFER_LARGE);
-    JsonArray arr = doc.to<JsonArray>();
+void flushDirty(bool deferScheduled, bool retryFailed) {
+    uint8_t pending = retryFailed ? dirtyRecords : dirtyRecords & ~failedRecords;
+    if (pending == 0) {
+        if (dirtyRecords == 0) deferredFlushes = 0;
+        return;
+    }
 
-    for (auto &a : alarms) {
-        JsonObject o = arr.createNestedObject();
-        o["id"] = a.id;
-        o["time"] = a.time;
-        o["active"] = a.active;
+    // Scheduled wakes only move the carousel and trigger times forward;
+    // batch those into one flush every few wakes
+    if (deferScheduled && deferredFlushes + 1 < RTC_STATE_BACKUP_WAKES) {
+        deferredFlushes++;
+        Serial.printf("Flash flush deferred (%d/%d)\n", deferredFlushes, RTC_STATE_BACKUP_WAKES);
+        return;
     }
 
-    String out;
-    serializeJson(arr, out);
-    return out;
+    if (pending & RECORD_ALARMS) saveAlarms();
+
+    // Mode and servo position share the config record, so one write covers both
+    uint8_t configRecords = pending & (RECORD_MODE | RECORD_SERVO);
+    if (configRecords && !saveConfigRecords(configRecords)) {
+        Serial.println("Failed to save the config record");
+        writeFailed(configRecords, (configRecords & RECORD_SERVO) ? MSG_SERVO_WRITE_FAILED : MSG_SETTINGS_WRITE_FAILED);
+    }
+    saveFlashStats();
+    deferredFlushes = 0;
 }
 
-void saveAlarms() {
-    // Sort alarms by time before saving
-    std::sort(alarms.begin(), alarms.end(), [](const Alarm &a, const Alarm &b) {
-        return a.time < b.time;
+// ========================================
+// Flash Write Accounting
+// ========================================
+// Lifetime write counters for each file and NVS record. They live in RTC memory and
+// reach flash_stats.bin only when flushDirty() writes records anyway, so
+// counting costs one small extra write per flush. A power cut loses the
+// counts since the last flush.
+
+#define FLASH_STATS_MAGIC 0x464C5354UL  // "FLST"
+#define FLASH_STATS_VERSION 2
+
+struct FlashStatsRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t fileCount;
+    uint32_t sinceUnix;
+    FlashFileStats files[FLASH_FILE_COUNT];
+    uint32_t crc;            // CRC-32 of everything above
+};
+
+RTC_DATA_ATTR static FlashStatsRecord flashStats;
+RTC_DATA_ATTR static bool flashStatsChanged = false;
+
+// NVS records are named after their key
+static const char *const FLASH_FILE_PATHS[FLASH_FILE_COUNT] = {
+    "nvs:" NVS_KEY_CONFIG, "nvs:" NVS_KEY_ALARMS, FILE_EVENTS, FILE_FLASH_STATS
+};
+
+static uint32_t flashStatsCrc(const FlashStatsRecord &record) {
+    return crc32Update(0, (const uint8_t *)&record, offsetof(FlashStatsRecord, crc));
+}
+
+static bool flashStatsOk(const FlashStatsRecord &record) {
+    return record.magic == FLASH_STATS_MAGIC && record.version == FLASH_STATS_VERSION &&
+           record.fileCount == FLASH_FILE_COUNT && record.crc == flashStatsCrc(record);
+}
+
+// Makes sure the counters are loaded: from RTC memory after a deep sleep,
+// otherwise from flash_stats.bin, or started from zero
+static void loadFlashStats() {
+    if (flashStatsOk(flashStats)) return;
+
+    FlashStatsRecord stored;
+    File f;
+    if (LittleFS.exists(FILE_FLASH_STATS)) f = LittleFS.open(FILE_FLASH_STATS, "r");
+    if (f && f.read((uint8_t *)&stored, sizeof(stored)) == sizeof(stored) && flashStatsOk(stored)) {
+        flashStats = stored;
+    } else {
+        extern RTC_DS3231 rtc;
+        memset(&flashStats, 0, sizeof(flashStats));
+        flashStats.magic = FLASH_STATS_MAGIC;
+        flashStats.version = FLASH_STATS_VERSION;
+        flashStats.fileCount = FLASH_FILE_COUNT;
+        flashStats.sinceUnix = rtc.now().unixtime();
+        Serial.println("Flash write counters started");
+    }
+    if (f) f.close();
+    flashStats.crc = flashStatsCrc(flashStats);
+}
+
+void countFlashWrite(FlashFile file, size_t bytes) {
+    flashWrites.filesWritten++;
+    flashWrites.bytesWritten += bytes;
+
+    loadFlashStats();
+    flashStats.files[file].writes++;
+    flashStats.files[file].bytesWritten += bytes;
+    flashStats.crc = flashStatsCrc(flashStats);
+    flashStatsChanged = true;
+}
+
+// A save left out because flash already held the content
+static void countFlashSkip(FlashFile file) {
+    loadFlashStats();
+    flashStats.files[file].skipped++;
+    flashStats.crc = flashStatsCrc(flashStats);
+}
+
+void saveFlashStats() {
+    if (!flashStatsChanged) return;
+    writeFileAtomic(FLASH_FILE_STATS, [](Print &out) {
+        return out.write((const uint8_t *)&flashStats, sizeof(flashStats));
     });
+    // Its own write is saved with the next flush
+    flashStatsChanged = false;
+}
 
-    File f = LittleFS.open(FILE_ALARMS, "w");
-    if (!f) {
-        Serial.println("Failed to open alarms.json for writing");
-        logEvent("ERROR", "System", "Error opening set-times config file (alarms.json)");
-        return;
+const FlashFileStats &flashFileStats(FlashFile file) {
+    loadFlashStats();
+    return flashStats.files[file];
+}
+
+const char *flashFileName(FlashFile file) {
+    const char *path = FLASH_FILE_PATHS[file];
+    // Files without the leading slash
+    return path[0] == '/' ? path + 1 : path;
+}
+
+uint32_t flashStatsSinceUnix() {
+    loadFlashStats();
+    return flashStats.sinceUnix;
+}
+
+// ========================================
+// Atomic File Writes
+// ========================================
+// LittleFS renames atomically, so a file written in full under a temporary
+// name and then renamed over the old one is never seen half written.
+
+// Print sink that compares what would be written with the file already
+// on flash, without holding either in memory
+class FileComparePrint : public Print {
+public:
+    size_t length = 0;
+    bool same;
+
+    explicit FileComparePrint(const char *path) {
+        if (LittleFS.exists(path)) file = LittleFS.open(path, "r");
+        same = (bool)file;
+    }
+
+    ~FileComparePrint() {
+        if (file) file.close();
     }
-    String jsonStr = alarmsToJson();
-    f.print(jsonStr);
+
+    // True if the file held exactly what was printed
+    bool matches() {
+        return same && length == file.size();
+    }
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        length += size;
+        uint8_t stored[64];
+        for (size_t done = 0; same && done < size; ) {
+            size_t n = std::min(size - done, sizeof(stored));
+            same = file.read(stored, n) == n && memcmp(stored, buffer + done, n) == 0;
+            done += n;
+        }
+        return size;
+    }
+
+private:
+    File file;
+};
+
+bool writeFileAtomic(FlashFile file, FileContent content) {
+    const char *path = FLASH_FILE_PATHS[file];
+    size_t length;
+    {
+        FileComparePrint existing(path);
+        content(existing);
+        length = existing.length;
+        if (existing.matches()) {
+            countFlashSkip(file);
+            return true;
+        }
+    }
+
+    String tempPath = String(path) + FILE_TEMP_SUFFIX;
+    File f = LittleFS.open(tempPath, "w");
+    if (!f) return false;
+    size_t written = content(f);
     f.close();
-    Serial.println("Saved alarms: " + jsonStr);
+    countFlashWrite(file, written);
+
+    // A short write (flash full) keeps the old file
+    if (written != length || !LittleFS.rename(tempPath, path)) {
+        Serial.printf("Failed to write %s\n", path);
+        LittleFS.remove(tempPath);
+        return false;
+    }
+    return true;
 }
 
-void loadAlarms() {
-    if (!LittleFS.exists(FILE_ALARMS)) {
-        Serial.println("alarms.json not found, creating new file");
-        alarms.clear();
-        saveAlarms();
-        return;
+bool writeFileAtomic(FlashFile file, const String &content) {
+    return writeFileAtomic(file, [&content](Print &out) {
+        return out.print(content);
+    });
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length) {
+    crc = ~crc;
+    while (length--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
     }
+    return ~crc;
+}
 
-    File f = LittleFS.open(FILE_ALARMS, "r");
+// ========================================
+// Config Records
+// ========================================
+// Mode, servo position, WiFi and UI settings are one binary record in NVS,
+// so a boot gets all of them with a single small read instead of opening
+// and parsing a JSON file for each. The alarm table (up to 2 KB) is a
+// second record beside it, so the servo and trigger saves made every few
+// wakes never rewrite it. Both carry a magic, version and CRC-32, and one
+// that fails the check is replaced with defaults. The first boot without
+// the records imports the old JSON files and then removes them.
+
+#define CONFIG_MAGIC 0x46434647UL        // "FCFG"
+#define CONFIG_VERSION 1
+#define ALARM_TABLE_MAGIC 0x414C524DUL   // "ALRM"
+#define ALARM_TABLE_VERSION 1
+
+struct ConfigRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                   // sizeof(ConfigRecord)
+
+    // Mode
+    char activeMode[20];
+    int32_t regIntervalHours;
+    int32_t regIntervalMinutes;
+    uint32_t regIntervalLastTriggerUnix;
+    int32_t randIntervalHours;
+    int32_t randIntervalMinutes;
+    uint32_t randIntervalBlockStartUnix;
+    uint32_t randPlanSeed;
+    uint32_t randPlanAnchorUnix;
+    int32_t randMinGapMinutes;
+    int32_t randQuietStartMinute;
+    int32_t randQuietEndMinute;
+
+    // Servo
+    int32_t compartment;
+
+    // WiFi and UI settings
+    char ssid[33];
+    char timeFormat[3];              // "12" or "24"
+    char theme[12];
+
+    uint32_t crc;                    // CRC-32 of everything above
+};
+
+struct AlarmTableHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t crc;                    // CRC-32 of the alarms after the header
+};
+
+// One alarm in the table, 8 bytes
+struct StoredAlarm {
+    uint32_t id;
+    uint16_t minute;
+    uint8_t days;
+    uint8_t active;
+};
+
+static ConfigRecord config;          // Loaded once per boot, then kept in step with NVS
+static bool configLoaded = false;
+static bool configStored = false;    // config is what NVS holds
+
+static uint32_t configCrc(const ConfigRecord &record) {
+    return crc32Update(0, (const uint8_t *)&record, offsetof(ConfigRecord, crc));
+}
+
+static bool configOk(const ConfigRecord &record) {
+    return record.magic == CONFIG_MAGIC && record.version == CONFIG_VERSION &&
+           record.size == sizeof(ConfigRecord) && record.crc == configCrc(record);
+}
+
+// Reads a whole NVS record. Returns false if there is none.
+static bool readNvsRecord(const char *key, std::vector<uint8_t> &data) {
+    data.clear();
+    Preferences prefs;
+    // A read-only begin fails until the namespace has been written once
+    if (!prefs.begin(NVS_NAMESPACE, true)) return false;
+    size_t length = prefs.getBytesLength(key);
+    data.resize(length);
+    if (length > 0 && prefs.getBytes(key, data.data(), length) != length) data.clear();
+    prefs.end();
+    return length > 0;
+}
+
+// Returns false if NVS would not take the record
+static bool writeNvsRecord(FlashFile file, const char *key, const uint8_t *data, size_t length) {
+    Preferences prefs;
+    size_t written = 0;
+    if (prefs.begin(NVS_NAMESPACE, false)) {
+        written = prefs.putBytes(key, data, length);
+        prefs.end();
+    }
+    if (written > 0) countFlashWrite(file, written);
+    return written == length;
+}
+
+// Seals next and makes it the stored config record, unless NVS already
+// holds exactly that. Returns false if it could not be written.
+static bool writeConfigRecord(ConfigRecord &next) {
+    next.crc = configCrc(next);
+    if (configStored && memcmp(&next, &config, sizeof(next)) == 0) {
+        countFlashSkip(FLASH_FILE_CONFIG);
+        return true;
+    }
+    if (!writeNvsRecord(FLASH_FILE_CONFIG, NVS_KEY_CONFIG, (const uint8_t *)&next, sizeof(next))) {
+        return false;
+    }
+    config = next;
+    configStored = true;
+    Serial.printf("Saved config record (%d bytes)\n", sizeof(next));
+    return true;
+}
+
+static void setDefaultConfig(ConfigRecord &record) {
+    memset(&record, 0, sizeof(record));
+    record.magic = CONFIG_MAGIC;
+    record.version = CONFIG_VERSION;
+    record.size = sizeof(ConfigRecord);
+    snprintf(record.activeMode, sizeof(record.activeMode), "set_times");
+    record.regIntervalMinutes = 30;
+    record.randIntervalHours = 1;
+    snprintf(record.ssid, sizeof(record.ssid), DEFAULT_SSID);
+    snprintf(record.timeFormat, sizeof(record.timeFormat), "12");
+    snprintf(record.theme, sizeof(record.theme), "light");
+}
+
+// Reads one of the old JSON config files. Returns false if it is missing
+// or does not parse.
+static bool readLegacyJson(const char *path, JsonDocument &doc) {
+    if (!LittleFS.exists(path)) return false;
+
+    File f = LittleFS.open(path, "r");
     if (!f) {
-        Serial.println("Failed to open alarms.json for reading");
-        logEvent("ERROR", "System", "Error opening mode set-times file for reading (alarms.json)");
-        return;
+        Serial.printf("Failed to open %s\n", path);
+        return false;
     }
-    
     String json = f.readString();
     f.close();
-    
-    Serial.println("Loaded JSON: " + json);
-    
-    json.trim();
-    if (json.length() == 0) {
-        Serial.println("Empty JSON file, initializing with empty array");
-        alarms.clear();
-        saveAlarms();
-        return;
-    }
 
-    DynamicJsonDocument doc(JSON_BUFFER_LARGE);
     DeserializationError err = deserializeJson(doc, json);
     if (err) {
-        Serial.print("Error parsing alarms.json: ");
-        Serial.println(err.c_str());
-        Serial.println("JSON content was: " + json);
-        alarms.clear();
-        saveAlarms();
+        Serial.printf("Error parsing %s: %s\n", path, err.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Fills record from the JSON files used before the config record
+static void migrateLegacyConfig(ConfigRecord &record) {
+    DynamicJsonDocument doc(JSON_BUFFER_MEDIUM);
+
+    // Fields an older file lacks keep the setDefaultConfig() values
+    if (readLegacyJson(FILE_MODE, doc)) {
+        const char *activeMode = doc["activeMode"].as<const char *>();
+        if (activeMode) snprintf(record.activeMode, sizeof(record.activeMode), "%s", activeMode);
+        record.regIntervalHours = doc["regIntervalHours"] | record.regIntervalHours;
+        record.regIntervalMinutes = doc["regIntervalMinutes"] | record.regIntervalMinutes;
+        record.regIntervalLastTriggerUnix = doc["regIntervalLastTriggerUnix"] | record.regIntervalLastTriggerUnix;
+        record.randIntervalHours = doc["randIntervalHours"] | record.randIntervalHours;
+        record.randIntervalMinutes = doc["randIntervalMinutes"] | record.randIntervalMinutes;
+        record.randIntervalBlockStartUnix = doc["randIntervalBlockStartUnix"] | record.randIntervalBlockStartUnix;
+        record.randPlanSeed = doc["randPlanSeed"] | record.randPlanSeed;
+        record.randPlanAnchorUnix = doc["randPlanAnchorUnix"] | record.randPlanAnchorUnix;
+        record.randMinGapMinutes = doc["randMinGapMinutes"] | record.randMinGapMinutes;
+        record.randQuietStartMinute = doc["randQuietStartMinute"] | record.randQuietStartMinute;
+        record.randQuietEndMinute = doc["randQuietEndMinute"] | record.randQuietEndMinute;
+    }
+
+    if (readLegacyJson(FILE_SERVO, doc)) {
+        record.compartment = doc["compartment"] | record.compartment;
+    } else {
+        Serial.println("servo.json not found, starting at compartment 0");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_SERVO_FILE_MISSING);
+    }
+
+    if (readLegacyJson(FILE_WIFI, doc)) {
+        const char *ssid = doc["ssid"].as<const char *>();
+        if (ssid && strlen(ssid) > 0 && strlen(ssid) < sizeof(record.ssid)) {
+            snprintf(record.ssid, sizeof(record.ssid), "%s", ssid);
+        }
+    }
+
+    if (readLegacyJson(FILE_SETTINGS, doc)) {
+        const char *timeFormat = doc["timeFormat"].as<const char *>();
+        const char *theme = doc["theme"].as<const char *>();
+        if (timeFormat && strlen(timeFormat) > 0 && strlen(timeFormat) < sizeof(record.timeFormat)) {
+            snprintf(record.timeFormat, sizeof(record.timeFormat), "%s", timeFormat);
+        }
+        if (theme && strlen(theme) > 0 && strlen(theme) < sizeof(record.theme)) {
+            snprintf(record.theme, sizeof(record.theme), "%s", theme);
+        }
+    }
+}
+
+// Makes sure config holds the stored record: read from NVS on the first
+// call of a boot, imported from the JSON files if NVS has none yet
+static void loadConfigRecord() {
+    if (configLoaded) return;
+    configLoaded = true;
+
+    std::vector<uint8_t> data;
+    bool found = readNvsRecord(NVS_KEY_CONFIG, data);
+    if (found && data.size() == sizeof(config)) {
+        memcpy(&config, data.data(), sizeof(config));
+        if (configOk(config)) {
+            configStored = true;
+            return;
+        }
+    }
+
+    ConfigRecord record;
+    setDefaultConfig(record);
+    if (found) {
+        Serial.println("Config record invalid, using defaults");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_CONFIG_INVALID);
+    } else {
+        Serial.println("No config record, importing the JSON config files");
+        migrateLegacyConfig(record);
+    }
+
+    if (!writeConfigRecord(record)) {
+        // Run on the imported values; the next save tries again
+        config = record;
         return;
     }
+    if (!found) {
+        for (const char *path : {FILE_MODE, FILE_SERVO, FILE_WIFI, FILE_SETTINGS}) {
+            if (LittleFS.exists(path)) LittleFS.remove(path);
+        }
+    }
+}
+
+// Stores the running state the records name (RECORD_MODE, RECORD_SERVO)
+// in the config record with one write
+static bool saveConfigRecords(uint8_t records) {
+    loadConfigRecord();
+    ConfigRecord next = config;
+
+    if (records & RECORD_MODE) {
+        snprintf(next.activeMode, sizeof(next.activeMode), "%s", modeConfig.activeMode.c_str());
+        next.regIntervalHours = modeConfig.regIntervalHours;
+        next.regIntervalMinutes = modeConfig.regIntervalMinutes;
+        next.regIntervalLastTriggerUnix = modeConfig.regIntervalLastTriggerUnix;
+        next.randIntervalHours = modeConfig.randIntervalHours;
+        next.randIntervalMinutes = modeConfig.randIntervalMinutes;
+        next.randIntervalBlockStartUnix = modeConfig.randIntervalBlockStartUnix;
+        next.randPlanSeed = modeConfig.randPlanSeed;
+        next.randPlanAnchorUnix = modeConfig.randPlanAnchorUnix;
+        next.randMinGapMinutes = modeConfig.randMinGapMinutes;
+        next.randQuietStartMinute = modeConfig.randQuietStartMinute;
+        next.randQuietEndMinute = modeConfig.randQuietEndMinute;
+    }
+    if (records & RECORD_SERVO) {
+        next.compartment = compartment;
+    }
+
+    if (!writeConfigRecord(next)) return false;
+    dirtyRecords &= ~records;
+    failedRecords &= ~records;
+    return true;
+}
+
+void configToJson(JsonObject root) {
+    loadConfigRecord();
+
+    JsonObject mode = root.createNestedObject("mode");
+    mode["activeMode"] = config.activeMode;
+    mode["regIntervalHours"] = config.regIntervalHours;
+    mode["regIntervalMinutes"] = config.regIntervalMinutes;
+    mode["regIntervalLastTriggerUnix"] = config.regIntervalLastTriggerUnix;
+    mode["randIntervalHours"] = config.randIntervalHours;
+    mode["randIntervalMinutes"] = config.randIntervalMinutes;
+    mode["randIntervalBlockStartUnix"] = config.randIntervalBlockStartUnix;
+    mode["randPlanSeed"] = config.randPlanSeed;
+    mode["randPlanAnchorUnix"] = config.randPlanAnchorUnix;
+    mode["randMinGapMinutes"] = config.randMinGapMinutes;
+    mode["randQuietStartMinute"] = config.randQuietStartMinute;
+    mode["randQuietEndMinute"] = config.randQuietEndMinute;
+
+    JsonObject servo = root.createNestedObject("servo");
+    servo["compartment"] = config.compartment;
+    servo["angle"] = config.compartment * SERVO_ANGLE_STEP;
+
+    JsonObject wifi = root.createNestedObject("wifi");
+    wifi["ssid"] = config.ssid;
+
+    JsonObject settings = root.createNestedObject("settings");
+    settings["timeFormat"] = config.timeFormat;
+    settings["theme"] = config.theme;
+}
+
+// ========================================
+// Alarm Storage Functions
+// ========================================
+
+bool parseAlarmTime(const char *time, uint16_t &minute) {
+    if (!time || strlen(time) != 5 || time[2] != ':' ||
+        !isdigit(time[0]) || !isdigit(time[1]) || !isdigit(time[3]) || !isdigit(time[4])) {
+        return false;
+    }
+    int hour = (time[0] - '0') * 10 + (time[1] - '0');
+    int min = (time[3] - '0') * 10 + (time[4] - '0');
+    if (hour > 23 || min > 59) return false;
+
+    minute = hour * 60 + min;
+    return true;
+}
+
+size_t alarmToJson(const Alarm &alarm, char *out, size_t size) {
+    char time[6];
+    snprintf(time, sizeof(time), "%02u:%02u", alarm.minute / 60, alarm.minute % 60);
+
+    StaticJsonDocument<JSON_BUFFER_SMALL> doc;
+    doc["id"] = alarm.id;
+    doc["time"] = time;
+    doc["days"] = alarm.days;
+    doc["active"] = alarm.active;
+
+    return serializeJson(doc, out, size);
+}
+
+void sortAlarms() {
+    std::sort(alarms.begin(), alarms.end(), [](const Alarm &a, const Alarm &b) {
+        return a.minute < b.minute;
+    });
+}
+
+static std::vector<uint8_t> packAlarmTable() {
+    AlarmTableHeader header = {ALARM_TABLE_MAGIC, ALARM_TABLE_VERSION, (uint16_t)alarms.size(), 0};
+    std::vector<uint8_t> table(sizeof(header) + alarms.size() * sizeof(StoredAlarm));
+    StoredAlarm *stored = (StoredAlarm *)(table.data() + sizeof(header));
+    for (size_t i = 0; i < alarms.size(); i++) {
+        stored[i].id = alarms[i].id;
+        stored[i].minute = alarms[i].minute;
+        stored[i].days = alarms[i].days;
+        stored[i].active = alarms[i].active ? 1 : 0;
+    }
+    header.crc = crc32Update(0, (const uint8_t *)stored, alarms.size() * sizeof(StoredAlarm));
+    memcpy(table.data(), &header, sizeof(header));
+    return table;
+}
+
+// Replaces the alarms with the table's. Returns false, leaving the alarms
+// alone, if the table fails its checks.
+static bool unpackAlarmTable(const std::vector<uint8_t> &table) {
+    AlarmTableHeader header;
+    if (table.size() < sizeof(header)) return false;
+    memcpy(&header, table.data(), sizeof(header));
+
+    const StoredAlarm *stored = (const StoredAlarm *)(table.data() + sizeof(header));
+    size_t bytes = header.count * sizeof(StoredAlarm);
+    if (header.magic != ALARM_TABLE_MAGIC || header.version != ALARM_TABLE_VERSION ||
+        header.count > MAX_ALARMS || table.size() != sizeof(header) + bytes ||
+        header.crc != crc32Update(0, (const uint8_t *)stored, bytes)) {
+        return false;
+    }
 
     alarms.clear();
-    JsonArray arr = doc.as<JsonArray>();
-    for (JsonObject o : arr) {
+    for (uint16_t i = 0; i < header.count; i++) {
         Alarm a;
-        a.id = o["id"].as<uint32_t>();
-        a.time = o["time"].as<String>();
-        a.active = o["active"].as<bool>();
+        a.id = stored[i].id;
+        a.minute = stored[i].minute;
+        a.days = stored[i].days & ALARM_DAYS_ALL;
+        a.active = stored[i].active != 0;
         alarms.push_back(a);
     }
+    return true;
+}
 
-    std::sort(alarms.begin(), alarms.end(), [](const Alarm &a, const Alarm &b) {
-        return a.time < b.time;
-    });
+// Returns false if the table could not be written
+static bool writeAlarmTable() {
+    sortAlarms();
+    std::vector<uint8_t> table = packAlarmTable();
 
-    Serial.printf("Loaded %d alarms\n", alarms.size());
+    std::vector<uint8_t> stored;
+    if (readNvsRecord(NVS_KEY_ALARMS, stored) && stored == table) {
+        countFlashSkip(FLASH_FILE_ALARMS);
+    } else if (!writeNvsRecord(FLASH_FILE_ALARMS, NVS_KEY_ALARMS, table.data(), table.size())) {
+        return false;
+    }
+    dirtyRecords &= ~RECORD_ALARMS;
+    failedRecords &= ~RECORD_ALARMS;
+    Serial.printf("Saved %d alarms (%d bytes)\n", alarms.size(), table.size());
+    return true;
 }
 
-// ========================================
-// Mode Configuration Storage
-// ========================================
+// Copies the next top-level {...} object of a JSON array into buf.
+// Returns false at the end of the array or if an object does not fit.
+static bool readNextAlarmObject(File &f, char *buf, size_t size) {
+    int c;
+    while ((c = f.read()) >= 0 && c != '{') {
+        if (c == ']') return false;
+    }
+    if (c < 0) return false;
 
-void saveModeConfig() {
-    File f = LittleFS.open(FILE_MODE, "w");
+    size_t len = 0;
+    int depth = 0;
+    bool inString = false;
+    do {
+        if (len + 1 >= size) return false;
+        buf[len++] = c;
+        if (c == '"') inString = !inString;
+        else if (!inString && c == '{') depth++;
+        else if (!inString && c == '}') depth--;
+    } while (depth > 0 && (c = f.read()) >= 0);
+
+    buf[len] = '\0';
+    return depth == 0;
+}
+
+// Imports alarms.json, the alarm store before the NVS table
+static void migrateLegacyAlarms() {
+    if (!LittleFS.exists(FILE_ALARMS)) return;
+
+    File f = LittleFS.open(FILE_ALARMS, "r");
     if (!f) {
-        Serial.println("Failed to open mode.json for writing");
+        Serial.println("Failed to open alarms.json for reading");
         return;
     }
-    
-    DynamicJsonDocument doc(JSON_BUFFER_MEDIUM);
-    doc["activeMode"] = modeConfig.activeMode;
-    doc["regIntervalHours"] = modeConfig.regIntervalHours;
-    doc["regIntervalMinutes"] = modeConfig.regIntervalMinutes;
-    doc["regIntervalLastTriggerUnix"] = modeConfig.regIntervalLastTriggerUnix;
-    doc["randIntervalHours"] = modeConfig.randIntervalHours;
-    doc["randIntervalMinutes"] = modeConfig.randIntervalMinutes;
-    doc["randIntervalBlockStartUnix"] = modeConfig.randIntervalBlockStartUnix;
-    doc["randIntervalNextTriggerUnix"] = modeConfig.randIntervalNextTriggerUnix;
-    
-    String jsonStr;
-    serializeJson(doc, jsonStr);
-    f.print(jsonStr);
+
+    // Parse one alarm at a time so the document stays small however many
+    // slots are configured. Files written before "days" existed default
+    // to every day.
+    char alarmJson[JSON_BUFFER_SMALL];
+    StaticJsonDocument<JSON_BUFFER_SMALL> doc;
+    size_t skipped = 0;
+    while (readNextAlarmObject(f, alarmJson, sizeof(alarmJson))) {
+        DeserializationError err = deserializeJson(doc, alarmJson);
+        Alarm a;
+        if (err || !parseAlarmTime(doc["time"].as<const char *>(), a.minute)) {
+            Serial.printf("Skipping invalid alarm: %s\n", alarmJson);
+            skipped++;
+            continue;
+        }
+        if (alarms.size() >= MAX_ALARMS) {
+            skipped++;
+            continue;
+        }
+        a.id = doc["id"].as<uint32_t>();
+        a.days = (doc["days"] | ALARM_DAYS_ALL) & ALARM_DAYS_ALL;
+        a.active = doc["active"].as<bool>();
+        alarms.push_back(a);
+    }
     f.close();
-    
-    Serial.println("Saved mode config: " + jsonStr);
+
+    if (skipped > 0) {
+        Serial.printf("WARNING: skipped %d alarms in alarms.json\n", skipped);
+    }
+    Serial.printf("Imported %d alarms from alarms.json\n", alarms.size());
 }
 
-void loadModeConfig() {
-    if (!LittleFS.exists(FILE_MODE)) {
-        Serial.println("mode.json not found, creating default");
-        modeConfig.activeMode = "set_times";
-        modeConfig.regIntervalHours = 0;
-        modeConfig.regIntervalMinutes = 30;
-        modeConfig.regIntervalLastTriggerUnix = 0;
-        modeConfig.randIntervalHours = 1;
-        modeConfig.randIntervalMinutes = 0;
-        modeConfig.randIntervalBlockStartUnix = 0;
-        modeConfig.randIntervalNextTriggerUnix = 0;
-        saveModeConfig();
-        return;
+void saveAlarms() {
+    if (!writeAlarmTable()) {
+        Serial.println("Failed to save the alarm table");
+        writeFailed(RECORD_ALARMS, MSG_ALARMS_WRITE_FAILED);
     }
-    
-    File f = LittleFS.open(FILE_MODE, "r");
-    if (!f) {
-        Serial.println("Failed to open mode.json");
+}
+
+void loadAlarms() {
+    std::vector<uint8_t> table;
+    bool found = readNvsRecord(NVS_KEY_ALARMS, table);
+    if (found && unpackAlarmTable(table)) {
+        Serial.printf("Loaded %d alarms\n", alarms.size());
         return;
     }
-    
-    String json = f.readString();
-    f.close();
-    
-    DynamicJsonDocument doc(JSON_BUFFER_MEDIUM);
-    DeserializationError err = deserializeJson(doc, json);
-    if (err) {
-        Serial.print("Error parsing mode.json: ");
-        Serial.println(err.c_str());
+
+    alarms.clear();
+    if (found) {
+        Serial.println("Alarm table invalid, starting with no alarms");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_ALARMS_READ_FAILED);
+    } else {
+        migrateLegacyAlarms();
+    }
+
+    if (!writeAlarmTable()) {
+        writeFailed(RECORD_ALARMS, MSG_ALARMS_WRITE_FAILED);
+    } else if (!found && LittleFS.exists(FILE_ALARMS)) {
+        LittleFS.remove(FILE_ALARMS);
+    }
+}
+
+// ========================================
+// Mode Configuration Storage
+// ========================================
+
+void saveModeConfig() {
+    if (!saveConfigRecords(RECORD_MODE)) {
+        Serial.println("Failed to save mode config");
+        writeFailed(RECORD_MODE, MSG_SETTINGS_WRITE_FAILED);
         return;
     }
-    
-    modeConfig.activeMode = doc["activeMode"].as<String>();
-    modeConfig.regIntervalHours = doc["regIntervalHours"];
-    modeConfig.regIntervalMinutes = doc["regIntervalMinutes"];
-    modeConfig.regIntervalLastTriggerUnix = doc["regIntervalLastTriggerUnix"];
-    modeConfig.randIntervalHours = doc["randIntervalHours"];
-    modeConfig.randIntervalMinutes = doc["randIntervalMinutes"];
-    modeConfig.randIntervalBlockStartUnix = doc["randIntervalBlockStartUnix"];
-    modeConfig.randIntervalNextTriggerUnix = doc["randIntervalNextTriggerUnix"];
-    
-    Serial.println("Loaded mode config: " + json);
+    Serial.printf("Saved mode config: %s\n", config.activeMode);
+}
+
+void loadModeConfig() {
+    loadConfigRecord();
+    modeConfig.activeMode = config.activeMode;
+    modeConfig.regIntervalHours = config.regIntervalHours;
+    modeConfig.regIntervalMinutes = config.regIntervalMinutes;
+    modeConfig.regIntervalLastTriggerUnix = config.regIntervalLastTriggerUnix;
+    modeConfig.randIntervalHours = config.randIntervalHours;
+    modeConfig.randIntervalMinutes = config.randIntervalMinutes;
+    modeConfig.randIntervalBlockStartUnix = config.randIntervalBlockStartUnix;
+    modeConfig.randPlanSeed = config.randPlanSeed;
+    modeConfig.randPlanAnchorUnix = config.randPlanAnchorUnix;
+    modeConfig.randMinGapMinutes = config.randMinGapMinutes;
+    modeConfig.randQuietStartMinute = config.randQuietStartMinute;
+    modeConfig.randQuietEndMinute = config.randQuietEndMinute;
+
+    // Records written before the intervals were checked can hold any value
+    ConfigRecord defaults;
+    setDefaultConfig(defaults);
+    if (!intervalInRange(modeConfig.regIntervalHours, modeConfig.regIntervalMinutes)) {
+        Serial.printf("Regular interval %dh %dm out of range, reset\n",
+                      modeConfig.regIntervalHours, modeConfig.regIntervalMinutes);
+        modeConfig.regIntervalHours = defaults.regIntervalHours;
+        modeConfig.regIntervalMinutes = defaults.regIntervalMinutes;
+        markDirty(RECORD_MODE);
+        logEvent(EVENT_ERROR, EVENT_MODE_REGULAR_INTERVAL, MSG_INTERVAL_INVALID);
+    }
+    if (!intervalInRange(modeConfig.randIntervalHours, modeConfig.randIntervalMinutes)) {
+        Serial.printf("Random interval %dh %dm out of range, reset\n",
+                      modeConfig.randIntervalHours, modeConfig.randIntervalMinutes);
+        modeConfig.randIntervalHours = defaults.randIntervalHours;
+        modeConfig.randIntervalMinutes = defaults.randIntervalMinutes;
+        markDirty(RECORD_MODE);
+        logEvent(EVENT_ERROR, EVENT_MODE_RANDOM_INTERVAL, MSG_INTERVAL_INVALID);
+    }
+
+    Serial.printf("Loaded mode config: %s\n", config.activeMode);
 }
 
 // ========================================
@@ -175,60 +802,22 @@ void loadModeConfig() {
 // ========================================
 
 void saveCompartmentPosition() {
-    File f = LittleFS.open(FILE_SERVO, "w");
-    if (!f) {
-        Serial.println("Failed to open servo.json for writing");
-        logEvent("ERROR", "system", "Failed to save servo position in servo config (servo.json)");
+    if (!saveConfigRecords(RECORD_SERVO)) {
+        Serial.println("Failed to save servo position");
+        writeFailed(RECORD_SERVO, MSG_SERVO_WRITE_FAILED);
         return;
     }
-    
-    DynamicJsonDocument doc(128);
-    doc["compartment"] = compartment;
-    doc["angle"] = compartment * SERVO_ANGLE_STEP;
-    
-    String jsonStr;
-    serializeJson(doc, jsonStr);
-    f.print(jsonStr);
-    f.close();
-    
-    Serial.printf("Saved servo position: compartment=%d, angle=%d\n", 
+
+    Serial.printf("Saved servo position: compartment=%d, angle=%d\n",
                   compartment, compartment * SERVO_ANGLE_STEP);
 }
 
 void loadCompartmentPosition() {
-    if (!LittleFS.exists(FILE_SERVO)) {
-        Serial.println("servo.json not found, starting at compartment 0");
-        logEvent("ERROR", "System", "Error opening servo config file (servo.json) - File Not Found");
-        compartment = 0;
-        saveCompartmentPosition();
-        return;
-    }
-    
-    File f = LittleFS.open(FILE_SERVO, "r");
-    if (!f) {
-        Serial.println("Failed to open servo.json for reading");
-        logEvent("ERROR", "System", "Error opening servo config file for reading (servo.json)");
-        compartment = 0;
-        return;
-    }
-    
-    String json = f.readString();
-    f.close();
-    
-    DynamicJsonDocument doc(128);
-    DeserializationError err = deserializeJson(doc, json);
-    if (err) {
-        Serial.print("Error parsing servo.json: ");
-        Serial.println(err.c_str());
-        compartment = 0;
-        return;
-    }
-    
-    compartment = doc["compartment"];
-    int savedAngle = doc["angle"];
-    
-    Serial.printf("Loaded servo position: compartment=%d, angle=%d\n", 
-                  compartment, savedAngle);
+    loadConfigRecord();
+    compartment = config.compartment;
+
+    Serial.printf("Loaded servo position: compartment=%d, angle=%d\n",
+                  compartment, compartment * SERVO_ANGLE_STEP);
 }
 
 // ========================================
@@ -236,103 +825,138 @@ void loadCompartmentPosition() {
 // ========================================
 
 void loadWiFiSettings() {
-    if (!LittleFS.exists(FILE_WIFI)) {
-        Serial.println("wifi.json not found, creating default");
-        File f = LittleFS.open(FILE_WIFI, "w");
-        if (f) {
-            f.print("{\"ssid\":\"" DEFAULT_SSID "\"}");
-            f.close();
-        }
-        return;
-    }
-    
-    File f = LittleFS.open(FILE_WIFI, "r");
-    if (!f) {
-        Serial.println("Failed to open wifi.json");
-        logEvent("ERROR", "System", "Error opening wifi config (wifi.json)");
-        return;
-    }
-    
-    String json = f.readString();
-    f.close();
-    
-    DynamicJsonDocument doc(JSON_BUFFER_SMALL);
-    DeserializationError err = deserializeJson(doc, json);
-    if (err) {
-        Serial.print("Error parsing wifi.json: ");
-        Serial.println(err.c_str());
-        logEvent("ERROR", "System", "Error reading wifi config from file (wifi.json)");
-        return;
-    }
-    
-    currentSSID = doc["ssid"].as<String>();
-    
+    loadConfigRecord();
+    currentSSID = config.ssid;
+
     // Validate SSID
     if (currentSSID.length() == 0 || currentSSID.length() > 32) {
         Serial.println("Invalid SSID length, using default");
         currentSSID = DEFAULT_SSID;
     }
-    
+
     Serial.println("Loaded WiFi settings:");
     Serial.println("  SSID: " + currentSSID);
 }
 
 void saveWiFiSettings(String ssid) {
-    File f = LittleFS.open(FILE_WIFI, "w");
-    if (!f) {
-        Serial.println("Failed to open wifi.json for writing");
-        logEvent("ERROR", "System", "Error opening wifi config for writing (wifi.json)");
+    loadConfigRecord();
+    ConfigRecord next = config;
+    snprintf(next.ssid, sizeof(next.ssid), "%s", ssid.c_str());
+    if (!writeConfigRecord(next)) {
+        Serial.println("Failed to save WiFi settings");
+        logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_WIFI_WRITE_FAILED);
         return;
     }
-    
-    DynamicJsonDocument doc(JSON_BUFFER_SMALL);
-    doc["ssid"] = ssid;
-    
-    String jsonStr;
-    serializeJson(doc, jsonStr);
-    f.print(jsonStr);
-    f.close();
-    
-    Serial.println("Saved WiFi settings: " + jsonStr);
+
+    Serial.println("Saved WiFi settings: " + ssid);
 }
 
 // ========================================
 // Settings Storage
 // ========================================
 
-void initSettings() {
-    if (!LittleFS.exists(FILE_SETTINGS)) {
-        Serial.println("settings.json not found, creating default");
-        File f = LittleFS.open(FILE_SETTINGS, "w");
-        if (f) {
-            f.print("{\"timeFormat\":\"12\",\"theme\":\"light\"}");
-            f.close();
-        }
-    }
+String settingsToJson() {
+    loadConfigRecord();
+    StaticJsonDocument<JSON_BUFFER_SMALL> doc;
+    doc["timeFormat"] = config.timeFormat;
+    doc["theme"] = config.theme;
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+bool saveSettings(const char *timeFormat, const char *theme) {
+    loadConfigRecord();
+    ConfigRecord next = config;
+    snprintf(next.timeFormat, sizeof(next.timeFormat), "%s", timeFormat);
+    snprintf(next.theme, sizeof(next.theme), "%s", theme);
+    return writeConfigRecord(next);
 }
 
 // ========================================
 // Event Logging
 // ========================================
 
-void logEvent(String type, String mode, String message) {
+static const char *const EVENT_SEVERITY_NAMES[] = {
+    "SUCCESS", "WARNING", "ERROR"
+};
+
+static const char *const EVENT_MODE_NAMES[] = {
+    "System", "set_times", "regular_interval", "random_interval", "Manual Activation"
+};
+
+// Indexed by EventMessage; %d is replaced by the event's arg
+static const char *const EVENT_MESSAGE_TEXT[MSG_COUNT] = {
+    "Imported event",
+    "Initial system start",
+    "System started/woke from sleep",
+    "Activation completed successfully (Chamber %d)",
+    "LittleFS not accessible - events may not persist",
+    "RTC communication error - clock may have lost power",
+    "RTC lost power - time may be incorrect, battery may need replacement",
+    "Servo power transistor failed to activate",
+    "Flash Memory (LittleFS) error on startup",
+    "RTC communication error on startup - clock may have lost power",
+    "Failed to find INA219 (battery sensor) on startup",
+    "Error saving the set-times alarm table (NVS)",
+    "Set-times alarm table (NVS) invalid - alarms cleared",
+    "Failed to save servo position in the config record (NVS)",
+    "No servo.json to import - servo position starts at compartment 0",
+    "Error reading servo.json (older firmware)",
+    "Error opening wifi.json (older firmware)",
+    "Error reading wifi.json (older firmware)",
+    "Error saving wifi config to the config record (NVS)",
+    "Error parsing set-time addition request",
+    "Error saving mode or settings to the config record (NVS)",
+    "Error parsing sync-time request",
+    "Error parsing WiFi settings",
+    "Servo stalled - carousel may be jammed (Chamber %d)",
+    "Servo drew no current - carousel did not move (Chamber %d)",
+    "Config record (NVS) invalid - mode, servo position and settings reset to defaults",
+    "Error in interval mode request - interval must be 1 minute to 7 days",
+    "Stored interval out of range - reset to the default"
+};
+
+const char *eventSeverityName(uint8_t severity) {
+    return severity <= EVENT_ERROR ? EVENT_SEVERITY_NAMES[severity] : "UNKNOWN";
+}
+
+const char *eventModeName(uint8_t mode) {
+    return mode <= EVENT_MODE_MANUAL ? EVENT_MODE_NAMES[mode] : "System";
+}
+
+String eventMessageText(const EventLog &event) {
+    if (event.message >= MSG_COUNT) {
+        return "Unknown event";
+    }
+    char text[96];
+    snprintf(text, sizeof(text), EVENT_MESSAGE_TEXT[event.message], event.arg);
+    return String(text);
+}
+
+EventMode currentEventMode() {
+    for (uint8_t i = EVENT_MODE_SET_TIMES; i <= EVENT_MODE_RANDOM_INTERVAL; i++) {
+        if (modeConfig.activeMode == EVENT_MODE_NAMES[i]) {
+            return (EventMode)i;
+        }
+    }
+    return EVENT_MODE_SYSTEM;
+}
+
+void logEvent(EventSeverity severity, EventMode mode, EventMessage message, uint8_t arg) {
     extern RTC_DS3231 rtc;
     DateTime now = rtc.now();
-    uint32_t currentUnix = now.unixtime();
     
     EventLog event;
-    event.timestamp = currentUnix;
-    event.type = type;
+    event.timestamp = now.unixtime();
+    event.severity = severity;
     event.mode = mode;
     event.message = message;
+    event.arg = arg;
     
-    // Add to in-memory history
-    eventHistory.push_back(event);
-    
-    // Keep only recent events in memory
-    if (eventHistory.size() > MAX_EVENTS_IN_MEMORY) {
-        eventHistory.erase(eventHistory.begin());
-    }
+    // Add to in-memory history (the ring drops the oldest event when full)
+    eventHistory.push(event);
     
     // Save to file
     saveEventToFile(event);
@@ -344,48 +968,98 @@ void logEvent(String type, String mode, String message) {
              now.hour(), now.minute(), now.second());
     
     Serial.printf("[%s] [%s] [%s] %s\n", 
-                 timeStr, type.c_str(), mode.c_str(), message.c_str());
+                 timeStr, eventSeverityName(severity), eventModeName(mode),
+                 eventMessageText(event).c_str());
 }
 
-void saveEventToFile(const EventLog &event) {
-    File f = LittleFS.open(FILE_EVENTS, "a");
-    if (!f) {
-        Serial.println("Failed to open events.log for writing");
-        return;
+// ========================================
+// Event Log Ring File
+// ========================================
+// events.bin is a small header followed by EVENT_LOG_CAPACITY packed
+// EventLog records. Appends overwrite the oldest slot and then update the header in
+// place, so logging cost stays flat as history grows and reads never
+// rewrite the file. A power cut between the two writes loses only the
+// newest record.
+
+#define EVENT_LOG_MAGIC 0x45564C47UL  // "EVLG"
+#define EVENT_LOG_VERSION 3
+
+struct EventLogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t capacity;
+    uint32_t head;      // Slot the next record is written to
+    uint32_t count;     // Valid records, at most capacity
+    uint32_t sequence;  // Records ever appended; the newest record's id is sequence - 1
+};
+
+static EventLogHeader eventLogHeader;
+static bool eventLogHeaderValid = false;
+
+static bool eventLogHeaderOk(const EventLogHeader &h, size_t fileSize) {
+    return h.magic == EVENT_LOG_MAGIC && h.version == EVENT_LOG_VERSION &&
+           h.recordSize == sizeof(EventLog) && h.capacity == EVENT_LOG_CAPACITY &&
+           h.head < h.capacity && h.count <= h.capacity &&
+           fileSize == sizeof(EventLogHeader) + h.capacity * sizeof(EventLog);
+}
+
+// Writes one record into the head slot and advances the in-memory header.
+// Returns the bytes written.
+static size_t writeEventRecord(File &f, const EventLog &record) {
+    f.seek(sizeof(EventLogHeader) + eventLogHeader.head * sizeof(EventLog));
+    size_t bytes = f.write((const uint8_t *)&record, sizeof(record));
+    eventLogHeader.head = (eventLogHeader.head + 1) % eventLogHeader.capacity;
+    if (eventLogHeader.count < eventLogHeader.capacity) {
+        eventLogHeader.count++;
     }
-    
-    f.printf("%lu,%s,%s,%s\n", 
-             event.timestamp, 
-             event.type.c_str(), 
-             event.mode.c_str(), 
-             event.message.c_str());
-    
-    f.close();
+    eventLogHeader.sequence++;
+    return bytes;
 }
 
-void loadEventsFromFile() {
-    extern RTC_DS3231 rtc;
-    eventHistory.clear();
-    
-    if (!LittleFS.exists(FILE_EVENTS)) {
-        Serial.println("events.log not found");
+static size_t writeEventLogHeader(File &f) {
+    f.seek(0);
+    return f.write((const uint8_t *)&eventLogHeader, sizeof(eventLogHeader));
+}
+
+// Maps the text fields of an old CSV event back onto codes. Messages that
+// no longer exist are kept as MSG_IMPORTED_EVENT.
+static void parseLegacyEvent(const String &type, const String &mode, const String &message, EventLog &event) {
+    event.severity = EVENT_SUCCESS;
+    for (uint8_t i = EVENT_SUCCESS; i <= EVENT_ERROR; i++) {
+        if (type == EVENT_SEVERITY_NAMES[i]) event.severity = i;
+    }
+    event.mode = EVENT_MODE_SYSTEM;
+    for (uint8_t i = EVENT_MODE_SYSTEM; i <= EVENT_MODE_MANUAL; i++) {
+        if (mode == EVENT_MODE_NAMES[i]) event.mode = i;
+    }
+
+    event.message = MSG_IMPORTED_EVENT;
+    event.arg = 0;
+    int chamber = message.indexOf("(Chamber ");
+    if (message.startsWith("Activation completed successfully") && chamber != -1) {
+        event.message = MSG_ACTIVATION_COMPLETE;
+        event.arg = message.substring(chamber + 9).toInt();
         return;
     }
-    
-    File f = LittleFS.open(FILE_EVENTS, "r");
-    if (!f) {
-        Serial.println("Failed to open events.log for reading");
+    for (uint8_t i = MSG_INITIAL_START; i < MSG_COUNT; i++) {
+        if (message == EVENT_MESSAGE_TEXT[i]) {
+            event.message = i;
+            return;
+        }
+    }
+}
+
+// Imports the old CSV events.log, if any, then removes it.
+static void migrateLegacyEventLog(File &ring) {
+    if (!LittleFS.exists(FILE_EVENTS_LEGACY)) {
         return;
     }
-    
-    DateTime now = rtc.now();
-    uint32_t currentUnix = now.unixtime();
-    uint32_t cutoffTime = currentUnix - EVENT_RETENTION_SECONDS;
-    
-    std::vector<EventLog> tempEvents;
-    
-    // Read all events
-    while (f.available()) {
+
+    File f = LittleFS.open(FILE_EVENTS_LEGACY, "r");
+    int imported = 0;
+    size_t bytes = 0;
+    while (f && f.available()) {
         String line = f.readStringUntil('\n');
         line.trim();
         
@@ -403,68 +1077,197 @@ void loadEventsFromFile() {
         
         EventLog event;
         event.timestamp = line.substring(0, firstComma).toInt();
-        event.type = line.substring(firstComma + 1, secondComma);
-        event.mode = line.substring(secondComma + 1, thirdComma);
-        event.message = line.substring(thirdComma + 1);
+        parseLegacyEvent(line.substring(firstComma + 1, secondComma),
+                         line.substring(secondComma + 1, thirdComma),
+                         line.substring(thirdComma + 1), event);
+        bytes += writeEventRecord(ring, event);
+        imported++;
+    }
+    if (f) f.close();
+
+    bytes += writeEventLogHeader(ring);
+    countFlashWrite(FLASH_FILE_EVENTS, bytes);
+    LittleFS.remove(FILE_EVENTS_LEGACY);
+    Serial.printf("Migrated %d events from events.log\n", imported);
+}
+
+// Opens events.bin for reading and writing, creating it if it is missing
+// or does not match the current layout.
+static File openEventLog() {
+    File f;
+    if (LittleFS.exists(FILE_EVENTS)) {
+        f = LittleFS.open(FILE_EVENTS, "r+");
+    }
+
+    if (f && !eventLogHeaderValid) {
+        EventLogHeader h;
+        if (f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && eventLogHeaderOk(h, f.size())) {
+            eventLogHeader = h;
+            eventLogHeaderValid = true;
+        } else {
+            Serial.println("events.bin header invalid - recreating event log");
+            f.close();
+        }
+    }
+
+    if (f) {
+        return f;
+    }
+
+    f = LittleFS.open(FILE_EVENTS, "w+");
+    if (!f) {
+        Serial.println("Failed to create events.bin");
+        eventLogHeaderValid = false;
+        return f;
+    }
+
+    eventLogHeader.magic = EVENT_LOG_MAGIC;
+    eventLogHeader.version = EVENT_LOG_VERSION;
+    eventLogHeader.recordSize = sizeof(EventLog);
+    eventLogHeader.capacity = EVENT_LOG_CAPACITY;
+    eventLogHeader.head = 0;
+    eventLogHeader.count = 0;
+    eventLogHeader.sequence = 0;
+    eventLogHeaderValid = true;
+
+    // Pre-allocate every slot so appends never grow the file
+    size_t bytes = writeEventLogHeader(f);
+    EventLog empty;
+    memset(&empty, 0, sizeof(empty));
+    for (uint32_t i = 0; i < EVENT_LOG_CAPACITY; i++) {
+        bytes += f.write((const uint8_t *)&empty, sizeof(empty));
+    }
+    countFlashWrite(FLASH_FILE_EVENTS, bytes);
+    Serial.printf("Created events.bin (%d slots)\n", EVENT_LOG_CAPACITY);
+
+    migrateLegacyEventLog(f);
+    return f;
+}
+
+void saveEventToFile(const EventLog &event) {
+    File f = openEventLog();
+    if (!f) {
+        Serial.println("Failed to open events.bin for writing");
+        return;
+    }
+
+    size_t bytes = writeEventRecord(f, event);
+    bytes += writeEventLogHeader(f);
+    countFlashWrite(FLASH_FILE_EVENTS, bytes);
+    f.close();
+}
+
+void loadEventsFromFile() {
+    extern RTC_DS3231 rtc;
+    eventHistory.clear();
+    
+    File f = openEventLog();
+    if (!f) {
+        Serial.println("Failed to open events.bin for reading");
+        return;
+    }
+    
+    DateTime now = rtc.now();
+    uint32_t currentUnix = now.unixtime();
+    uint32_t cutoffTime = currentUnix - EVENT_RETENTION_SECONDS;
+    
+    // Read the newest records, oldest first
+    uint32_t toRead = std::min<uint32_t>(eventLogHeader.count, MAX_EVENTS_IN_MEMORY);
+    uint32_t slot = (eventLogHeader.head + eventLogHeader.capacity - toRead) % eventLogHeader.capacity;
+    
+    for (uint32_t i = 0; i < toRead; i++) {
+        EventLog event;
+        f.seek(sizeof(EventLogHeader) + slot * sizeof(EventLog));
+        if (f.read((uint8_t *)&event, sizeof(event)) != sizeof(event)) {
+            break;
+        }
+        slot = (slot + 1) % eventLogHeader.capacity;
         
         // Only keep events from last 24 hours
         if (event.timestamp >= cutoffTime) {
-            tempEvents.push_back(event);
+            eventHistory.push(event);
         }
     }
     
     f.close();
     
-    // Rewrite file with only recent events
-    f = LittleFS.open(FILE_EVENTS, "w");
-    if (f) {
-        for (const auto &event : tempEvents) {
-            f.printf("%lu,%s,%s,%s\n", 
-                     event.timestamp, 
-                     event.type.c_str(), 
-                     event.mode.c_str(), 
-                     event.message.c_str());
-            
-            if (eventHistory.size() < MAX_EVENTS_IN_MEMORY) {
-                eventHistory.push_back(event);
-            }
-        }
-        f.close();
-    }
-    
     Serial.printf("Loaded %d events from log file\n", eventHistory.size());
 }
 
-String eventsToJson() {
+size_t readEvents(uint32_t firstId, uint32_t beforeId, size_t limit,
+                  std::function<void(uint32_t id, const EventLog &event)> emit) {
     extern RTC_DS3231 rtc;
-    DateTime now = rtc.now();
-    uint32_t currentUnix = now.unixtime();
-    uint32_t cutoffTime = currentUnix - EVENT_RETENTION_SECONDS;
+    File f = openEventLog();
+    if (!f) {
+        return 0;
+    }
     
-    DynamicJsonDocument doc(JSON_BUFFER_XLARGE);
-    JsonArray arr = doc.to<JsonArray>();
+    uint32_t cutoffTime = rtc.now().unixtime() - EVENT_RETENTION_SECONDS;
+    uint32_t oldestId = eventLogHeader.sequence - eventLogHeader.count;
+    uint32_t id = std::min(beforeId, eventLogHeader.sequence);
+    size_t emitted = 0;
     
-    // Add events from newest to oldest
-    for (int i = eventHistory.size() - 1; i >= 0; i--) {
-        const EventLog &event = eventHistory[i];
+    // Walk from the newest matching id towards older records
+    while (id > oldestId && id > firstId && emitted < limit) {
+        id--;
+        uint32_t back = eventLogHeader.sequence - id;
+        uint32_t slot = (eventLogHeader.head + eventLogHeader.capacity - back) % eventLogHeader.capacity;
         
-        if (event.timestamp >= cutoffTime) {
-            JsonObject o = arr.createNestedObject();
-            o["timestamp"] = event.timestamp;
-            o["type"] = event.type;
-            o["mode"] = event.mode;
-            o["message"] = event.message;
-            
-            DateTime dt(event.timestamp);
-            char timeStr[20];
-            snprintf(timeStr, sizeof(timeStr), "%02d-%02d-%04d %02d:%02d:%02d",
-                     dt.day(), dt.month(), dt.year(),
-                     dt.hour(), dt.minute(), dt.second());
-            o["timeStr"] = timeStr;
+        EventLog event;
+        f.seek(sizeof(EventLogHeader) + slot * sizeof(EventLog));
+        if (f.read((uint8_t *)&event, sizeof(event)) != sizeof(event)) {
+            break;
+        }
+        
+        // Records are in time order, so everything older is out of retention too
+        if (event.timestamp < cutoffTime) {
+            break;
         }
+        
+        emit(id, event);
+        emitted++;
+    }
+    
+    f.close();
+    return emitted;
+}
+
+uint32_t eventLogSequence() {
+    if (!eventLogHeaderValid) {
+        File f = openEventLog();
+        if (f) f.close();
     }
+    return eventLogHeaderValid ? eventLogHeader.sequence : 0;
+}
+
+// Ids keep counting after a clear so client cursors stay valid
+void clearEventLog() {
+    eventHistory.clear();
+    
+    File f = openEventLog();
+    if (!f) {
+        return;
+    }
+    eventLogHeader.head = 0;
+    eventLogHeader.count = 0;
+    countFlashWrite(FLASH_FILE_EVENTS, writeEventLogHeader(f));
+    f.close();
+}
+
+size_t eventToJson(uint32_t id, const EventLog &event, char *out, size_t size) {
+    StaticJsonDocument<JSON_BUFFER_SMALL> doc;
+    doc["id"] = id;
+    doc["timestamp"] = event.timestamp;
+    doc["type"] = eventSeverityName(event.severity);
+    doc["mode"] = eventModeName(event.mode);
+    doc["message"] = eventMessageText(event);
+    
+    DateTime dt(event.timestamp);
+    char timeStr[20];
+    snprintf(timeStr, sizeof(timeStr), "%02d-%02d-%04d %02d:%02d:%02d",
+             dt.day(), dt.month(), dt.year(),
+             dt.hour(), dt.minute(), dt.second());
+    doc["timeStr"] = timeStr;
     
-    String out;
-    serializeJson(arr, out);
-    return out;
+    return serializeJson(doc, out, size);
 }
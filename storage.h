@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include <functional>
 #include "config.h"
 #include "types.h"
 
@@ -11,10 +12,48 @@
 // Storage Functions
 // ========================================
 
+// Write coalescing
+enum StorageRecord : uint8_t {
+    RECORD_ALARMS = 0x01,
+    RECORD_MODE = 0x02,
+    RECORD_SERVO = 0x04
+};
+void markDirty(uint8_t records);
+// retryFailed also writes records whose last write failed; only the flush
+// before sleep passes it
+void flushDirty(bool deferScheduled = false, bool retryFailed = false);
+
+// Flash write accounting. The counters for each file and NVS record are
+// kept in RTC memory and saved to flash_stats.bin along with the next
+// flush of dirty records.
+void countFlashWrite(FlashFile file, size_t bytes);
+const FlashFileStats &flashFileStats(FlashFile file);
+const char *flashFileName(FlashFile file);
+uint32_t flashStatsSinceUnix();     // When the counters were started
+void saveFlashStats();
+
+// Writes a whole file through FILE_TEMP_SUFFIX and a rename, so a power
+// cut leaves either the old or the new file. content prints the file and
+// returns the bytes printed; it is run once to checksum the content and
+// again to write it, and the write is skipped if the file already matches.
+// Returns false if the file could not be written.
+typedef std::function<size_t(Print &out)> FileContent;
+bool writeFileAtomic(FlashFile file, FileContent content);
+bool writeFileAtomic(FlashFile file, const String &content);
+
+// CRC-32 (IEEE); pass 0 to start, or the previous result to continue
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length);
+
+// Config store. Mode, servo position, WiFi and UI settings share one
+// binary NVS record, read once per boot; the alarms are a second record.
+// The first boot without them imports the old JSON files.
+
 // Alarm storage
+bool parseAlarmTime(const char *time, uint16_t &minute);   // "HH:MM" -> minute of day
+size_t alarmToJson(const Alarm &alarm, char *out, size_t size);
+void sortAlarms();
 void saveAlarms();
 void loadAlarms();
-String alarmsToJson();
 
 // Mode configuration storage
 void saveModeConfig();
@@ -28,13 +67,31 @@ void loadCompartmentPosition();
 void loadWiFiSettings();
 void saveWiFiSettings(String ssid);
 
-// Settings storage
-void initSettings();
+// UI settings (time format and theme) as the JSON the web UI uses
+String settingsToJson();
+bool saveSettings(const char *timeFormat, const char *theme);
+
+// Mode, servo, WiFi and settings as stored, one object each, in the
+// layout of the old JSON files (the alarms are streamed separately)
+void configToJson(JsonObject root);
 
 // Event logging
-void logEvent(String type, String mode, String message);
+void logEvent(EventSeverity severity, EventMode mode, EventMessage message, uint8_t arg = 0);
+EventMode currentEventMode();
+const char *eventSeverityName(uint8_t severity);
+const char *eventModeName(uint8_t mode);
+String eventMessageText(const EventLog &event);
 void saveEventToFile(const EventLog &event);
 void loadEventsFromFile();
-String eventsToJson();
+void clearEventLog();
+size_t eventToJson(uint32_t id, const EventLog &event, char *out, size_t size);
+
+// Records ever logged; the newest event's id is one less
+uint32_t eventLogSequence();
+
+// Calls emit for retained events with firstId <= id < beforeId, newest
+// first, stopping after limit events. Returns the number of events emitted.
+size_t readEvents(uint32_t firstId, uint32_t beforeId, size_t limit,
+                  std::function<void(uint32_t id, const EventLog &event)> emit);
 
 #endif // STORAGE_H
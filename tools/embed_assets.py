@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Generates web_assets.h from the web UI in data/.
+
+Each asset becomes a byte array in flash (gzipped unless it is already
+compressed), and WEB_ASSETS is a constexpr route table with the URI,
+content type and a strong ETag for each one. registerRoutes() serves the
+table directly, so the UI needs no LittleFS lookups.
+
+Run this after editing any of the files below; the host Makefile does it
+automatically. Output is deterministic, so unchanged assets keep their ETag
+and the header only changes when an asset does.
+"""
+
+import gzip
+import os
+import sys
+import zlib
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+# (file in data/, URI, content type, gzip)
+ASSETS = [
+    ("index.html", "/", "text/html", True),
+    ("style.css", "/style.css", "text/css", True),
+    ("script.js", "/script.js", "application/javascript", True),
+    ("taronga-zoo-logo.png", "/taronga-zoo-logo.png", "image/png", False),
+]
+
+
+def symbol(name):
+    return "WEB_ASSET_" + "".join(c.upper() if c.isalnum() else "_" for c in name)
+
+
+def byte_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    data_dir = os.path.join(ROOT, "data")
+    out_path = sys.argv[1] if len(sys.argv) > 1 else os.path.join(ROOT, "web_assets.h")
+
+    out = [
+        "// Generated by tools/embed_assets.py from data/ - do not edit.",
+        "",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <Arduino.h>",
+        '#include "types.h"',
+        "",
+    ]
+    routes = []
+    for name, uri, content_type, compress in ASSETS:
+        with open(os.path.join(data_dir, name), "rb") as f:
+            raw = f.read()
+        data = gzip.compress(raw, compresslevel=9, mtime=0) if compress else raw
+        etag = '"%08x-%x"' % (zlib.crc32(data) & 0xFFFFFFFF, len(data))
+
+        out.append("// %s: %d bytes%s" % (name, len(data),
+                   " (%d uncompressed)" % len(raw) if compress else ""))
+        out.append("static const uint8_t %s[] PROGMEM = {" % symbol(name))
+        out.append(byte_array(data))
+        out.append("};")
+        out.append("")
+        routes.append('    {"%s", "%s", "%s", %s, %s, sizeof(%s)},' % (
+            uri, content_type, etag.replace('"', '\\"'),
+            "true" if compress else "false", symbol(name), symbol(name)))
+        print("%-22s %7d -> %6d bytes  %s" % (name, len(raw), len(data), etag))
+
+    out.append("constexpr WebAsset WEB_ASSETS[] = {")
+    out.extend(routes)
+    out.append("};")
+    out.append("")
+    out.append("#endif // WEB_ASSETS_H")
+    out.append("")
+
+    text = "\n".join(out)
+    if os.path.exists(out_path):
+        with open(out_path) as f:
+            if f.read() == text:
+                return
+    with open(out_path, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()
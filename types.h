@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <mutex>
+#include "config.h"
 
 // ========================================
 // Data Structures
@@ -10,7 +12,8 @@
 
 struct Alarm {
     uint32_t id;
-    String time;   // "HH:MM"
+    uint16_t minute;   // Minute of day, 0-1439 ("HH:MM" in JSON)
+    uint8_t days;      // Weekday mask, bit 0 = Sunday
     bool active;
 };
 
@@ -25,22 +28,245 @@ struct ModeConfig {
     // Random interval config
     int randIntervalHours;
     int randIntervalMinutes;
-    uint32_t randIntervalBlockStartUnix;  // Unix timestamp when next random time should be calculated
-    uint32_t randIntervalNextTriggerUnix; // Unix timestamp (AEST) when to trigger
+    uint32_t randIntervalBlockStartUnix;  // Unix timestamp (AEST) the current plan's first block starts
+    uint32_t randPlanSeed;                // Seed the current plan was drawn from (0 = none yet)
+    uint32_t randPlanAnchorUnix;          // Last trigger before the plan, for the minimum gap (0 = none)
+    int randMinGapMinutes;                // Least time between two random feeds
+    int randQuietStartMinute;             // No random feeds from this minute of the day...
+    int randQuietEndMinute;               // ...until this one; equal to the start for none
 };
 
+enum EventSeverity : uint8_t {
+    EVENT_SUCCESS,
+    EVENT_WARNING,
+    EVENT_ERROR
+};
+
+enum EventMode : uint8_t {
+    EVENT_MODE_SYSTEM,
+    EVENT_MODE_SET_TIMES,
+    EVENT_MODE_REGULAR_INTERVAL,
+    EVENT_MODE_RANDOM_INTERVAL,
+    EVENT_MODE_MANUAL
+};
+
+// Message codes; the text for each lives in storage.cpp and is only
+// rendered when an event is printed or served
+enum EventMessage : uint8_t {
+    MSG_IMPORTED_EVENT,
+    MSG_INITIAL_START,
+    MSG_WOKE_FROM_SLEEP,
+    MSG_ACTIVATION_COMPLETE,        // arg: chamber number
+    MSG_FS_NOT_ACCESSIBLE,
+    MSG_RTC_COMM_ERROR,
+    MSG_RTC_LOST_POWER,
+    MSG_SERVO_POWER_FAILED,
+    MSG_FS_STARTUP_ERROR,
+    MSG_RTC_STARTUP_ERROR,
+    MSG_INA219_NOT_FOUND,
+    MSG_ALARMS_WRITE_FAILED,
+    MSG_ALARMS_READ_FAILED,
+    MSG_SERVO_WRITE_FAILED,
+    MSG_SERVO_FILE_MISSING,
+    MSG_SERVO_READ_FAILED,
+    MSG_WIFI_OPEN_FAILED,
+    MSG_WIFI_PARSE_FAILED,
+    MSG_WIFI_WRITE_FAILED,
+    MSG_ALARM_REQUEST_INVALID,
+    MSG_SETTINGS_WRITE_FAILED,
+    MSG_SYNC_TIME_INVALID,
+    MSG_WIFI_REQUEST_INVALID,
+    MSG_SERVO_STALLED,              // arg: chamber number
+    MSG_SERVO_NO_CURRENT,           // arg: chamber number
+    MSG_CONFIG_INVALID,
+    MSG_MODE_REQUEST_INVALID,
+    MSG_INTERVAL_INVALID,
+    MSG_COUNT
+};
+
+// Packed event, 8 bytes in memory and in events.bin
 struct EventLog {
     uint32_t timestamp;      // Unix timestamp (AEST)
-    String type;            // "SUCCESS" or "ERROR"
-    String mode;            // "set_times", "regular_interval", "random_interval"
-    String message;         // Description of event
+    uint8_t severity;        // EventSeverity
+    uint8_t mode;            // EventMode
+    uint8_t message;         // EventMessage
+    uint8_t arg;             // Small message argument
+};
+
+// Fixed-capacity ring of the most recent events; index 0 is the oldest
+struct EventHistory {
+    EventLog events[MAX_EVENTS_IN_MEMORY];
+    uint16_t head;
+    uint16_t count;
+
+    void clear() { head = 0; count = 0; }
+    size_t size() const { return count; }
+
+    void push(const EventLog &event) {
+        events[head] = event;
+        head = (head + 1) % MAX_EVENTS_IN_MEMORY;
+        if (count < MAX_EVENTS_IN_MEMORY) count++;
+    }
+
+    const EventLog &at(size_t i) const {
+        return events[(head + MAX_EVENTS_IN_MEMORY - count + i) % MAX_EVENTS_IN_MEMORY];
+    }
+};
+
+// Milliseconds since app start at each milestone of an RTC alarm wake
+struct ScheduledWakeTiming {
+    uint32_t timestamp;          // Unix timestamp (AEST) of the wake
+    uint32_t wakeToDispenseMs;
+    uint32_t wakeToSleepMs;
+};
+
+enum CaptureResult : uint8_t {
+    CAPTURE_NONE,         // No capture (no current sensor)
+    CAPTURE_OK,
+    CAPTURE_STALLED,      // Still drawing drive current when the move should be over
+    CAPTURE_NO_CURRENT    // Never drew drive current, so nothing moved
+};
+
+enum MotionKind : uint8_t {
+    MOTION_DISPENSE,      // Advance one chamber
+    MOTION_HOME           // Return to deadspace
+};
+
+enum JobState : uint8_t {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE
+};
+
+// A servo move queued with the motion engine
+struct MotionJob {
+    uint32_t id;
+    uint8_t kind;            // MotionKind
+    uint8_t state;           // JobState
+    bool manual;             // Requested from the portal
+    uint8_t chamber;         // Chamber dispensed (1-based), once done
+    uint8_t result;          // CaptureResult of the dispensing move, once done
+    uint32_t durationMs;     // Start to rest, once done
+};
+
+// Features of the supply current trace of the last dispensing move
+struct DispenseCapture {
+    uint32_t timestamp;      // Unix timestamp (AEST) of the dispense
+    uint8_t chamber;
+    uint8_t result;          // CaptureResult
+    uint16_t samples;
+    uint16_t durationMs;     // Length of the capture window
+    uint16_t activeMs;       // First to last sample above CAPTURE_MOVING_MA
+    uint16_t peakMa;
+    uint16_t meanMa;
+    float energyMj;          // Supply energy over the window
+};
+
+// Flash writes made by the firmware during one wake
+struct FlashWriteStats {
+    uint32_t filesWritten;
+    uint32_t bytesWritten;
+};
+
+// Files and NVS records whose writes are counted, for the flash endurance figures
+enum FlashFile : uint8_t {
+    FLASH_FILE_CONFIG,       // NVS config record
+    FLASH_FILE_ALARMS,       // NVS alarm table
+    FLASH_FILE_EVENTS,
+    FLASH_FILE_STATS,
+    FLASH_FILE_COUNT
+};
+
+// Lifetime writes to one file
+struct FlashFileStats {
+    uint32_t writes;
+    uint32_t bytesWritten;
+    uint32_t skipped;        // Saves left out because flash already held the content
+};
+
+// Latest battery reading, refreshed in the background by sampleBattery()
+struct BatteryReading {
+    bool valid;            // Set once the first sample has been taken
+    float busVoltage;      // Last raw bus voltage (V)
+    float currentMa;       // Last load current (mA)
+    float restVoltage;     // Load-compensated, EWMA-filtered voltage (V)
+    int percent;           // State of charge from restVoltage
+    uint32_t sampledAt;    // millis() of the last sample
+};
+
+// Startup phases timed by the boot profiler
+enum BootPhase : uint8_t {
+    BOOT_PHASE_FS,             // LittleFS.begin
+    BOOT_PHASE_RTC,            // rtc.begin and clearing the alarms
+    BOOT_PHASE_INA219,         // ina219.begin and the first battery check
+    BOOT_PHASE_STATE,          // Mode, alarms and servo position
+    BOOT_PHASE_WIFI_SETTINGS,  // SSID from the config record
+    BOOT_PHASE_EVENTS,         // Event log load
+    BOOT_PHASE_PORTAL,         // Soft AP, DNS, routes and web server
+    BOOT_PHASE_DISPENSE,       // Scheduled wake: the move
+    BOOT_PHASE_SCHEDULE,       // Scheduled wake: advancing the mode and arming the next alarm
+    BOOT_PHASE_SLEEP_PREP,     // RTC snapshot and flash flush before deep sleep
+    BOOT_PHASE_COUNT
+};
+
+enum BootKind : uint8_t {
+    BOOT_KIND_RESET,           // Power-on, reset or anything but the two wake sources
+    BOOT_KIND_BUTTON,
+    BOOT_KIND_ALARM,
+    BOOT_KIND_COUNT
+};
+
+// Microseconds since app start; a phase that did not run has durationUs 0
+struct BootPhaseTiming {
+    uint32_t startUs;
+    uint32_t durationUs;
+};
+
+struct BootProfile {
+    uint32_t timestamp;        // Unix timestamp (AEST) of the boot
+    uint32_t totalUs;          // App start to the end of setup() or deep sleep
+    BootPhaseTiming phases[BOOT_PHASE_COUNT];
+};
+
+// Measured per-phase energy costs, kept across deep sleep. A zero cost
+// has not been measured yet and the model uses its config.h estimate.
+struct EnergyCosts {
+    float dispenseMj;      // One carousel move, from the current capture
+    float wakeMj;          // A scheduled wake apart from the move
+    float apMinuteMj;      // One minute of the configuration portal
+};
+
+// Battery life left at a schedule
+struct EnergyProjection {
+    float feedsPerDay;
+    float dailyMj;         // Sleep, scheduled wakes and portal use per day
+    float remainingMj;     // Charge left, from the battery percentage
+    float daysLeft;
+    uint32_t feedsLeft;    // Feeds the remaining charge can power at this schedule
+};
+
+// Ways to wait for the next trigger after a scheduled dispense
+enum SleepChoice : uint8_t {
+    SLEEP_STAY_AWAKE,          // Poll the RTC until the trigger is due
+    SLEEP_LIGHT,               // Light sleep; RAM is kept, so no boot on wake
+    SLEEP_DEEP                 // Deep sleep; the RTC alarm cold-boots the feeder
+};
+
+// Web UI asset compiled into flash by tools/embed_assets.py
+struct WebAsset {
+    const char *uri;
+    const char *contentType;
+    const char *etag;
+    bool gzip;               // data is gzip-compressed
+    const uint8_t *data;
+    size_t length;
 };
 
 // ========================================
 // Global Variables (extern declarations)
 // ========================================
 
-extern std::vector<EventLog> eventHistory;
+extern EventHistory eventHistory;
 extern std::vector<Alarm> alarms;
 extern ModeConfig modeConfig;
 
@@ -52,4 +278,16 @@ extern bool apModeActive;
 
 extern String currentSSID;
 
+// Web handlers run on the async_tcp task; shared state is only touched
+// while holding stateMutex
+extern std::recursive_mutex stateMutex;
+extern volatile bool sleepRequested;
+
+extern ScheduledWakeTiming scheduledWakeTiming;
+extern FlashWriteStats flashWrites;
+extern FlashWriteStats lastWakeFlashWrites;
+extern BatteryReading batteryReading;
+extern DispenseCapture lastDispenseCapture;
+extern EnergyCosts energyCosts;
+
 #endif // TYPES_H
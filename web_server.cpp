@@ -2,32 +2,300 @@
 #include "storage.h"
 #include "servo_control.h"
 #include "alarm_manager.h"
+#include "scheduler.h"
 #include "power_management.h"
+#include "energy_model.h"
+#include "boot_profile.h"
+#include "random_plan.h"
+#include "web_assets.h"
 #include <algorithm>
+#include <memory>
 
 // ========================================
-// CORS Headers
+// Request Helpers
 // ========================================
+// Handlers run on the async_tcp task, alongside loop(). Every route holds
+// stateMutex while it runs, so the alarms, mode, servo and I2C devices are
+// never touched from both sides at once. Work that blocks for seconds (a
+// dispense, going to sleep) is handed to loop() instead.
 
-void setCORSHeaders() {
-    server.sendHeader("Access-Control-Allow-Origin", "*");
-    server.sendHeader("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, PATCH, OPTIONS");
-    server.sendHeader("Access-Control-Allow-Headers", "Content-Type");
+typedef std::function<void(AsyncWebServerRequest *request)> RouteHandler;
+
+// Gathers a request body into request->_tempObject (freed with the request)
+static void collectBody(AsyncWebServerRequest *request, uint8_t *data, size_t len,
+                        size_t index, size_t total) {
+    if (total > HTTP_MAX_BODY) return;
+    if (index == 0) {
+        request->_tempObject = malloc(total + 1);
+        if (!request->_tempObject) return;
+        ((char *)request->_tempObject)[total] = '\0';
+    }
+    if (request->_tempObject) {
+        memcpy((uint8_t *)request->_tempObject + index, data, len);
+    }
+}
+
+static String requestBody(AsyncWebServerRequest *request) {
+    return request->_tempObject ? String((const char *)request->_tempObject) : String();
+}
+
+static void route(const char *uri, WebRequestMethodComposite method, RouteHandler handler) {
+    server.on(uri, method, [handler](AsyncWebServerRequest *request) {
+        std::lock_guard<std::recursive_mutex> lock(stateMutex);
+        handler(request);
+    }, nullptr, collectBody);
+}
+
+static void redirectToPortal(AsyncWebServerRequest *request) {
+    request->redirect("http://" + WiFi.softAPIP().toString());
 }
 
 // ========================================
-// Static File Serving
+// Streamed JSON Arrays
+// ========================================
+// Long lists go out as a chunked response. The filler runs each time the
+// connection can take more data, so the array is never held in full.
+// open and close wrap the elements, for an array that ends a larger object.
+
+struct JsonArrayStream {
+    String pending;
+    size_t count = 0;
+    bool done = false;
+
+    void add(const char *json) {
+        if (count++ > 0) pending += ",";
+        pending += json;
+    }
+};
+
+// fill() adds the next few elements; adding none ends the array
+typedef std::function<void(JsonArrayStream &stream)> JsonArrayFiller;
+
+static void sendJsonArray(AsyncWebServerRequest *request, JsonArrayFiller fill,
+                          const String &open = "[", const char *close = "]") {
+    auto stream = std::make_shared<JsonArrayStream>();
+    stream->pending = open;
+    request->send(request->beginChunkedResponse("application/json",
+        [stream, fill, close](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            std::lock_guard<std::recursive_mutex> lock(stateMutex);
+            while (!stream->done && stream->pending.length() < maxLen) {
+                size_t before = stream->count;
+                fill(*stream);
+                if (stream->count == before) {
+                    stream->pending += close;
+                    stream->done = true;
+                }
+            }
+            size_t n = std::min(maxLen, (size_t)stream->pending.length());
+            memcpy(buffer, stream->pending.c_str(), n);
+            stream->pending.remove(0, n);
+            return n;
+        }));
+}
+
+void sendAlarms(AsyncWebServerRequest *request) {
+    auto next = std::make_shared<size_t>(0);
+    sendJsonArray(request, [next](JsonArrayStream &stream) {
+        char alarmJson[JSON_BUFFER_SMALL];
+        for (int i = 0; i < 8 && *next < alarms.size(); i++, (*next)++) {
+            alarmToJson(alarms[*next], alarmJson, sizeof(alarmJson));
+            stream.add(alarmJson);
+        }
+    });
+}
+
 // ========================================
+// Web UI Assets
+// ========================================
+
+// Serves an asset from the generated table straight out of flash. Gzipped
+// assets are sent as-is; every browser the keepers use accepts gzip.
+// A matching If-None-Match gets a bodyless 304.
+void serveAsset(AsyncWebServerRequest *request, const WebAsset &asset) {
+    AsyncWebServerResponse *response;
+    AsyncWebHeader *ifNoneMatch = request->getHeader("If-None-Match");
+    if (ifNoneMatch && ifNoneMatch->value() == asset.etag) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse_P(200, asset.contentType, asset.data, asset.length);
+        if (asset.gzip) response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", ASSET_CACHE_CONTROL);
+    request->send(response);
+}
+
+// ========================================
+// Status Snapshot and Stream
+// ========================================
+// /api/status returns everything the portal header shows in one reply.
+// /api/stream pushes the same snapshot as a "status" event only when one of
+// its fields changes, plus an "event" message for each new log entry, so an
+// open page never polls.
+
+struct StatusKey {
+    uint32_t minute;
+    uint32_t nextUnix;
+    ScheduleMode mode;
+    int compartment;
+    int battery;
+
+    bool operator==(const StatusKey &o) const {
+        return minute == o.minute && nextUnix == o.nextUnix && mode == o.mode &&
+               compartment == o.compartment && battery == o.battery;
+    }
+};
+
+static StatusKey lastStatusKey;
+static uint32_t lastStatusUnix = 0;
+static unsigned long lastStatusMillis = 0;
+
+// Human-readable form of the scheduler's cached next trigger
+static String describeNextActivation(uint32_t currentUnix) {
+    uint32_t nextUnix = nextFireUnix();
+    String nextTime = "";
+
+    if (activeScheduleMode() == SCHEDULE_SET_TIMES) {
+        if (nextUnix != 0) {
+            DateTime next(nextUnix);
+            char timeStr[6];
+            snprintf(timeStr, sizeof(timeStr), "%02d:%02d", next.hour(), next.minute());
+            nextTime = timeStr;
+            static const char *dayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+            uint32_t daysAhead = nextUnix / 86400UL - currentUnix / 86400UL;
+            if (daysAhead == 1) nextTime += " (tomorrow)";
+            else if (daysAhead > 1) nextTime += String(" (") + dayNames[next.dayOfTheWeek()] + ")";
+        }
+    }
+    else if (nextUnix != 0) {
+        if (currentUnix >= nextUnix) {
+            nextTime = "Overdue";
+        } else {
+            uint32_t remaining = nextUnix - currentUnix;
+            int remainingHours = remaining / 3600;
+            int remainingMinutes = (remaining % 3600) / 60;
+            nextTime = String(remainingHours) + "h " + String(remainingMinutes) + "m";
+            if (activeScheduleMode() == SCHEDULE_RANDOM_INTERVAL) nextTime += " (random)";
+        }
+    }
+    else if (activeScheduleMode() != SCHEDULE_NONE) {
+        nextTime = "Not started";
+    }
+    return nextTime;
+}
+
+static StatusKey currentStatusKey(uint32_t currentUnix) {
+    return {currentUnix / 60, nextFireUnix(), activeScheduleMode(), compartment, batteryReading.percent};
+}
+
+static size_t statusToJson(uint32_t currentUnix, char *out, size_t size) {
+    StaticJsonDocument<JSON_BUFFER_MEDIUM> doc;
+    DateTime now(currentUnix);
+    char dateStr[12];
+    snprintf(dateStr, sizeof(dateStr), "%d-%d-%d", now.year(), now.month(), now.day());
 
-void serveStaticFile(String path, String type) {
-    setCORSHeaders();
-    File f = LittleFS.open(path, "r");
-    if (!f) {
-        server.send(404, "text/plain", "File not found");
+    doc["unix"] = currentUnix;
+    doc["hour"] = now.hour();
+    doc["minute"] = now.minute();
+    doc["second"] = now.second();
+    doc["date"] = dateStr;
+    doc["activeMode"] = modeConfig.activeMode;
+    doc["nextActivationUnix"] = nextFireUnix();
+    doc["nextActivationTime"] = describeNextActivation(currentUnix);
+    doc["battery"] = batteryReading.percent;
+    doc["compartment"] = compartment;
+    doc["maxCompartment"] = maxCompartment;
+    doc["lastEventId"] = (long)eventLogSequence() - 1;
+
+    return serializeJson(doc, out, size);
+}
+
+static size_t motionJobToJson(const MotionJob &job, char *out, size_t size) {
+    static const char *states[] = {"queued", "running", "done"};
+    StaticJsonDocument<JSON_BUFFER_SMALL> doc;
+    doc["id"] = job.id;
+    doc["kind"] = job.kind == MOTION_HOME ? "home" : "dispense";
+    doc["state"] = states[job.state <= JOB_DONE ? job.state : JOB_DONE];
+    if (job.state == JOB_DONE) {
+        doc["durationMs"] = job.durationMs;
+        if (job.kind == MOTION_DISPENSE) {
+            doc["chamber"] = job.chamber;
+            doc["result"] = captureResultName(job.result);
+        }
+    }
+    return serializeJson(doc, out, size);
+}
+
+// Sends a snapshot to one new client, or to every client when client is null
+static void sendStatus(AsyncEventSourceClient *client) {
+    uint32_t currentUnix = rtc.now().unixtime();
+    char json[JSON_BUFFER_MEDIUM];
+    statusToJson(currentUnix, json, sizeof(json));
+
+    if (client) client->send(json, "status", 0, STATUS_RECONNECT_MS);
+    else statusEvents.send(json, "status");
+
+    lastStatusKey = currentStatusKey(currentUnix);
+    lastStatusUnix = currentUnix;
+    lastStatusMillis = millis();
+}
+
+// Called from loop() with stateMutex held
+void publishStatus() {
+    static unsigned long lastCheck = 0;
+    static uint32_t lastEventSequence = eventLogSequence();
+    static uint32_t lastJobId = lastFinishedJobId();
+
+    unsigned long now = millis();
+    if (now - lastCheck < STATUS_CHECK_INTERVAL) {
+        return;
+    }
+    lastCheck = now;
+
+    // With nobody listening, only keep the event cursor current
+    uint32_t sequence = eventLogSequence();
+    uint32_t finishedJob = lastFinishedJobId();
+    if (statusEvents.count() == 0) {
+        lastEventSequence = sequence;
+        lastJobId = finishedJob;
         return;
     }
-    server.streamFile(f, type);
-    f.close();
+
+    // Moves that have come to rest since the last check
+    char jobJson[JSON_BUFFER_SMALL];
+    for (uint32_t id = lastJobId + 1; id <= finishedJob; id++) {
+        MotionJob job;
+        if (findMotionJob(id, job) && job.state == JOB_DONE) {
+            motionJobToJson(job, jobJson, sizeof(jobJson));
+            statusEvents.send(jobJson, "job");
+        }
+    }
+    lastJobId = finishedJob;
+
+    // New log entries, oldest first. A burst bigger than one push leaves a
+    // gap in the ids, which makes the page fetch its history instead
+    if (sequence != lastEventSequence) {
+        std::vector<std::pair<uint32_t, EventLog>> fresh;
+        readEvents(lastEventSequence, UINT32_MAX, STATUS_MAX_EVENTS_PER_PUSH,
+                   [&](uint32_t id, const EventLog &event) {
+            fresh.push_back(std::make_pair(id, event));
+        });
+        char eventJson[JSON_BUFFER_MEDIUM];
+        for (auto it = fresh.rbegin(); it != fresh.rend(); ++it) {
+            eventToJson(it->first, it->second, eventJson, sizeof(eventJson));
+            statusEvents.send(eventJson, "event");
+        }
+        lastEventSequence = sequence;
+    }
+
+    // A snapshot when a field changes or the RTC was set; the page ticks
+    // its clock between snapshots
+    uint32_t currentUnix = rtc.now().unixtime();
+    uint32_t expectedUnix = lastStatusUnix + (now - lastStatusMillis) / 1000;
+    bool clockJumped = currentUnix + 2 < expectedUnix || currentUnix > expectedUnix + 2;
+    if (clockJumped || !(currentStatusKey(currentUnix) == lastStatusKey)) {
+        sendStatus(nullptr);
+    }
 }
 
 // ========================================
@@ -49,127 +317,250 @@ void setupCaptivePortal() {
 // ========================================
 
 void registerRoutes() {
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, PATCH, OPTIONS");
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Content-Type");
 
     // Captive Portal Detection
-    server.on("/generate_204", HTTP_GET, []() {
-        setCORSHeaders();
-        server.sendHeader("Location", "http://" + WiFi.softAPIP().toString());
-        server.send(302, "text/plain", "");
+    route("/generate_204", HTTP_GET, [](AsyncWebServerRequest *request) {
+        redirectToPortal(request);
     });
 
-    server.on("/gen_204", HTTP_GET, []() {
-        setCORSHeaders();
-        server.sendHeader("Location", "http://" + WiFi.softAPIP().toString());
-        server.send(302, "text/plain", "");
+    route("/gen_204", HTTP_GET, [](AsyncWebServerRequest *request) {
+        redirectToPortal(request);
     });
 
-    server.on("/ncsi.txt", HTTP_GET, []() {
-        setCORSHeaders();
-        server.sendHeader("Location", "http://" + WiFi.softAPIP().toString());
-        server.send(302, "text/plain", "");
+    route("/ncsi.txt", HTTP_GET, [](AsyncWebServerRequest *request) {
+        redirectToPortal(request);
     });
 
-    server.on("/connecttest.txt", HTTP_GET, []() {
-        setCORSHeaders();
-        server.sendHeader("Location", "http://" + WiFi.softAPIP().toString());
-        server.send(302, "text/plain", "");
+    route("/connecttest.txt", HTTP_GET, [](AsyncWebServerRequest *request) {
+        redirectToPortal(request);
     });
 
-    server.on("/hotspot-detect.html", HTTP_GET, []() {
-        setCORSHeaders();
-        server.sendHeader("Location", "http://" + WiFi.softAPIP().toString());
-        server.send(302, "text/plain", "");
+    route("/hotspot-detect.html", HTTP_GET, [](AsyncWebServerRequest *request) {
+        redirectToPortal(request);
     });
 
-    // Root = index.html
-    server.on("/", HTTP_GET, []() {
-        serveStaticFile("/index.html", "text/html");
-    });
+    // Web UI, compiled in from data/
+    for (const WebAsset &asset : WEB_ASSETS) {
+        server.on(asset.uri, HTTP_GET, [&asset](AsyncWebServerRequest *request) {
+            serveAsset(request, asset);
+        });
+    }
 
-    // Static assets
-    server.on("/style.css", HTTP_GET, []() { 
-        serveStaticFile("/style.css", "text/css"); 
+    // Status stream; each new client starts with a full snapshot
+    statusEvents.onConnect([](AsyncEventSourceClient *client) {
+        std::lock_guard<std::recursive_mutex> lock(stateMutex);
+        Serial.println("Status stream client connected");
+        sendStatus(client);
     });
-    
-    server.on("/script.js", HTTP_GET, []() { 
-        serveStaticFile("/script.js", "application/javascript"); 
+    server.addHandler(&statusEvents);
+
+    // GET combined status snapshot
+    route("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+        char json[JSON_BUFFER_MEDIUM];
+        statusToJson(rtc.now().unixtime(), json, sizeof(json));
+        request->send(200, "application/json", json);
     });
 
-    server.on("/taronga-zoo-logo.png", HTTP_GET, []() {
-        serveStaticFile("/taronga-zoo-logo.png", "image/png");
+    route("/api/status", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
     // GET current servo position
-    server.on("/api/servo", HTTP_GET, []() {
-        setCORSHeaders();
-        
+    route("/api/servo", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(JSON_BUFFER_SMALL);
         doc["compartment"] = compartment;
         doc["angle"] = compartment * SERVO_ANGLE_STEP;
         doc["maxCompartment"] = maxCompartment;
+        doc["powered"] = servoPowered();
         
         String json;
         serializeJson(doc, json);
-        server.send(200, "application/json", json);
+        request->send(200, "application/json", json);
     });
 
-    // GET current battery charge
-    server.on("/api/battery", HTTP_GET, []() {
-        setCORSHeaders();
+    // GET current battery charge, as last sampled by loop()
+    route("/api/battery", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(JSON_BUFFER_SMALL);
+        doc["battery"] = batteryReading.percent;
+        doc["voltage"] = batteryReading.restVoltage;
+        doc["busVoltage"] = batteryReading.busVoltage;
+        doc["currentMa"] = batteryReading.currentMa;
+        doc["ageMs"] = batteryReading.valid ? millis() - batteryReading.sampledAt : 0;
 
-        int batteryPercent = runBatteryCheck();
+        String json;
+        serializeJson(doc, json);
+        request->send(200, "application/json", json);
+    });
 
-        DynamicJsonDocument doc(JSON_BUFFER_SMALL);
-        doc["battery"] = batteryPercent;
+    route("/api/battery", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
+    });
+
+    // GET battery life projected from the active schedule, or from a
+    // proposed one (mode, hours and minutes) before it is saved
+    route("/api/energy", HTTP_GET, [](AsyncWebServerRequest *request) {
+        String mode = request->hasParam("mode") ? request->getParam("mode")->value() : modeConfig.activeMode;
+        float apMinutes = request->hasParam("apMinutes") ?
+                          request->getParam("apMinutes")->value().toFloat() : ENERGY_AP_MINUTES_PER_DAY;
+
+        ScheduleMode scheduleMode = scheduleModeFromString(mode);
+        float feedsPerDay;
+        if ((scheduleMode == SCHEDULE_REGULAR_INTERVAL || scheduleMode == SCHEDULE_RANDOM_INTERVAL) &&
+            (request->hasParam("hours") || request->hasParam("minutes"))) {
+            uint32_t hours = request->hasParam("hours") ? request->getParam("hours")->value().toInt() : 0;
+            uint32_t minutes = request->hasParam("minutes") ? request->getParam("minutes")->value().toInt() : 0;
+            feedsPerDay = intervalFeedsPerDay(hours * 3600UL + minutes * 60UL);
+        } else {
+            feedsPerDay = scheduleFeedsPerDay(scheduleMode);
+        }
+        EnergyProjection projection = projectEnergy(feedsPerDay, apMinutes);
+
+        DynamicJsonDocument doc(JSON_BUFFER_MEDIUM);
+        doc["mode"] = mode;
+        doc["feedsPerDay"] = projection.feedsPerDay;
+        doc["apMinutesPerDay"] = apMinutes;
+        doc["battery"] = batteryReading.valid ? batteryReading.percent : 100;
+        doc["remainingJ"] = projection.remainingMj / 1000.0f;
+        doc["dailyJ"] = projection.dailyMj / 1000.0f;
+        doc["daysLeft"] = projection.daysLeft;
+        doc["feedsLeft"] = projection.feedsLeft;
+
+        JsonObject costs = doc.createNestedObject("costs");
+        costs["sleepJPerDay"] = sleepCostMjPerDay() / 1000.0f;
+        costs["wakeMj"] = wakeCostMj();
+        costs["wakeMeasured"] = energyCosts.wakeMj > 0;
+        costs["dispenseMj"] = dispenseCostMj();
+        costs["dispenseMeasured"] = energyCosts.dispenseMj > 0;
+        costs["apMinuteMj"] = apMinuteCostMj();
+        costs["apMinuteMeasured"] = energyCosts.apMinuteMj > 0;
 
         String json;
         serializeJson(doc, json);
-        server.send(200, "application/json", json);
+        request->send(200, "application/json", json);
     });
 
-    server.on("/api/battery", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    // GET stored boot profiles, newest first for each wake reason.
+    // Registered before /api/diagnostics, which would otherwise also match it
+    route("/api/diagnostics/boots", HTTP_GET, [](AsyncWebServerRequest *request) {
+        auto kind = std::make_shared<uint8_t>(0);
+        auto next = std::make_shared<uint8_t>(0);
+        sendJsonArray(request, [kind, next](JsonArrayStream &stream) {
+            const BootProfile *profile = nullptr;
+            while (*kind < BOOT_KIND_COUNT && !(profile = storedBootProfile(*kind, *next))) {
+                (*kind)++;
+                *next = 0;
+            }
+            if (!profile) return;
+
+            DynamicJsonDocument doc(JSON_BUFFER_LARGE);
+            doc["wake"] = bootKindName(*kind);
+            doc["timestamp"] = profile->timestamp;
+            doc["totalUs"] = profile->totalUs;
+            JsonObject phases = doc.createNestedObject("phases");
+            for (uint8_t phase = 0; phase < BOOT_PHASE_COUNT; phase++) {
+                const BootPhaseTiming &timing = profile->phases[phase];
+                if (timing.durationUs == 0) continue;
+                JsonObject entry = phases.createNestedObject(bootPhaseName(phase));
+                entry["startUs"] = timing.startUs;
+                entry["durationUs"] = timing.durationUs;
+            }
+            (*next)++;
+
+            String json;
+            serializeJson(doc, json);
+            stream.add(json.c_str());
+        });
     });
 
-    // GET event history
-    server.on("/api/events", HTTP_GET, []() {
-        setCORSHeaders();
-        
-        loadEventsFromFile();
-        
-        String json = eventsToJson();
-        Serial.println("GET /api/events -> " + String(eventHistory.size()) + " events");
-        server.send(200, "application/json", json);
+    // GET current trace (mA) of the last move since boot. Registered
+    // before /api/diagnostics, which would otherwise also match it
+    route("/api/diagnostics/capture", HTTP_GET, [](AsyncWebServerRequest *request) {
+        auto next = std::make_shared<uint16_t>(0);
+        sendJsonArray(request, [next](JsonArrayStream &stream) {
+            uint16_t count;
+            const int16_t *trace = dispenseCaptureTrace(count);
+            char sample[8];
+            for (int i = 0; i < 64 && *next < count; i++, (*next)++) {
+                snprintf(sample, sizeof(sample), "%d", trace[*next]);
+                stream.add(sample);
+            }
+        });
     });
 
-    server.on("/api/events", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    // GET lifetime flash writes per file, with the write rate since the
+    // counters started. Registered before /api/diagnostics
+    route("/api/diagnostics/flash", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(JSON_BUFFER_LARGE);
+        uint32_t since = flashStatsSinceUnix();
+        uint32_t now = rtc.now().unixtime();
+        float days = now > since ? (now - since) / 86400.0f : 0;
+        doc["sinceUnix"] = since;
+        doc["days"] = days;
+
+        uint32_t totalBytes = 0;
+        JsonArray files = doc.createNestedArray("files");
+        for (uint8_t i = 0; i < FLASH_FILE_COUNT; i++) {
+            const FlashFileStats &stats = flashFileStats((FlashFile)i);
+            JsonObject entry = files.createNestedObject();
+            entry["file"] = flashFileName((FlashFile)i);
+            entry["writes"] = stats.writes;
+            entry["bytesWritten"] = stats.bytesWritten;
+            entry["skipped"] = stats.skipped;
+            totalBytes += stats.bytesWritten;
+        }
+        doc["bytesWritten"] = totalBytes;
+        // Less than a day of history would overstate the rate
+        doc["bytesPerDay"] = days >= 1 ? totalBytes / days : 0;
+
+        String json;
+        serializeJson(doc, json);
+        request->send(200, "application/json", json);
     });
-    
-    // DELETE all events
-    server.on("/api/events", HTTP_DELETE, []() {
-        setCORSHeaders();
-        
-        eventHistory.clear();
-        LittleFS.remove(FILE_EVENTS);
-        
-        Serial.println("Event history cleared");
-        server.send(200, "application/json", "{\"status\":\"ok\"}");
+
+    // GET timing of the last scheduled (RTC alarm) dispense
+    route("/api/diagnostics", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(JSON_BUFFER_MEDIUM);
+        JsonObject wake = doc.createNestedObject("lastScheduledWake");
+        wake["timestamp"] = scheduledWakeTiming.timestamp;
+        wake["wakeToDispenseMs"] = scheduledWakeTiming.wakeToDispenseMs;
+        wake["wakeToSleepMs"] = scheduledWakeTiming.wakeToSleepMs;
+
+        JsonObject writes = doc.createNestedObject("flashWrites");
+        writes["filesThisWake"] = flashWrites.filesWritten;
+        writes["bytesThisWake"] = flashWrites.bytesWritten;
+        writes["filesLastWake"] = lastWakeFlashWrites.filesWritten;
+        writes["bytesLastWake"] = lastWakeFlashWrites.bytesWritten;
+
+        JsonObject dispense = doc.createNestedObject("lastDispense");
+        dispense["timestamp"] = lastDispenseCapture.timestamp;
+        dispense["chamber"] = lastDispenseCapture.chamber;
+        dispense["result"] = captureResultName(lastDispenseCapture.result);
+        dispense["samples"] = lastDispenseCapture.samples;
+        dispense["durationMs"] = lastDispenseCapture.durationMs;
+        dispense["drivingMs"] = lastDispenseCapture.activeMs;
+        dispense["peakMa"] = lastDispenseCapture.peakMa;
+        dispense["meanMa"] = lastDispenseCapture.meanMa;
+        dispense["energyMj"] = lastDispenseCapture.energyMj;
+
+        String json;
+        serializeJson(doc, json);
+        request->send(200, "application/json", json);
     });
-    
-    // GET event statistics
-    server.on("/api/events/stats", HTTP_GET, []() {
-        setCORSHeaders();
-        
+
+    // GET event statistics. Registered before /api/events, which would
+    // otherwise also match /api/events/stats
+    route("/api/events/stats", HTTP_GET, [](AsyncWebServerRequest *request) {
         int successCount = 0;
         int errorCount = 0;
         
-        for (const auto &event : eventHistory) {
-            if (event.type == "SUCCESS") {
+        for (size_t i = 0; i < eventHistory.size(); i++) {
+            const EventLog &event = eventHistory.at(i);
+            if (event.severity == EVENT_SUCCESS) {
                 successCount++;
-            } else if (event.type == "ERROR") {
+            } else if (event.severity == EVENT_ERROR) {
                 errorCount++;
             }
         }
@@ -182,38 +573,73 @@ void registerRoutes() {
         
         String json;
         serializeJson(doc, json);
-        server.send(200, "application/json", json);
+        request->send(200, "application/json", json);
     });
 
-    server.on("/api/events/stats", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    route("/api/events/stats", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
+    // GET event history, newest first, streamed in chunks.
+    // ?since=<id> returns only newer events, ?before=<id> pages back in time.
+    route("/api/events", HTTP_GET, [](AsyncWebServerRequest *request) {
+        struct EventCursor {
+            uint32_t firstId;
+            uint32_t beforeId;
+            long remaining;
+        };
+        auto cursor = std::make_shared<EventCursor>();
+        cursor->firstId = request->hasParam("since") ? request->getParam("since")->value().toInt() + 1 : 0;
+        cursor->beforeId = request->hasParam("before") ? request->getParam("before")->value().toInt() : UINT32_MAX;
+        cursor->remaining = request->hasParam("limit") ? request->getParam("limit")->value().toInt() : EVENT_PAGE_LIMIT;
+        if (cursor->remaining <= 0 || cursor->remaining > EVENT_LOG_CAPACITY) cursor->remaining = EVENT_LOG_CAPACITY;
+        
+        Serial.printf("GET /api/events (since %u, before %u, limit %ld)\n",
+                      cursor->firstId, cursor->beforeId, cursor->remaining);
+        
+        // Each batch carries on below the last id sent
+        sendJsonArray(request, [cursor](JsonArrayStream &stream) {
+            char eventJson[JSON_BUFFER_MEDIUM];
+            size_t batch = std::min(cursor->remaining, 8L);
+            cursor->remaining -= readEvents(cursor->firstId, cursor->beforeId, batch,
+                                            [&](uint32_t id, const EventLog &event) {
+                eventToJson(id, event, eventJson, sizeof(eventJson));
+                stream.add(eventJson);
+                cursor->beforeId = id;
+            });
+        });
+    });
+
+    route("/api/events", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
+    });
+    
+    // DELETE all events
+    route("/api/events", HTTP_DELETE, [](AsyncWebServerRequest *request) {
+        clearEventLog();
+        
+        Serial.println("Event history cleared");
+        request->send(200, "application/json", "{\"status\":\"ok\"}");
+    });
+    
     // Handle OPTIONS for alarms
-    server.on("/api/alarms/", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    route("/api/alarms/", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
-    server.on("/api/settings", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    route("/api/settings", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
     // GET alarms
-    server.on("/api/alarms", HTTP_GET, []() {
-        setCORSHeaders();
-        String json = alarmsToJson();
-        Serial.println("GET /api/alarms -> " + json);
-        server.send(200, "application/json", json);
+    route("/api/alarms", HTTP_GET, [](AsyncWebServerRequest *request) {
+        Serial.printf("GET /api/alarms -> %d alarms\n", alarms.size());
+        sendAlarms(request);
     });
 
     // POST add alarm
-    server.on("/api/alarms", HTTP_POST, []() {
-        setCORSHeaders();
-        
-        String body = server.arg("plain");
+    route("/api/alarms", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String body = requestBody(request);
         Serial.println("POST /api/alarms body: " + body);
         
         DynamicJsonDocument doc(JSON_BUFFER_SMALL);
@@ -222,86 +648,138 @@ void registerRoutes() {
         if (err) {
             Serial.print("Error parsing POST data: ");
             Serial.println(err.c_str());
-            logEvent("ERROR", "System", "Error parsing set-time addition request");
-            server.send(400, "text/plain", "Invalid JSON");
+            logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_ALARM_REQUEST_INVALID);
+            request->send(400, "text/plain", "Invalid JSON");
             return;
         }
 
         Alarm a;
+        if (!parseAlarmTime(doc["time"].as<const char *>(), a.minute)) {
+            logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_ALARM_REQUEST_INVALID);
+            request->send(400, "text/plain", "Invalid time, expected HH:MM");
+            return;
+        }
+        if (alarms.size() >= MAX_ALARMS) {
+            request->send(400, "text/plain", "Too many alarms");
+            return;
+        }
         a.id = millis();
-        a.time = doc["time"].as<String>();
+        a.days = (doc["days"] | ALARM_DAYS_ALL) & ALARM_DAYS_ALL;
         a.active = true;
+        if (a.days == 0) {
+            request->send(400, "text/plain", "No days selected");
+            return;
+        }
 
         alarms.push_back(a);
         saveAlarms();
+        invalidateSchedule();
 
-        String json = alarmsToJson();
-        Serial.println("POST response: " + json);
-        server.send(200, "application/json", json);
+        Serial.printf("POST response: %d alarms\n", alarms.size());
+        sendAlarms(request);
     });
 
     // SETTINGS GET
-    server.on("/api/settings", HTTP_GET, []() {
-        setCORSHeaders();
+    route("/api/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
         Serial.println("GET /api/settings");
-        serveStaticFile(FILE_SETTINGS, "application/json");
+        request->send(200, "application/json", settingsToJson());
     });
 
     // SETTINGS POST
-    server.on("/api/settings", HTTP_POST, []() {
-        setCORSHeaders();
-        
-        String body = server.arg("plain");
+    route("/api/settings", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String body = requestBody(request);
         Serial.println("POST /api/settings body: " + body);
+
+        StaticJsonDocument<JSON_BUFFER_SMALL> doc;
+        DeserializationError err = deserializeJson(doc, body);
+        const char *timeFormat = doc["timeFormat"].as<const char *>();
+        const char *theme = doc["theme"].as<const char *>();
+        if (err || !timeFormat || !theme ||
+            (strcmp(timeFormat, "12") != 0 && strcmp(timeFormat, "24") != 0) ||
+            strlen(theme) == 0 || strlen(theme) > 11) {
+            request->send(400, "text/plain", "Invalid settings");
+            return;
+        }
         
-        File f = LittleFS.open(FILE_SETTINGS, "w");
-        if (!f) {
+        if (!saveSettings(timeFormat, theme)) {
             Serial.println("Failed to save settings");
-            logEvent("ERROR", "System", "Error saving settings to file (settings.json)");
-            server.send(500, "text/plain", "Failed to save settings");
+            logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_SETTINGS_WRITE_FAILED);
+            request->send(500, "text/plain", "Failed to save settings");
             return;
         }
-        f.print(body);
-        f.close();
         
         Serial.println("Settings saved successfully");
-        server.send(200, "text/plain", "OK");
+        request->send(200, "text/plain", "OK");
     });
 
-    // Manual Activation
-    server.on("/api/trigger-now", HTTP_POST, []() {
-        setCORSHeaders();
-        triggerActivation(true);
-        server.send(200, "text/plain", "OK");
+    // GET the whole config store as JSON: mode, servo, wifi and settings as
+    // they are stored, then the alarms
+    route("/api/config", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(JSON_BUFFER_LARGE);
+        configToJson(doc.to<JsonObject>());
+        String head;
+        serializeJson(doc, head);
+
+        // Reopen the object so the alarm array streams in as its last member
+        head.remove(head.length() - 1);
+        head += ",\"alarms\":[";
+        auto next = std::make_shared<size_t>(0);
+        sendJsonArray(request, [next](JsonArrayStream &stream) {
+            char alarmJson[JSON_BUFFER_SMALL];
+            for (int i = 0; i < 8 && *next < alarms.size(); i++, (*next)++) {
+                alarmToJson(alarms[*next], alarmJson, sizeof(alarmJson));
+                stream.add(alarmJson);
+            }
+        }, head, "]}");
     });
 
-    server.on("/api/trigger-now", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    // Manual Activation. Returns at once with the motion job id; the move
+    // runs from loop() and its outcome arrives as a "job" stream message
+    route("/api/trigger-now", HTTP_POST, [](AsyncWebServerRequest *request) {
+        uint32_t job = triggerActivation(true);
+        if (job == 0) {
+            request->send(503, "application/json", "{\"status\":\"busy\"}");
+            return;
+        }
+        request->send(200, "application/json", "{\"status\":\"queued\",\"job\":" + String(job) + "}");
     });
 
-    // Reset Motor Position
-    server.on("/api/reset-motor", HTTP_POST, []() {
-        setCORSHeaders();
+    route("/api/trigger-now", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
+    });
 
+    // Reset Motor Position
+    route("/api/reset-motor", HTTP_POST, [](AsyncWebServerRequest *request) {
         Serial.println("Resetting Motor Position. Moving to Angle 0 (Dead Chamber).");
-        moveToAngle(0);
-
-        compartment = 0;
-        saveCompartmentPosition();
+        uint32_t job = queueMotion(MOTION_HOME, true, nullptr);
+        if (job == 0) {
+            request->send(503, "application/json", "{\"status\":\"busy\"}");
+            return;
+        }
+        request->send(200, "application/json", "{\"status\":\"queued\",\"job\":" + String(job) + "}");
+    });
 
-        server.send(200, "text/plain", "OK");
+    // GET a motion job queued by trigger-now or reset-motor: /api/jobs/{id}
+    route("/api/jobs", HTTP_GET, [](AsyncWebServerRequest *request) {
+        String uri = request->url();
+        uint32_t id = uri.substring(uri.lastIndexOf('/') + 1).toInt();
+        MotionJob job;
+        if (!findMotionJob(id, job)) {
+            request->send(404, "application/json", "{\"error\":\"unknown job\"}");
+            return;
+        }
+        char json[JSON_BUFFER_SMALL];
+        motionJobToJson(job, json, sizeof(json));
+        request->send(200, "application/json", json);
     });
 
-    server.on("/api/reset-motor", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    route("/api/reset-motor", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
     // GET current time from RTC
-    server.on("/api/time", HTTP_GET, []() {
+    route("/api/time", HTTP_GET, [](AsyncWebServerRequest *request) {
         extern RTC_DS3231 rtc;
-        setCORSHeaders();
         
         DateTime now = rtc.now();
         
@@ -316,168 +794,131 @@ void registerRoutes() {
         String json;
         serializeJson(doc, json);
         
-        server.send(200, "application/json", json);
+        request->send(200, "application/json", json);
     });
 
-    server.on("/api/time", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    route("/api/time", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
     // POST set mode to "set_times"
-    server.on("/api/mode/set-times", HTTP_POST, []() {
-        setCORSHeaders();
-        
+    route("/api/mode/set-times", HTTP_POST, [](AsyncWebServerRequest *request) {
         modeConfig.activeMode = "set_times";
         saveModeConfig();
+        invalidateSchedule();
         
-        server.send(200, "application/json", "{\"status\":\"ok\"}");
+        request->send(200, "application/json", "{\"status\":\"ok\"}");
+    });
+
+    // GET the drawn random-interval plan, one entry per trigger.
+    // Registered before /api/mode, which would otherwise also match it
+    route("/api/mode/random-plan", HTTP_GET, [](AsyncWebServerRequest *request) {
+        auto next = std::make_shared<uint16_t>(0);
+        sendJsonArray(request, [next](JsonArrayStream &stream) {
+            char entryJson[64];
+            uint16_t cursor = randomPlanCursor();
+            for (int i = 0; i < 8 && *next < randomPlanCount(); i++, (*next)++) {
+                snprintf(entryJson, sizeof(entryJson), "{\"unix\":%lu,\"done\":%s}",
+                         (unsigned long)randomPlanTrigger(*next), *next < cursor ? "true" : "false");
+                stream.add(entryJson);
+            }
+        });
     });
 
     // GET mode configuration
-    server.on("/api/mode", HTTP_GET, []() {
-        extern RTC_DS3231 rtc;
-        setCORSHeaders();
-        
+    route("/api/mode", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(JSON_BUFFER_MEDIUM);
         doc["activeMode"] = modeConfig.activeMode;
         doc["regIntervalHours"] = modeConfig.regIntervalHours;
         doc["regIntervalMinutes"] = modeConfig.regIntervalMinutes;
         doc["randIntervalHours"] = modeConfig.randIntervalHours;
         doc["randIntervalMinutes"] = modeConfig.randIntervalMinutes;
+        doc["randMinGapMinutes"] = modeConfig.randMinGapMinutes;
+        doc["randQuietStartMinute"] = modeConfig.randQuietStartMinute;
+        doc["randQuietEndMinute"] = modeConfig.randQuietEndMinute;
         
-        // Calculate next activation time
-        DateTime now = rtc.now();
-        uint32_t currentUnix = now.unixtime();
-        String nextTime = "";
-        
-        if (modeConfig.activeMode == "set_times") {
-            for (auto &a : alarms) {
-                if (a.active) {
-                    int alarmHour = a.time.substring(0, 2).toInt();
-                    int alarmMin = a.time.substring(3, 5).toInt();
-                    
-                    if (alarmHour > now.hour() || 
-                        (alarmHour == now.hour() && alarmMin > now.minute())) {
-                        nextTime = a.time;
-                        break;
-                    }
-                }
-            }
-            if (nextTime == "" && alarms.size() > 0) {
-                for (auto &a : alarms) {
-                    if (a.active) {
-                        nextTime = a.time + " (tomorrow)";
-                        break;
-                    }
-                }
-            }
-        } 
-        else if (modeConfig.activeMode == "regular_interval") {
-            if (modeConfig.regIntervalLastTriggerUnix > 0) {
-                uint32_t intervalSeconds = (modeConfig.regIntervalHours * 3600UL + 
-                                            modeConfig.regIntervalMinutes * 60UL);
-                uint32_t nextTriggerUnix = modeConfig.regIntervalLastTriggerUnix + intervalSeconds;
-                
-                if (currentUnix >= nextTriggerUnix) {
-                    nextTime = "Overdue";
-                } else {
-                    uint32_t remaining = nextTriggerUnix - currentUnix;
-                    int remainingHours = remaining / 3600;
-                    int remainingMinutes = (remaining % 3600) / 60;
-                    nextTime = String(remainingHours) + "h " + String(remainingMinutes) + "m";
-                }
-            } else {
-                nextTime = "Not started";
-            }
-        } 
-        else if (modeConfig.activeMode == "random_interval") {
-            if (modeConfig.randIntervalNextTriggerUnix > 0) {
-                if (currentUnix >= modeConfig.randIntervalNextTriggerUnix) {
-                    nextTime = "Overdue";
-                } else {
-                    uint32_t remaining = modeConfig.randIntervalNextTriggerUnix - currentUnix;
-                    int remainingHours = remaining / 3600;
-                    int remainingMinutes = (remaining % 3600) / 60;
-                    nextTime = String(remainingHours) + "h " + String(remainingMinutes) + "m (random)";
-                }
-            } else {
-                nextTime = "Not started";
-            }
-        }
-        
-        doc["nextActivationTime"] = nextTime;
+        doc["nextActivationUnix"] = nextFireUnix();
+        doc["nextActivationTime"] = describeNextActivation(rtc.now().unixtime());
         
         String json;
         serializeJson(doc, json);
-        server.send(200, "application/json", json);
+        request->send(200, "application/json", json);
     });
 
     // POST set mode to "regular_interval"
-    server.on("/api/mode/regular-interval", HTTP_POST, []() {
+    route("/api/mode/regular-interval", HTTP_POST, [](AsyncWebServerRequest *request) {
         extern RTC_DS3231 rtc;
-        setCORSHeaders();
         
-        String body = server.arg("plain");
+        String body = requestBody(request);
         DynamicJsonDocument doc(JSON_BUFFER_SMALL);
         deserializeJson(doc, body);
         
+        long hours = doc["hours"] | 0L;
+        long minutes = doc["minutes"] | 0L;
+        if (!intervalInRange(hours, minutes)) {
+            logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_MODE_REQUEST_INVALID);
+            request->send(400, "text/plain", "Invalid interval, expected 1 minute to 7 days");
+            return;
+        }
+        
         modeConfig.activeMode = "regular_interval";
-        modeConfig.regIntervalHours = doc["hours"];
-        modeConfig.regIntervalMinutes = doc["minutes"];
+        modeConfig.regIntervalHours = hours;
+        modeConfig.regIntervalMinutes = minutes;
         
         DateTime now = rtc.now();
         modeConfig.regIntervalLastTriggerUnix = now.unixtime();
         
         saveModeConfig();
+        invalidateSchedule();
         
         Serial.printf("Regular interval set: %dh %dm, starting from now\n",
                     modeConfig.regIntervalHours, modeConfig.regIntervalMinutes);
         
-        server.send(200, "application/json", "{\"status\":\"ok\"}");
+        request->send(200, "application/json", "{\"status\":\"ok\"}");
     });
 
     // POST set mode to "random_interval"
-    server.on("/api/mode/random-interval", HTTP_POST, []() {
-        setCORSHeaders();
-        
-        String body = server.arg("plain");
+    route("/api/mode/random-interval", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String body = requestBody(request);
         DynamicJsonDocument doc(JSON_BUFFER_SMALL);
         deserializeJson(doc, body);
         
+        long hours = doc["hours"] | 0L;
+        long minutes = doc["minutes"] | 0L;
+        if (!intervalInRange(hours, minutes)) {
+            logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_MODE_REQUEST_INVALID);
+            request->send(400, "text/plain", "Invalid interval, expected 1 minute to 7 days");
+            return;
+        }
+        
         modeConfig.activeMode = "random_interval";
-        modeConfig.randIntervalHours = doc["hours"];
-        modeConfig.randIntervalMinutes = doc["minutes"];
+        modeConfig.randIntervalHours = hours;
+        modeConfig.randIntervalMinutes = minutes;
+        // Optional constraints; quiet hours are minutes of the day and an
+        // equal start and end means none
+        modeConfig.randMinGapMinutes = constrain((int)(doc["minGapMinutes"] | 0), 0, 24 * 60);
+        modeConfig.randQuietStartMinute = constrain((int)(doc["quietStart"] | 0), 0, 24 * 60 - 1);
+        modeConfig.randQuietEndMinute = constrain((int)(doc["quietEnd"] | 0), 0, 24 * 60 - 1);
         
-        initializeRandomInterval();
+        newRandomPlan(rtc.now().unixtime());
+        invalidateSchedule();
         
-        server.send(200, "application/json", "{\"status\":\"ok\"}");
+        request->send(200, "application/json", "{\"status\":\"ok\"}");
     });
 
     // POST trigger sleep mode
-    server.on("/api/sleep", HTTP_POST, []() {
-        setCORSHeaders();
-        server.send(200, "application/json", "{\"status\":\"sleeping\"}");
-        
-        delay(500);
-        
+    // loop() shuts the AP down once this reply has gone out
+    route("/api/sleep", HTTP_POST, [](AsyncWebServerRequest *request) {
         Serial.println("Manual sleep requested via API");
-        server.stop();
-        WiFi.softAPdisconnect(true);
-        WiFi.mode(WIFI_OFF);
-        digitalWrite(LED_PIN, LOW);
-        
-        delay(100);
-        configureNextWake();
-        enterDeepSleep();
+        sleepRequested = true;
+        request->send(200, "application/json", "{\"status\":\"sleeping\"}");
     });
 
     // POST sync time from browser
-    server.on("/api/sync-time", HTTP_POST, []() {
+    route("/api/sync-time", HTTP_POST, [](AsyncWebServerRequest *request) {
         extern RTC_DS3231 rtc;
-        setCORSHeaders();
         
-        String body = server.arg("plain");
+        String body = requestBody(request);
         Serial.println("POST /api/sync-time body: " + body);
         
         DynamicJsonDocument doc(JSON_BUFFER_SMALL);
@@ -486,8 +927,8 @@ void registerRoutes() {
         if (error) {
             Serial.print("Error parsing sync-time JSON: ");
             Serial.println(error.c_str());
-            logEvent("ERROR", "System", "Error parsing sync-time request");
-            server.send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_SYNC_TIME_INVALID);
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
             return;
         }
         
@@ -496,22 +937,21 @@ void registerRoutes() {
         DateTime newTime(epoch);
         
         rtc.adjust(newTime);
+        invalidateSchedule();
         
         Serial.printf("RTC time synced to AEST: %04d-%02d-%02d %02d:%02d:%02d\n",
                     newTime.day(), newTime.month(), newTime.year(),
                     newTime.hour(), newTime.minute(), newTime.second());
         
-        server.send(200, "application/json", "{\"success\":true}");
+        request->send(200, "application/json", "{\"success\":true}");
     });
 
-    server.on("/api/sync-time", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    route("/api/sync-time", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
     // GET WiFi settings
-    server.on("/api/wifi", HTTP_GET, []() {
-        setCORSHeaders();
+    route("/api/wifi", HTTP_GET, [](AsyncWebServerRequest *request) {
         Serial.println("GET /api/wifi");
         
         DynamicJsonDocument doc(JSON_BUFFER_SMALL);
@@ -519,19 +959,16 @@ void registerRoutes() {
         
         String json;
         serializeJson(doc, json);
-        server.send(200, "application/json", json);
+        request->send(200, "application/json", json);
     });
 
-    server.on("/api/wifi", HTTP_OPTIONS, []() {
-        setCORSHeaders();
-        server.send(200, "text/plain", "");
+    route("/api/wifi", HTTP_OPTIONS, [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "");
     });
 
     // POST update WiFi settings
-    server.on("/api/wifi", HTTP_POST, []() {
-        setCORSHeaders();
-        
-        String body = server.arg("plain");
+    route("/api/wifi", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String body = requestBody(request);
         Serial.println("POST /api/wifi body: " + body);
         
         DynamicJsonDocument doc(JSON_BUFFER_SMALL);
@@ -540,15 +977,15 @@ void registerRoutes() {
         if (err) {
             Serial.print("Error parsing WiFi settings: ");
             Serial.println(err.c_str());
-            logEvent("ERROR", "System", "Error parsing WiFi settings");
-            server.send(400, "text/plain", "Invalid JSON");
+            logEvent(EVENT_ERROR, EVENT_MODE_SYSTEM, MSG_WIFI_REQUEST_INVALID);
+            request->send(400, "text/plain", "Invalid JSON");
             return;
         }
         
         String newSSID = doc["ssid"].as<String>();
         
         if (newSSID.length() == 0 || newSSID.length() > 32) {
-            server.send(400, "application/json", 
+            request->send(400, "application/json", 
                 "{\"error\":\"SSID must be 1-32 characters\"}");
             return;
         }
@@ -559,18 +996,18 @@ void registerRoutes() {
         Serial.println("WiFi settings updated successfully");
         Serial.println("  New SSID: " + currentSSID);
         
-        server.send(200, "application/json", 
+        request->send(200, "application/json", 
             "{\"status\":\"ok\",\"message\":\"Settings saved. Changes will apply on next wake/restart.\"}");
     });
 
     // 404 fallback
-    server.onNotFound([]() {
-        String uri = server.uri();
-        HTTPMethod method = server.method();
+    server.onNotFound([](AsyncWebServerRequest *request) {
+        std::lock_guard<std::recursive_mutex> lock(stateMutex);
+        String uri = request->url();
+        WebRequestMethodComposite method = request->method();
         
         // Handle DELETE /api/alarms/{id}
         if (uri.startsWith("/api/alarms/") && method == HTTP_DELETE) {
-            setCORSHeaders();
             
             int lastSlash = uri.lastIndexOf('/');
             String idStr = uri.substring(lastSlash + 1);
@@ -587,13 +1024,13 @@ void registerRoutes() {
             
             Serial.printf("Deleted alarm. Count: %d -> %d\n", before, alarms.size());
             saveAlarms();
-            server.send(200, "application/json", alarmsToJson());
+            invalidateSchedule();
+            sendAlarms(request);
             return;
         }
         
         // Handle PATCH /api/alarms/{id}
         if (uri.startsWith("/api/alarms/") && method == HTTP_PATCH) {
-            setCORSHeaders();
             
             int lastSlash = uri.lastIndexOf('/');
             String idStr = uri.substring(lastSlash + 1);
@@ -616,20 +1053,20 @@ void registerRoutes() {
             }
             
             saveAlarms();
-            server.send(200, "application/json", alarmsToJson());
+            invalidateSchedule();
+            sendAlarms(request);
             return;
         }
         
         // Handle OPTIONS /api/alarms/{id}
         if (uri.startsWith("/api/alarms/") && method == HTTP_OPTIONS) {
-            setCORSHeaders();
-            server.send(200, "text/plain", "");
+            request->send(200, "text/plain", "");
             return;
         }
         
         // Ignore favicon
         if (uri == "/favicon.ico") {
-            server.send(204, "text/plain", "");
+            request->send(204, "text/plain", "");
             return;
         }
 
@@ -638,14 +1075,12 @@ void registerRoutes() {
             uri.indexOf("gen_204") >= 0 ||
             uri.indexOf("ncsi") >= 0 ||
             uri.indexOf("connecttest") >= 0) {
-            server.sendHeader("Location", "http://" + WiFi.softAPIP().toString());
-            server.send(302, "text/plain", "");
+            redirectToPortal(request);
             return;
         }
         
         // Default 404
         Serial.println("404: " + uri);
-        server.sendHeader("Location", "http://" + WiFi.softAPIP().toString());
-        server.send(302, "text/html", "");
+        redirectToPortal(request);
     });
 }
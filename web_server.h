@@ -2,9 +2,10 @@
 #define WEB_SERVER_H
 
 #include <WiFi.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <DNSServer.h>
 #include "config.h"
+#include "types.h"
 
 // ========================================
 // Web Server Functions
@@ -12,14 +13,16 @@
 
 void setupCaptivePortal();
 void registerRoutes();
-void serveStaticFile(String path, String type);
-void setCORSHeaders();
+void serveAsset(AsyncWebServerRequest *request, const WebAsset &asset);
+void sendAlarms(AsyncWebServerRequest *request);
+void publishStatus();
 
 // ========================================
 // Global Server Objects (extern)
 // ========================================
 
-extern WebServer server;
+extern AsyncWebServer server;
+extern AsyncEventSource statusEvents;
 extern DNSServer dnsServer;
 
 #endif // WEB_SERVER_H